@@ -0,0 +1,89 @@
+// AssetCache.cpp
+#include "AssetCache.h"
+#include "Model.h"
+#include "ModelLoader.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include "TextureCache.h"
+
+// Maximum number of imported models waiting for upload before workers block
+const size_t UPLOAD_QUEUE_CAPACITY = 8;
+
+std::unordered_map<std::string, std::weak_ptr<ModelAsset>> AssetCache::models;
+UploadQueue AssetCache::uploads(UPLOAD_QUEUE_CAPACITY);
+size_t AssetCache::hits = 0;
+size_t AssetCache::misses = 0;
+
+std::shared_ptr<const ModelAsset> AssetCache::LoadModel(const std::string& path)
+{
+    std::string fullPath = ResolveModelPath(path);
+
+    auto it = models.find(fullPath);
+    if (it != models.end())
+    {
+        std::shared_ptr<ModelAsset> asset = it->second.lock();
+        if (asset)
+        {
+            hits++;
+            return asset;
+        }
+    }
+
+    misses++;
+    std::shared_ptr<ModelAsset> asset = std::make_shared<ModelAsset>(fullPath);
+    models[fullPath] = asset;
+
+    // Import on a worker; the result is uploaded on the render thread by ProcessUploads()
+    std::weak_ptr<ModelAsset> target = asset;
+    ThreadPool::Shared().Submit([fullPath, target]()
+    {
+        if (target.expired())
+            return; // Deleted before the import started
+        PROFILE_SCOPE("Import model");
+        uploads.Push(target, LoadModelData(fullPath));
+    });
+    return asset;
+}
+
+void AssetCache::ProcessUploads(double budgetMs)
+{
+    uploads.Process(budgetMs);
+}
+
+AssetCacheStats AssetCache::GetStats()
+{
+    AssetCacheStats stats = {};
+    stats.hits = hits;
+    stats.misses = misses;
+
+    // Drop entries whose asset has been released while counting the live ones
+    for (auto it = models.begin(); it != models.end();)
+    {
+        std::shared_ptr<ModelAsset> asset = it->second.lock();
+        if (!asset)
+        {
+            it = models.erase(it);
+            continue;
+        }
+        stats.modelsResident++;
+        if (!asset->loaded)
+            stats.modelsLoading++;
+        stats.bytesResident += asset->residentBytes;
+        ++it;
+    }
+    stats.bytesResident += TextureCache::GetStats().bytesResident;
+    return stats;
+}
+
+void AssetCache::ResetCounters()
+{
+    hits = 0;
+    misses = 0;
+}
+
+void AssetCache::Shutdown()
+{
+    uploads.Close();
+    ThreadPool::Shared().Wait();
+    uploads.Clear();
+}
@@ -0,0 +1,49 @@
+// AssetCache.h
+#ifndef ASSET_CACHE_H
+#define ASSET_CACHE_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+class ModelAsset;
+class UploadQueue;
+
+// Counters describing how well the cache is doing
+struct AssetCacheStats {
+    size_t hits;          // Requests served from an already loaded asset
+    size_t misses;        // Requests that had to load the file
+    size_t modelsResident; // Assets currently alive
+    size_t modelsLoading; // Assets still being imported or uploaded
+    size_t bytesResident; // Vertex and index bytes of the live assets, plus the TextureCache's texture bytes
+};
+
+// Process-wide cache of model assets keyed by resolved file path.
+// The cache only holds weak references: an asset is released as soon as the last Model using it goes away.
+// Files are imported on the shared thread pool and uploaded to the GPU by ProcessUploads().
+class AssetCache
+{
+public:
+    // Returns the shared asset for the given path, starting a background load on first use
+    static std::shared_ptr<const ModelAsset> LoadModel(const std::string& path);
+
+    // Performs pending GL uploads for at most budgetMs; call once per frame on the render thread
+    static void ProcessUploads(double budgetMs);
+
+    // Returns the current hit/miss and residency counters
+    static AssetCacheStats GetStats();
+
+    // Resets the hit/miss counters (residency is left untouched)
+    static void ResetCounters();
+
+    // Stops accepting uploads and waits for running imports; call before destroying the GL context
+    static void Shutdown();
+
+private:
+    static std::unordered_map<std::string, std::weak_ptr<ModelAsset>> models;
+    static UploadQueue uploads;
+    static size_t hits;
+    static size_t misses;
+};
+
+#endif // ASSET_CACHE_H
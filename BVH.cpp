@@ -0,0 +1,368 @@
+// BVH.cpp
+#include "BVH.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+// Leaves hold at most this many items
+const uint32_t MAX_LEAF_ITEMS = 4;
+// Candidate split positions per node in the SAH build
+const int SAH_BINS = 16;
+
+static float SurfaceArea(const glm::vec3& boxMin, const glm::vec3& boxMax)
+{
+    glm::vec3 size = glm::max(boxMax - boxMin, glm::vec3(0.0f));
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+static glm::vec3 Centroid(const Bounds& bounds)
+{
+    return (bounds.min + bounds.max) * 0.5f;
+}
+
+static float DistanceSquaredToBox(const glm::vec3& point, const glm::vec3& boxMin, const glm::vec3& boxMax)
+{
+    glm::vec3 offset = glm::max(glm::max(boxMin - point, point - boxMax), glm::vec3(0.0f));
+    return glm::dot(offset, offset);
+}
+
+void BVH::refitNode(uint32_t index)
+{
+    Node& node = nodes[index];
+    if (node.count > 0)
+    {
+        node.min = bounds[order[node.leftFirst]].min;
+        node.max = bounds[order[node.leftFirst]].max;
+        for (uint32_t i = 1; i < node.count; i++)
+        {
+            const Bounds& item = bounds[order[node.leftFirst + i]];
+            node.min = glm::min(node.min, item.min);
+            node.max = glm::max(node.max, item.max);
+        }
+    }
+    else
+    {
+        const Node& left = nodes[node.leftFirst];
+        const Node& right = nodes[node.leftFirst + 1];
+        node.min = glm::min(left.min, right.min);
+        node.max = glm::max(left.max, right.max);
+    }
+}
+
+uint32_t BVH::splitNode(uint32_t index)
+{
+    uint32_t first = nodes[index].leftFirst;
+    uint32_t count = nodes[index].count;
+    if (count <= MAX_LEAF_ITEMS)
+        return 0;
+
+    // Bin item centroids along the widest centroid axis and pick the cheapest SAH split
+    glm::vec3 centroidMin = Centroid(bounds[order[first]]);
+    glm::vec3 centroidMax = centroidMin;
+    for (uint32_t i = 1; i < count; i++)
+    {
+        glm::vec3 centroid = Centroid(bounds[order[first + i]]);
+        centroidMin = glm::min(centroidMin, centroid);
+        centroidMax = glm::max(centroidMax, centroid);
+    }
+    glm::vec3 extent = centroidMax - centroidMin;
+    int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+    uint32_t* begin = order.data() + first;
+    uint32_t* end = begin + count;
+    uint32_t* middle = begin + count / 2;
+    if (extent[axis] > 1e-6f)
+    {
+        struct Bin {
+            glm::vec3 min = glm::vec3(1e30f);
+            glm::vec3 max = glm::vec3(-1e30f);
+            uint32_t count = 0;
+        } bins[SAH_BINS];
+        float binScale = SAH_BINS / extent[axis];
+        auto binOf = [&](uint32_t item) {
+            int bin = static_cast<int>((Centroid(bounds[item])[axis] - centroidMin[axis]) * binScale);
+            return std::min(bin, SAH_BINS - 1);
+        };
+        for (uint32_t* it = begin; it != end; ++it)
+        {
+            Bin& bin = bins[binOf(*it)];
+            bin.min = glm::min(bin.min, bounds[*it].min);
+            bin.max = glm::max(bin.max, bounds[*it].max);
+            bin.count++;
+        }
+
+        // Sweep from the right to get the cost of everything right of each split plane
+        float rightCost[SAH_BINS];
+        glm::vec3 boxMin(1e30f), boxMax(-1e30f);
+        uint32_t rightCount = 0;
+        for (int i = SAH_BINS - 1; i > 0; i--)
+        {
+            boxMin = glm::min(boxMin, bins[i].min);
+            boxMax = glm::max(boxMax, bins[i].max);
+            rightCount += bins[i].count;
+            rightCost[i] = rightCount ? SurfaceArea(boxMin, boxMax) * rightCount : 0.0f;
+        }
+        boxMin = glm::vec3(1e30f);
+        boxMax = glm::vec3(-1e30f);
+        uint32_t leftCount = 0;
+        float bestCost = 1e30f;
+        int bestSplit = SAH_BINS / 2;
+        for (int i = 1; i < SAH_BINS; i++)
+        {
+            boxMin = glm::min(boxMin, bins[i - 1].min);
+            boxMax = glm::max(boxMax, bins[i - 1].max);
+            leftCount += bins[i - 1].count;
+            float cost = (leftCount ? SurfaceArea(boxMin, boxMax) * leftCount : 0.0f) + rightCost[i];
+            if (leftCount > 0 && leftCount < count && cost < bestCost)
+            {
+                bestCost = cost;
+                bestSplit = i;
+            }
+        }
+        middle = std::partition(begin, end, [&](uint32_t item) { return binOf(item) < bestSplit; });
+    }
+    // Items stacked on one spot (or a degenerate partition): split the range in half
+    if (middle == begin || middle == end)
+        middle = begin + count / 2;
+
+    uint32_t left = static_cast<uint32_t>(nodes.size());
+    uint32_t leftItems = static_cast<uint32_t>(middle - begin);
+    nodes.push_back(Node{ glm::vec3(0.0f), first, glm::vec3(0.0f), leftItems });
+    nodes.push_back(Node{ glm::vec3(0.0f), first + leftItems, glm::vec3(0.0f), count - leftItems });
+    parents.push_back(index);
+    parents.push_back(index);
+    nodes[index].leftFirst = left;
+    nodes[index].count = 0;
+    refitNode(left);
+    refitNode(left + 1);
+    return left;
+}
+
+void BVH::Build(const std::vector<Bounds>& itemBounds)
+{
+    bounds = itemBounds;
+    uint32_t itemCount = static_cast<uint32_t>(bounds.size());
+    order.resize(itemCount);
+    std::iota(order.begin(), order.end(), 0u);
+    itemLeaf.assign(itemCount, 0);
+    nodes.clear();
+    parents.clear();
+    if (itemCount == 0)
+        return;
+
+    nodes.reserve(2 * static_cast<size_t>(itemCount));
+    parents.reserve(2 * static_cast<size_t>(itemCount));
+    nodes.push_back(Node{ glm::vec3(0.0f), 0, glm::vec3(0.0f), itemCount });
+    parents.push_back(NO_ITEM);
+    refitNode(0);
+
+    std::vector<uint32_t> stack(1, 0);
+    while (!stack.empty())
+    {
+        uint32_t node = stack.back();
+        stack.pop_back();
+        uint32_t left = splitNode(node);
+        if (left)
+        {
+            stack.push_back(left);
+            stack.push_back(left + 1);
+        }
+    }
+
+    for (uint32_t i = 0; i < nodes.size(); i++)
+    {
+        for (uint32_t j = 0; j < nodes[i].count; j++)
+            itemLeaf[order[nodes[i].leftFirst + j]] = i;
+    }
+}
+
+void BVH::Refit(const std::vector<Bounds>& itemBounds)
+{
+    if (itemBounds.size() != bounds.size())
+    {
+        Build(itemBounds);
+        return;
+    }
+    bounds = itemBounds;
+    for (size_t i = nodes.size(); i-- > 0;)
+        refitNode(static_cast<uint32_t>(i));
+}
+
+void BVH::UpdateItem(uint32_t item, const Bounds& itemBounds)
+{
+    if (item >= bounds.size())
+        return;
+    bounds[item] = itemBounds;
+    for (uint32_t node = itemLeaf[item]; node != NO_ITEM; node = parents[node])
+        refitNode(node);
+}
+
+void BVH::QueryFrustum(const Frustum& frustum, std::vector<uint32_t>& items) const
+{
+    if (nodes.empty())
+        return;
+
+    // Planes a node is fully inside are dropped for its whole subtree
+    struct Entry {
+        uint32_t node;
+        unsigned int planeMask;
+    };
+    std::vector<Entry> stack;
+    stack.reserve(64);
+    stack.push_back(Entry{ 0, 0x3Fu });
+    while (!stack.empty())
+    {
+        Entry entry = stack.back();
+        stack.pop_back();
+        const Node& node = nodes[entry.node];
+        if (entry.planeMask && frustum.ClassifyBox(node.min, node.max, entry.planeMask) < 0)
+            continue;
+
+        if (node.count > 0)
+        {
+            for (uint32_t i = 0; i < node.count; i++)
+            {
+                uint32_t item = order[node.leftFirst + i];
+                if (entry.planeMask == 0 || frustum.Intersects(bounds[item]))
+                    items.push_back(item);
+            }
+        }
+        else
+        {
+            stack.push_back(Entry{ node.leftFirst, entry.planeMask });
+            stack.push_back(Entry{ node.leftFirst + 1, entry.planeMask });
+        }
+    }
+}
+
+uint32_t BVH::Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& hitDistance,
+                      const std::function<float(uint32_t, float)>& refine) const
+{
+    uint32_t hit = NO_ITEM;
+    hitDistance = maxDistance;
+    float enter;
+    if (nodes.empty())
+        return hit;
+
+    // Avoid 0 * inf on axis-parallel rays
+    glm::vec3 safeDirection = direction;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        if (std::fabs(safeDirection[axis]) < 1e-20f)
+            safeDirection[axis] = 1e-20f;
+    }
+    glm::vec3 inverseDirection = 1.0f / safeDirection;
+
+    struct Entry {
+        uint32_t node;
+        float enter;
+    };
+    std::vector<Entry> stack;
+    stack.reserve(64);
+    if (!RayIntersectsBox(origin, inverseDirection, nodes[0].min, nodes[0].max, maxDistance, enter))
+        return hit;
+    stack.push_back(Entry{ 0, enter });
+    while (!stack.empty())
+    {
+        Entry entry = stack.back();
+        stack.pop_back();
+        if (entry.enter > hitDistance)
+            continue;
+
+        const Node& node = nodes[entry.node];
+        if (node.count > 0)
+        {
+            for (uint32_t i = 0; i < node.count; i++)
+            {
+                uint32_t item = order[node.leftFirst + i];
+                if (!RayIntersectsBox(origin, inverseDirection, bounds[item].min, bounds[item].max, hitDistance, enter))
+                    continue;
+                float distance = refine ? refine(item, enter) : enter;
+                if (distance >= 0.0f && distance < hitDistance)
+                {
+                    hitDistance = distance;
+                    hit = item;
+                }
+            }
+            continue;
+        }
+
+        // Push the farther child first so the nearer one is visited first
+        float leftEnter, rightEnter;
+        const Node& left = nodes[node.leftFirst];
+        const Node& right = nodes[node.leftFirst + 1];
+        bool hitLeft = RayIntersectsBox(origin, inverseDirection, left.min, left.max, hitDistance, leftEnter);
+        bool hitRight = RayIntersectsBox(origin, inverseDirection, right.min, right.max, hitDistance, rightEnter);
+        if (hitLeft && hitRight && leftEnter < rightEnter)
+        {
+            stack.push_back(Entry{ node.leftFirst + 1, rightEnter });
+            stack.push_back(Entry{ node.leftFirst, leftEnter });
+        }
+        else
+        {
+            if (hitLeft)
+                stack.push_back(Entry{ node.leftFirst, leftEnter });
+            if (hitRight)
+                stack.push_back(Entry{ node.leftFirst + 1, rightEnter });
+        }
+    }
+    return hit;
+}
+
+uint32_t BVH::Nearest(const glm::vec3& point, float maxDistance, float& distance) const
+{
+    uint32_t nearest = NO_ITEM;
+    float best = maxDistance * maxDistance;
+    if (nodes.empty())
+    {
+        distance = maxDistance;
+        return nearest;
+    }
+
+    struct Entry {
+        uint32_t node;
+        float distanceSquared;
+    };
+    std::vector<Entry> stack;
+    stack.reserve(64);
+    stack.push_back(Entry{ 0, DistanceSquaredToBox(point, nodes[0].min, nodes[0].max) });
+    while (!stack.empty())
+    {
+        Entry entry = stack.back();
+        stack.pop_back();
+        if (entry.distanceSquared > best)
+            continue;
+
+        const Node& node = nodes[entry.node];
+        if (node.count > 0)
+        {
+            for (uint32_t i = 0; i < node.count; i++)
+            {
+                uint32_t item = order[node.leftFirst + i];
+                float itemDistance = DistanceSquaredToBox(point, bounds[item].min, bounds[item].max);
+                if (itemDistance < best || (itemDistance == best && nearest == NO_ITEM))
+                {
+                    best = itemDistance;
+                    nearest = item;
+                }
+            }
+            continue;
+        }
+
+        // Nearer child on top of the stack
+        float leftDistance = DistanceSquaredToBox(point, nodes[node.leftFirst].min, nodes[node.leftFirst].max);
+        float rightDistance = DistanceSquaredToBox(point, nodes[node.leftFirst + 1].min, nodes[node.leftFirst + 1].max);
+        if (leftDistance < rightDistance)
+        {
+            stack.push_back(Entry{ node.leftFirst + 1, rightDistance });
+            stack.push_back(Entry{ node.leftFirst, leftDistance });
+        }
+        else
+        {
+            stack.push_back(Entry{ node.leftFirst, leftDistance });
+            stack.push_back(Entry{ node.leftFirst + 1, rightDistance });
+        }
+    }
+    distance = std::sqrt(best);
+    return nearest;
+}
@@ -0,0 +1,63 @@
+// BVH.h
+#ifndef BVH_H
+#define BVH_H
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "Bounds.h"
+#include "Frustum.h"
+
+// Bounding volume hierarchy over a set of items (model instances, lights, ...) identified by index.
+// Build does a full binned-SAH build; UpdateItem and Refit adjust boxes without changing the tree,
+// which is cheap but lets quality drift, so rebuild after large changes (scene loads).
+class BVH
+{
+public:
+    // Returned by queries that find nothing
+    static constexpr uint32_t NO_ITEM = 0xFFFFFFFFu;
+
+    // Builds the tree from scratch; item i has bounds itemBounds[i]
+    void Build(const std::vector<Bounds>& itemBounds);
+
+    // Replaces every item's bounds and refits all nodes (same item count as the last Build)
+    void Refit(const std::vector<Bounds>& itemBounds);
+
+    // Replaces one item's bounds and refits the nodes above it
+    void UpdateItem(uint32_t item, const Bounds& bounds);
+
+    // Appends the items whose bounds intersect the frustum
+    void QueryFrustum(const Frustum& frustum, std::vector<uint32_t>& items) const;
+
+    // Finds the closest item hit by the ray (direction need not be normalized; distances are in
+    // units of direction). Candidates are visited nearest box first; 'refine' can replace the box
+    // entry distance with a more precise one, returning a negative value for a miss.
+    uint32_t Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& hitDistance,
+                     const std::function<float(uint32_t item, float boxDistance)>& refine = nullptr) const;
+
+    // Finds the item whose box is closest to the point, within maxDistance
+    uint32_t Nearest(const glm::vec3& point, float maxDistance, float& distance) const;
+
+    size_t ItemCount() const { return bounds.size(); }
+    size_t NodeCount() const { return nodes.size(); }
+
+private:
+    struct Node {
+        glm::vec3 min;
+        uint32_t leftFirst; // Left child (right child is leftFirst + 1), or first entry of 'order' for leaves
+        glm::vec3 max;
+        uint32_t count;     // Items in a leaf, 0 for inner nodes
+    };
+
+    std::vector<Node> nodes;        // Children always come after their parent
+    std::vector<uint32_t> parents;  // Parent of each node, NO_ITEM for the root
+    std::vector<uint32_t> order;    // Item indices, grouped by leaf
+    std::vector<uint32_t> itemLeaf; // Leaf holding each item
+    std::vector<Bounds> bounds;     // Current bounds of each item
+
+    void refitNode(uint32_t node);
+    uint32_t splitNode(uint32_t node);
+};
+
+#endif // BVH_H
@@ -0,0 +1,419 @@
+// BakedModel.cpp
+#include "BakedModel.h"
+#include "ModelLoader.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+// File layout (little-endian):
+//   BakedHeader
+//   BakedMesh[meshCount]
+//   uint32_t textureRefs[textureRefCount]   (indices into the image table)
+//   BakedImage[imageCount]                  (aligned to BAKED_TABLE_ALIGNMENT)
+//   BakedNode[nodeCount]                    (scene graph, parents first; aligned to BAKED_TABLE_ALIGNMENT)
+//   char strings[stringsSize]               (texture paths and types)
+//   encoded bytes of the embedded textures, vertex and index blobs, each aligned to BAKED_BLOB_ALIGNMENT
+
+const char BAKED_MAGIC[4] = { 'M', 'E', 'B', 'K' };
+const uint64_t BAKED_BLOB_ALIGNMENT = 16;
+const uint64_t BAKED_TABLE_ALIGNMENT = 8; // Keeps the 64-bit fields of tables read in place aligned
+
+// Header flags
+const uint32_t BAKED_FLAG_VERTEX_PACKING = 1;    // Imported with vertex packing enabled
+const uint32_t BAKED_FLAG_MESH_OPTIMIZATION = 2; // Imported with mesh optimization enabled
+const uint32_t BAKED_FLAG_LOD_GENERATION = 4;    // Imported with LOD generation enabled
+
+struct BakedHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t vertexSize;       // sizeof(Vertex)
+    uint32_t packedVertexSize; // sizeof(PackedVertex)
+    uint32_t flags;
+    uint32_t meshCount;
+    uint32_t textureRefCount;
+    uint32_t imageCount;
+    uint32_t nodeCount;
+    uint32_t reserved;
+    uint64_t stringsOffset;
+    uint64_t stringsSize;
+    uint64_t fileSize;
+};
+
+struct BakedMaterial {
+    float diffuseColor[3];
+    float specularColor[3];
+    float shininess;
+    uint32_t hasTexture;
+};
+
+struct BakedBounds {
+    float min[3];
+    float max[3];
+    float center[3];
+    float radius;
+};
+
+struct BakedLod {
+    uint32_t firstIndex; // Within the mesh's index blob
+    uint32_t indexCount;
+    float error;
+};
+
+struct BakedMesh {
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t firstTextureRef;
+    uint32_t textureRefCount;
+    uint32_t vertexFormat; // VertexFormat of the vertex blob
+    uint32_t lodCount;     // Used entries of lods; 0 for a single level covering every index
+    int32_t node;          // MeshData::node
+    BakedMaterial material;
+    BakedBounds bounds;
+    BakedLod lods[MAX_MESH_LODS];
+};
+
+struct BakedImage {
+    uint32_t pathOffset;
+    uint32_t pathLength;
+    uint32_t typeOffset;
+    uint32_t typeLength;
+    int32_t embeddedIndex; // ImageData::embeddedIndex
+    uint32_t reserved;
+    uint64_t dataOffset;   // Encoded bytes of an embedded texture
+    uint64_t dataSize;
+};
+
+struct BakedNode {
+    int32_t parent;
+    float local[16];
+};
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+std::string BakedModelPath(const std::string& modelPath)
+{
+    return modelPath + ".bake";
+}
+
+bool IsBakedModelCurrent(const std::string& modelPath, const std::string& bakedPath)
+{
+    std::error_code error;
+    std::filesystem::file_time_type bakedTime = std::filesystem::last_write_time(bakedPath, error);
+    if (error)
+        return false;
+    std::filesystem::file_time_type modelTime = std::filesystem::last_write_time(modelPath, error);
+    if (error)
+        return false;
+    return bakedTime >= modelTime;
+}
+
+bool WriteBakedModel(const ModelData& model, const std::string& bakedPath)
+{
+    BakedHeader header = {};
+    std::memcpy(header.magic, BAKED_MAGIC, sizeof(BAKED_MAGIC));
+    header.version = BAKED_MODEL_VERSION;
+    header.vertexSize = sizeof(Vertex);
+    header.packedVertexSize = sizeof(PackedVertex);
+    header.flags = (VertexPackingEnabled() ? BAKED_FLAG_VERTEX_PACKING : 0) | (MeshOptimizationEnabled() ? BAKED_FLAG_MESH_OPTIMIZATION : 0) |
+        (LodGenerationEnabled() ? BAKED_FLAG_LOD_GENERATION : 0);
+    header.meshCount = static_cast<uint32_t>(model.meshes.size());
+    header.imageCount = static_cast<uint32_t>(model.images.size());
+    header.nodeCount = static_cast<uint32_t>(model.nodes.Size());
+
+    std::vector<BakedNode> nodes(model.nodes.Size());
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        nodes[i].parent = model.nodes.parents[i];
+        std::memcpy(nodes[i].local, &model.nodes.locals[i][0][0], sizeof(nodes[i].local));
+    }
+
+    // Texture references and strings
+    std::vector<uint32_t> textureRefs;
+    std::vector<BakedImage> images;
+    std::string strings;
+    for (const ImageData& image : model.images)
+    {
+        BakedImage baked = {};
+        baked.pathOffset = static_cast<uint32_t>(strings.size());
+        baked.pathLength = static_cast<uint32_t>(image.path.size());
+        strings += image.path;
+        baked.typeOffset = static_cast<uint32_t>(strings.size());
+        baked.typeLength = static_cast<uint32_t>(image.type.size());
+        strings += image.type;
+        baked.embeddedIndex = image.embeddedIndex;
+        baked.dataSize = image.encoded.size();
+        images.push_back(baked);
+    }
+
+    std::vector<BakedMesh> meshes;
+    for (const MeshData& mesh : model.meshes)
+    {
+        BakedMesh baked = {};
+        baked.vertexFormat = static_cast<uint32_t>(mesh.format);
+        baked.node = mesh.node;
+        baked.vertexCount = static_cast<uint32_t>(mesh.VertexCount());
+        baked.indexCount = static_cast<uint32_t>(mesh.IndexCount());
+        baked.firstTextureRef = static_cast<uint32_t>(textureRefs.size());
+        baked.textureRefCount = static_cast<uint32_t>(mesh.textures.size());
+        textureRefs.insert(textureRefs.end(), mesh.textures.begin(), mesh.textures.end());
+        baked.lodCount = static_cast<uint32_t>(std::min(mesh.lods.size(), MAX_MESH_LODS));
+        for (uint32_t j = 0; j < baked.lodCount; j++)
+        {
+            baked.lods[j].firstIndex = mesh.lods[j].firstIndex;
+            baked.lods[j].indexCount = mesh.lods[j].indexCount;
+            baked.lods[j].error = mesh.lods[j].error;
+        }
+
+        const Material& material = mesh.material;
+        std::memcpy(baked.material.diffuseColor, &material.diffuseColor[0], sizeof(baked.material.diffuseColor));
+        std::memcpy(baked.material.specularColor, &material.specularColor[0], sizeof(baked.material.specularColor));
+        baked.material.shininess = material.shininess;
+        baked.material.hasTexture = material.hasTexture ? 1 : 0;
+
+        std::memcpy(baked.bounds.min, &mesh.bounds.min[0], sizeof(baked.bounds.min));
+        std::memcpy(baked.bounds.max, &mesh.bounds.max[0], sizeof(baked.bounds.max));
+        std::memcpy(baked.bounds.center, &mesh.bounds.center[0], sizeof(baked.bounds.center));
+        baked.bounds.radius = mesh.bounds.radius;
+        meshes.push_back(baked);
+    }
+    header.textureRefCount = static_cast<uint32_t>(textureRefs.size());
+
+    // Lay out the tables, then the aligned blobs
+    uint64_t offset = sizeof(BakedHeader);
+    offset += meshes.size() * sizeof(BakedMesh);
+    offset += textureRefs.size() * sizeof(uint32_t);
+    const uint64_t imagesOffset = AlignUp(offset, BAKED_TABLE_ALIGNMENT);
+    offset = imagesOffset + images.size() * sizeof(BakedImage);
+    const uint64_t nodesOffset = AlignUp(offset, BAKED_TABLE_ALIGNMENT);
+    offset = nodesOffset + nodes.size() * sizeof(BakedNode);
+    header.stringsOffset = offset;
+    header.stringsSize = strings.size();
+    offset += strings.size();
+
+    for (BakedImage& image : images)
+    {
+        if (image.dataSize == 0)
+            continue;
+        offset = AlignUp(offset, BAKED_BLOB_ALIGNMENT);
+        image.dataOffset = offset;
+        offset += image.dataSize;
+    }
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        offset = AlignUp(offset, BAKED_BLOB_ALIGNMENT);
+        meshes[i].vertexOffset = offset;
+        offset += static_cast<uint64_t>(meshes[i].vertexCount) * VertexFormatSize(model.meshes[i].format);
+        offset = AlignUp(offset, BAKED_BLOB_ALIGNMENT);
+        meshes[i].indexOffset = offset;
+        offset += static_cast<uint64_t>(meshes[i].indexCount) * sizeof(uint32_t);
+    }
+    header.fileSize = offset;
+
+    // Write to a temporary file and move it in place so readers never see a partial bake
+    std::string tempPath = bakedPath + ".tmp";
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        std::cout << "ERROR::BAKE::Failed to open " << tempPath << " for writing" << std::endl;
+        return false;
+    }
+
+    uint64_t written = 0;
+    auto write = [&](const void* data, size_t size)
+    {
+        file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+        written += size;
+    };
+    auto pad = [&](uint64_t target)
+    {
+        static const char zeros[BAKED_BLOB_ALIGNMENT] = {};
+        while (written < target)
+            write(zeros, static_cast<size_t>(std::min<uint64_t>(target - written, BAKED_BLOB_ALIGNMENT)));
+    };
+
+    write(&header, sizeof(header));
+    write(meshes.data(), meshes.size() * sizeof(BakedMesh));
+    write(textureRefs.data(), textureRefs.size() * sizeof(uint32_t));
+    pad(imagesOffset);
+    write(images.data(), images.size() * sizeof(BakedImage));
+    pad(nodesOffset);
+    write(nodes.data(), nodes.size() * sizeof(BakedNode));
+    write(strings.data(), strings.size());
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        if (images[i].dataSize == 0)
+            continue;
+        pad(images[i].dataOffset);
+        write(model.images[i].encoded.data(), model.images[i].encoded.size());
+    }
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        const MeshData& mesh = model.meshes[i];
+        pad(meshes[i].vertexOffset);
+        write(mesh.VertexData(), mesh.VertexCount() * VertexFormatSize(mesh.format));
+        pad(meshes[i].indexOffset);
+        write(mesh.IndexData(), mesh.IndexCount() * sizeof(uint32_t));
+    }
+    file.close();
+
+    std::error_code error;
+    if (!file || written != header.fileSize)
+    {
+        std::cout << "ERROR::BAKE::Failed to write " << tempPath << std::endl;
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    std::filesystem::rename(tempPath, bakedPath, error);
+    if (error)
+    {
+        std::cout << "ERROR::BAKE::Failed to replace " << bakedPath << ": " << error.message() << std::endl;
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<ModelData> ReadBakedModel(const std::string& bakedPath, const std::string& modelPath)
+{
+    std::shared_ptr<MappedFile> mapping = std::make_shared<MappedFile>();
+    if (!mapping->Open(bakedPath))
+        return nullptr;
+
+    const unsigned char* data = mapping->Data();
+    const uint64_t size = mapping->Size();
+
+    // Validate the header and that every table lies inside the file
+    if (size < sizeof(BakedHeader))
+        return nullptr;
+    BakedHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, BAKED_MAGIC, sizeof(BAKED_MAGIC)) != 0 || header.version != BAKED_MODEL_VERSION ||
+        header.vertexSize != sizeof(Vertex) || header.packedVertexSize != sizeof(PackedVertex) || header.fileSize != size)
+        return nullptr;
+    // Baked under other import settings: re-import so the settings take effect
+    if (((header.flags & BAKED_FLAG_VERTEX_PACKING) != 0) != VertexPackingEnabled() ||
+        ((header.flags & BAKED_FLAG_MESH_OPTIMIZATION) != 0) != MeshOptimizationEnabled() ||
+        ((header.flags & BAKED_FLAG_LOD_GENERATION) != 0) != LodGenerationEnabled())
+        return nullptr;
+
+    uint64_t meshesOffset = sizeof(BakedHeader);
+    uint64_t refsOffset = meshesOffset + static_cast<uint64_t>(header.meshCount) * sizeof(BakedMesh);
+    uint64_t imagesOffset = AlignUp(refsOffset + static_cast<uint64_t>(header.textureRefCount) * sizeof(uint32_t), BAKED_TABLE_ALIGNMENT);
+    uint64_t nodesOffset = AlignUp(imagesOffset + static_cast<uint64_t>(header.imageCount) * sizeof(BakedImage), BAKED_TABLE_ALIGNMENT);
+    if (nodesOffset + static_cast<uint64_t>(header.nodeCount) * sizeof(BakedNode) > header.stringsOffset ||
+        header.stringsOffset + header.stringsSize > size)
+        return nullptr;
+
+    const BakedMesh* meshes = reinterpret_cast<const BakedMesh*>(data + meshesOffset);
+    const uint32_t* textureRefs = reinterpret_cast<const uint32_t*>(data + refsOffset);
+    const BakedImage* images = reinterpret_cast<const BakedImage*>(data + imagesOffset);
+    const BakedNode* nodes = reinterpret_cast<const BakedNode*>(data + nodesOffset);
+    const char* strings = reinterpret_cast<const char*>(data + header.stringsOffset);
+
+    std::unique_ptr<ModelData> model(new ModelData());
+    model->path = modelPath;
+    size_t lastSlash = modelPath.find_last_of("/\\");
+    model->directory = (lastSlash != std::string::npos) ? modelPath.substr(0, lastSlash) : ".";
+
+    for (uint32_t i = 0; i < header.nodeCount; i++)
+    {
+        if (nodes[i].parent >= static_cast<int32_t>(i))
+            return nullptr;
+        glm::mat4 local;
+        std::memcpy(&local[0][0], nodes[i].local, sizeof(nodes[i].local));
+        model->nodes.Add(nodes[i].parent < 0 ? -1 : nodes[i].parent, local);
+    }
+
+    model->images.resize(header.imageCount);
+    for (uint32_t i = 0; i < header.imageCount; i++)
+    {
+        const BakedImage& baked = images[i];
+        if (static_cast<uint64_t>(baked.pathOffset) + baked.pathLength > header.stringsSize ||
+            static_cast<uint64_t>(baked.typeOffset) + baked.typeLength > header.stringsSize ||
+            (baked.embeddedIndex >= 0 && (baked.dataSize == 0 || baked.dataOffset + baked.dataSize > size)))
+            return nullptr;
+
+        ImageData& image = model->images[i];
+        image.path.assign(strings + baked.pathOffset, baked.pathLength);
+        image.type.assign(strings + baked.typeOffset, baked.typeLength);
+        image.width = image.height = image.components = 0;
+        image.embeddedIndex = baked.embeddedIndex;
+    }
+
+    // Decode the textures in parallel, the embedded ones straight from the mapping.
+    // A texture that fails to decode uploads as texture 0.
+    ThreadPool::Shared().ParallelFor(model->images.size(), 1, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            ImageData& image = model->images[i];
+            if (image.embeddedIndex < 0)
+            {
+                LoadImageData(image.path, image);
+                continue;
+            }
+            const unsigned char* bytes = data + images[i].dataOffset;
+            LoadEmbeddedImageData(bytes, static_cast<size_t>(images[i].dataSize), image.path, modelPath, image);
+            // Skipped because the cache holds it; keep the bytes in case it is released before the upload
+            if (!image.pixels && image.compressed.format == 0 && !image.key.empty())
+                image.encoded.assign(bytes, bytes + images[i].dataSize);
+        }
+    });
+
+    model->meshes.resize(header.meshCount);
+    for (uint32_t i = 0; i < header.meshCount; i++)
+    {
+        const BakedMesh& baked = meshes[i];
+        if (baked.vertexFormat >= VERTEX_FORMAT_COUNT ||
+            baked.vertexOffset + static_cast<uint64_t>(baked.vertexCount) * VertexFormatSize(static_cast<VertexFormat>(baked.vertexFormat)) > size ||
+            baked.indexOffset + static_cast<uint64_t>(baked.indexCount) * sizeof(uint32_t) > size ||
+            static_cast<uint64_t>(baked.firstTextureRef) + baked.textureRefCount > header.textureRefCount ||
+            baked.lodCount > MAX_MESH_LODS || baked.node >= static_cast<int32_t>(header.nodeCount))
+            return nullptr;
+
+        MeshData& mesh = model->meshes[i];
+        mesh.format = static_cast<VertexFormat>(baked.vertexFormat);
+        mesh.node = baked.node < 0 ? -1 : baked.node;
+        mesh.mappedVertices = data + baked.vertexOffset;
+        mesh.mappedVertexCount = baked.vertexCount;
+        mesh.mappedIndices = reinterpret_cast<const unsigned int*>(data + baked.indexOffset);
+        mesh.mappedIndexCount = baked.indexCount;
+
+        for (uint32_t j = 0; j < baked.lodCount; j++)
+        {
+            const BakedLod& lod = baked.lods[j];
+            if (static_cast<uint64_t>(lod.firstIndex) + lod.indexCount > baked.indexCount)
+                return nullptr;
+            mesh.lods.push_back(MeshLod{ lod.firstIndex, lod.indexCount, lod.error });
+        }
+
+        for (uint32_t j = 0; j < baked.textureRefCount; j++)
+        {
+            uint32_t image = textureRefs[baked.firstTextureRef + j];
+            if (image >= header.imageCount)
+                return nullptr;
+            mesh.textures.push_back(image);
+        }
+
+        mesh.material.diffuseColor = glm::vec3(baked.material.diffuseColor[0], baked.material.diffuseColor[1], baked.material.diffuseColor[2]);
+        mesh.material.specularColor = glm::vec3(baked.material.specularColor[0], baked.material.specularColor[1], baked.material.specularColor[2]);
+        mesh.material.shininess = baked.material.shininess;
+        mesh.material.hasTexture = baked.material.hasTexture != 0;
+
+        mesh.bounds.min = glm::vec3(baked.bounds.min[0], baked.bounds.min[1], baked.bounds.min[2]);
+        mesh.bounds.max = glm::vec3(baked.bounds.max[0], baked.bounds.max[1], baked.bounds.max[2]);
+        mesh.bounds.center = glm::vec3(baked.bounds.center[0], baked.bounds.center[1], baked.bounds.center[2]);
+        mesh.bounds.radius = baked.bounds.radius;
+    }
+
+    model->mapping = mapping;
+    return model;
+}
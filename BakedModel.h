@@ -0,0 +1,28 @@
+// BakedModel.h
+#ifndef BAKED_MODEL_H
+#define BAKED_MODEL_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+struct ModelData;
+
+// Version of the baked file layout; bump whenever the layout or the importer's output changes
+const uint32_t BAKED_MODEL_VERSION = 8;
+
+// Baked files are stored next to the source model with this extension appended
+std::string BakedModelPath(const std::string& modelPath);
+
+// True if the baked file exists and is not older than the source model
+bool IsBakedModelCurrent(const std::string& modelPath, const std::string& bakedPath);
+
+// Writes the imported model as a baked file: vertex/index blobs in each mesh's vertex format, materials,
+// texture references, the scene graph and the encoded bytes of embedded textures
+bool WriteBakedModel(const ModelData& model, const std::string& bakedPath);
+
+// Memory-maps a baked file; the mesh arrays point straight into the mapping.
+// Referenced textures are decoded as well. Returns null if the file is missing, corrupt or of another version.
+std::unique_ptr<ModelData> ReadBakedModel(const std::string& bakedPath, const std::string& modelPath);
+
+#endif // BAKED_MODEL_H
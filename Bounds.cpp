@@ -0,0 +1,81 @@
+// Bounds.cpp
+#include "Bounds.h"
+#include <algorithm>
+#include <cmath>
+
+Bounds ComputeBounds(const glm::vec3* points, size_t count, size_t stride)
+{
+    Bounds bounds;
+    if (count == 0)
+    {
+        bounds.min = bounds.max = bounds.center = glm::vec3(0.0f);
+        bounds.radius = 0.0f;
+        return bounds;
+    }
+
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(points);
+    bounds.min = bounds.max = *points;
+    for (size_t i = 1; i < count; i++)
+    {
+        const glm::vec3& point = *reinterpret_cast<const glm::vec3*>(bytes + i * stride);
+        bounds.min = glm::min(bounds.min, point);
+        bounds.max = glm::max(bounds.max, point);
+    }
+
+    // Sphere around the box center; tighter than half the box diagonal for most meshes
+    bounds.center = (bounds.min + bounds.max) * 0.5f;
+    float radiusSquared = 0.0f;
+    for (size_t i = 0; i < count; i++)
+    {
+        const glm::vec3& point = *reinterpret_cast<const glm::vec3*>(bytes + i * stride);
+        glm::vec3 offset = point - bounds.center;
+        radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+    }
+    bounds.radius = std::sqrt(radiusSquared);
+    return bounds;
+}
+
+Bounds MergeBounds(const Bounds& a, const Bounds& b)
+{
+    Bounds merged;
+    merged.min = glm::min(a.min, b.min);
+    merged.max = glm::max(a.max, b.max);
+    merged.center = (merged.min + merged.max) * 0.5f;
+    // Enclose both spheres around the new center
+    merged.radius = std::max(glm::length(a.center - merged.center) + a.radius,
+                             glm::length(b.center - merged.center) + b.radius);
+    return merged;
+}
+
+bool RayIntersectsBox(const glm::vec3& origin, const glm::vec3& inverseDirection,
+                      const glm::vec3& boxMin, const glm::vec3& boxMax, float maxDistance, float& enter)
+{
+    glm::vec3 t1 = (boxMin - origin) * inverseDirection;
+    glm::vec3 t2 = (boxMax - origin) * inverseDirection;
+    glm::vec3 tNear = glm::min(t1, t2);
+    glm::vec3 tFar = glm::max(t1, t2);
+    enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+    float exit = std::min(std::min(tFar.x, tFar.y), tFar.z);
+    return enter <= exit && enter <= maxDistance;
+}
+
+Bounds TransformBounds(const Bounds& bounds, const glm::mat4& transform)
+{
+    // Box: transform the center and sum the absolute axes scaled by the half extents (Arvo)
+    glm::vec3 boxCenter = (bounds.min + bounds.max) * 0.5f;
+    glm::vec3 halfExtent = (bounds.max - bounds.min) * 0.5f;
+    glm::vec3 newCenter = glm::vec3(transform * glm::vec4(boxCenter, 1.0f));
+    glm::vec3 newExtent =
+        glm::abs(glm::vec3(transform[0])) * halfExtent.x +
+        glm::abs(glm::vec3(transform[1])) * halfExtent.y +
+        glm::abs(glm::vec3(transform[2])) * halfExtent.z;
+
+    Bounds result;
+    result.min = newCenter - newExtent;
+    result.max = newCenter + newExtent;
+    result.center = glm::vec3(transform * glm::vec4(bounds.center, 1.0f));
+    float scale = std::max(glm::length(glm::vec3(transform[0])),
+                  std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+    result.radius = bounds.radius * scale;
+    return result;
+}
@@ -0,0 +1,31 @@
+// Bounds.h
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <glm/glm.hpp>
+
+// Axis-aligned box plus a bounding sphere around the same geometry.
+// Meshes keep them in model space, Model keeps a world-space copy per mesh for culling.
+struct Bounds {
+    glm::vec3 min;
+    glm::vec3 max;
+    glm::vec3 center; // Sphere center (the box center)
+    float radius;
+};
+
+// Bounds of a set of points, stride bytes apart (an empty set gives a zero-size box at the origin)
+Bounds ComputeBounds(const glm::vec3* points, size_t count, size_t stride);
+
+// Smallest bounds enclosing both
+Bounds MergeBounds(const Bounds& a, const Bounds& b);
+
+// Bounds of the geometry after applying an affine transform. The box is the exact box of the
+// transformed box and the sphere radius grows by the largest axis scale.
+Bounds TransformBounds(const Bounds& bounds, const glm::mat4& transform);
+
+// Slab test: distance along the ray (in units of the direction) to where it enters the box.
+// False if it misses or enters beyond maxDistance. Takes 1 / direction.
+bool RayIntersectsBox(const glm::vec3& origin, const glm::vec3& inverseDirection,
+                      const glm::vec3& boxMin, const glm::vec3& boxMax, float maxDistance, float& enter);
+
+#endif // BOUNDS_H
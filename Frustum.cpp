@@ -0,0 +1,130 @@
+// Frustum.cpp
+#include "Frustum.h"
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FRUSTUM_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+Frustum::Frustum(const glm::mat4& m)
+{
+    // Gribb/Hartmann: each plane is the fourth row plus or minus one of the others
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+    planes[0] = row3 + row0; // Left
+    planes[1] = row3 - row0; // Right
+    planes[2] = row3 + row1; // Bottom
+    planes[3] = row3 - row1; // Top
+    planes[4] = row3 + row2; // Near
+    planes[5] = row3 - row2; // Far
+    for (glm::vec4& plane : planes)
+        plane /= glm::length(glm::vec3(plane));
+}
+
+bool Frustum::Intersects(const Bounds& bounds) const
+{
+    glm::vec3 boxCenter = (bounds.min + bounds.max) * 0.5f;
+    glm::vec3 halfExtent = (bounds.max - bounds.min) * 0.5f;
+    for (const glm::vec4& plane : planes)
+    {
+        glm::vec3 normal(plane);
+        // Sphere first, then the box's projected radius onto the plane normal
+        if (glm::dot(normal, bounds.center) + plane.w < -bounds.radius)
+            return false;
+        float boxRadius = glm::dot(glm::abs(normal), halfExtent);
+        if (glm::dot(normal, boxCenter) + plane.w < -boxRadius)
+            return false;
+    }
+    return true;
+}
+
+int Frustum::ClassifyBox(const glm::vec3& boxMin, const glm::vec3& boxMax, unsigned int& planeMask) const
+{
+    glm::vec3 boxCenter = (boxMin + boxMax) * 0.5f;
+    glm::vec3 halfExtent = (boxMax - boxMin) * 0.5f;
+    for (int i = 0; i < 6; i++)
+    {
+        if (!(planeMask & (1u << i)))
+            continue;
+        glm::vec3 normal(planes[i]);
+        float distance = glm::dot(normal, boxCenter) + planes[i].w;
+        float boxRadius = glm::dot(glm::abs(normal), halfExtent);
+        if (distance < -boxRadius)
+            return -1;
+        if (distance >= boxRadius)
+            planeMask &= ~(1u << i);
+    }
+    return 1;
+}
+
+size_t Frustum::Cull(const Bounds* bounds, size_t count, unsigned char* visible) const
+{
+    size_t visibleCount = 0;
+    size_t i = 0;
+
+#ifdef FRUSTUM_USE_SSE
+    // Transpose four bounds into SoA registers and test them against each plane together
+    for (; i + 4 <= count; i += 4)
+    {
+        const Bounds& b0 = bounds[i];
+        const Bounds& b1 = bounds[i + 1];
+        const Bounds& b2 = bounds[i + 2];
+        const Bounds& b3 = bounds[i + 3];
+        const __m128 half = _mm_set1_ps(0.5f);
+        __m128 minX = _mm_setr_ps(b0.min.x, b1.min.x, b2.min.x, b3.min.x);
+        __m128 minY = _mm_setr_ps(b0.min.y, b1.min.y, b2.min.y, b3.min.y);
+        __m128 minZ = _mm_setr_ps(b0.min.z, b1.min.z, b2.min.z, b3.min.z);
+        __m128 maxX = _mm_setr_ps(b0.max.x, b1.max.x, b2.max.x, b3.max.x);
+        __m128 maxY = _mm_setr_ps(b0.max.y, b1.max.y, b2.max.y, b3.max.y);
+        __m128 maxZ = _mm_setr_ps(b0.max.z, b1.max.z, b2.max.z, b3.max.z);
+        __m128 boxX = _mm_mul_ps(_mm_add_ps(minX, maxX), half);
+        __m128 boxY = _mm_mul_ps(_mm_add_ps(minY, maxY), half);
+        __m128 boxZ = _mm_mul_ps(_mm_add_ps(minZ, maxZ), half);
+        __m128 extentX = _mm_mul_ps(_mm_sub_ps(maxX, minX), half);
+        __m128 extentY = _mm_mul_ps(_mm_sub_ps(maxY, minY), half);
+        __m128 extentZ = _mm_mul_ps(_mm_sub_ps(maxZ, minZ), half);
+        __m128 sphereX = _mm_setr_ps(b0.center.x, b1.center.x, b2.center.x, b3.center.x);
+        __m128 sphereY = _mm_setr_ps(b0.center.y, b1.center.y, b2.center.y, b3.center.y);
+        __m128 sphereZ = _mm_setr_ps(b0.center.z, b1.center.z, b2.center.z, b3.center.z);
+        __m128 negRadius = _mm_setr_ps(-b0.radius, -b1.radius, -b2.radius, -b3.radius);
+
+        __m128 outside = _mm_setzero_ps();
+        for (const glm::vec4& plane : planes)
+        {
+            __m128 nx = _mm_set1_ps(plane.x);
+            __m128 ny = _mm_set1_ps(plane.y);
+            __m128 nz = _mm_set1_ps(plane.z);
+            __m128 d = _mm_set1_ps(plane.w);
+
+            __m128 sphereDistance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, sphereX), _mm_mul_ps(ny, sphereY)),
+                                               _mm_add_ps(_mm_mul_ps(nz, sphereZ), d));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(sphereDistance, negRadius));
+
+            __m128 boxDistance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, boxX), _mm_mul_ps(ny, boxY)),
+                                            _mm_add_ps(_mm_mul_ps(nz, boxZ), d));
+            __m128 boxRadius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(std::fabs(plane.x)), extentX),
+                                                     _mm_mul_ps(_mm_set1_ps(std::fabs(plane.y)), extentY)),
+                                          _mm_mul_ps(_mm_set1_ps(std::fabs(plane.z)), extentZ));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(boxDistance, boxRadius), _mm_setzero_ps()));
+        }
+
+        int mask = _mm_movemask_ps(outside);
+        for (int lane = 0; lane < 4; lane++)
+        {
+            unsigned char inside = (mask & (1 << lane)) ? 0 : 1;
+            visible[i + lane] = inside;
+            visibleCount += inside;
+        }
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        visible[i] = Intersects(bounds[i]) ? 1 : 0;
+        visibleCount += visible[i];
+    }
+    return visibleCount;
+}
@@ -0,0 +1,39 @@
+// Frustum.h
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include "Bounds.h"
+
+// Per-frame culling counters, shown in the Scene window
+struct CullStats {
+    size_t modelsVisible = 0;
+    size_t modelsCulled = 0;
+    size_t meshesVisible = 0;
+    size_t meshesCulled = 0;
+};
+
+// View frustum as six inward-facing planes (xyz = normal, w = distance), in world space
+// when built from projection * view.
+class Frustum
+{
+public:
+    glm::vec4 planes[6];
+
+    // Extracts the planes from a combined projection * view matrix
+    explicit Frustum(const glm::mat4& viewProjection);
+
+    // True unless the bounds are entirely outside one of the planes
+    bool Intersects(const Bounds& bounds) const;
+
+    // Classifies a box against the planes whose bits are set in planeMask. Returns -1 if it is
+    // outside one of them; otherwise clears the bits of planes it is fully inside and returns 1.
+    int ClassifyBox(const glm::vec3& boxMin, const glm::vec3& boxMax, unsigned int& planeMask) const;
+
+    // Tests an array of bounds, four at a time with SSE where available.
+    // Writes 1 (visible) or 0 (culled) per entry and returns the number visible.
+    size_t Cull(const Bounds* bounds, size_t count, unsigned char* visible) const;
+};
+
+#endif // FRUSTUM_H
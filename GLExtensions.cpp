@@ -0,0 +1,40 @@
+// GLExtensions.cpp
+#include "GLExtensions.h"
+#include <cstring>
+#include <iostream>
+
+GLExtensions glExtensions = {};
+
+bool HasGLExtension(const char* name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+    {
+        const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (extension && std::strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+void LoadGLExtensions(GLADloadproc load)
+{
+    glExtensions = GLExtensions();
+    glGetIntegerv(GL_MAJOR_VERSION, &glExtensions.majorVersion);
+    glGetIntegerv(GL_MINOR_VERSION, &glExtensions.minorVersion);
+    int version = glExtensions.majorVersion * 10 + glExtensions.minorVersion;
+
+    if (version >= 43 || HasGLExtension("GL_ARB_multi_draw_indirect"))
+        glExtensions.MultiDrawElementsIndirect = (PFNMULTIDRAWELEMENTSINDIRECTPROC)load("glMultiDrawElementsIndirect");
+    glExtensions.multiDrawIndirect = glExtensions.MultiDrawElementsIndirect != nullptr;
+    glExtensions.textureCompressionS3TC = HasGLExtension("GL_EXT_texture_compression_s3tc");
+    if (version >= 44 || HasGLExtension("GL_ARB_buffer_storage"))
+        glExtensions.BufferStorage = (PFNBUFFERSTORAGEPROC)load("glBufferStorage");
+    glExtensions.bufferStorage = glExtensions.BufferStorage != nullptr;
+
+    std::cout << "OpenGL " << glExtensions.majorVersion << "." << glExtensions.minorVersion
+        << (glExtensions.multiDrawIndirect ? ", multi-draw indirect" : ", no multi-draw indirect")
+        << (glExtensions.textureCompressionS3TC ? ", S3TC" : ", no S3TC")
+        << (glExtensions.bufferStorage ? ", buffer storage" : ", no buffer storage") << std::endl;
+}
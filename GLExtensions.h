@@ -0,0 +1,45 @@
+// GLExtensions.h
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+#include <glad/glad.h> // Holds all OpenGL type declarations
+
+// glad is generated for 3.3 core; newer entry points used when the driver offers them are declared here
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+typedef void (APIENTRYP PFNMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride);
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+typedef void (APIENTRYP PFNBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+// Optional GL features, filled in by LoadGLExtensions
+struct GLExtensions {
+    int majorVersion;
+    int minorVersion;
+
+    // GL 4.3 or ARB_multi_draw_indirect
+    bool multiDrawIndirect;
+    PFNMULTIDRAWELEMENTSINDIRECTPROC MultiDrawElementsIndirect;
+
+    // EXT_texture_compression_s3tc (BC1-BC3), not core in any version
+    bool textureCompressionS3TC;
+
+    // GL 4.4 or ARB_buffer_storage: immutable buffers that can stay mapped while the GPU reads them
+    bool bufferStorage;
+    PFNBUFFERSTORAGEPROC BufferStorage;
+};
+
+extern GLExtensions glExtensions;
+
+// Queries the context version and extensions and loads the optional entry points; call after gladLoadGLLoader
+void LoadGLExtensions(GLADloadproc load);
+
+// True if the current context advertises the named extension
+bool HasGLExtension(const char* name);
+
+#endif // GL_EXTENSIONS_H
@@ -0,0 +1,69 @@
+// GLResource.h
+#ifndef GL_RESOURCE_H
+#define GL_RESOURCE_H
+
+#include <glad/glad.h> // Holds all OpenGL type declarations
+
+// Creation/deletion functions for each kind of GL object
+struct GLVertexArrayTraits {
+    static GLuint Create() { GLuint id; glGenVertexArrays(1, &id); return id; }
+    static void Delete(GLuint id) { glDeleteVertexArrays(1, &id); }
+};
+
+struct GLBufferTraits {
+    static GLuint Create() { GLuint id; glGenBuffers(1, &id); return id; }
+    static void Delete(GLuint id) { glDeleteBuffers(1, &id); }
+};
+
+struct GLTextureTraits {
+    static GLuint Create() { GLuint id; glGenTextures(1, &id); return id; }
+    static void Delete(GLuint id) { glDeleteTextures(1, &id); }
+};
+
+// Move-only owner of a single GL object name; the object is deleted when the owner goes away.
+template <typename Traits>
+class GLObject
+{
+public:
+    GLObject() : id(0) {}
+    explicit GLObject(GLuint id) : id(id) {}
+    ~GLObject() { reset(); }
+
+    GLObject(const GLObject&) = delete;
+    GLObject& operator=(const GLObject&) = delete;
+
+    GLObject(GLObject&& other) noexcept : id(other.id) { other.id = 0; }
+    GLObject& operator=(GLObject&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            id = other.id;
+            other.id = 0;
+        }
+        return *this;
+    }
+
+    // Generates a new object name
+    static GLObject Create() { return GLObject(Traits::Create()); }
+
+    // Deletes the owned object, if any
+    void reset()
+    {
+        if (id != 0)
+            Traits::Delete(id);
+        id = 0;
+    }
+
+    GLuint get() const { return id; }
+    operator GLuint() const { return id; }
+
+private:
+    GLuint id;
+};
+
+typedef GLObject<GLVertexArrayTraits> GLVertexArray;
+typedef GLObject<GLBufferTraits> GLBuffer;
+typedef GLObject<GLTextureTraits> GLTexture;
+
+#endif // GL_RESOURCE_H
@@ -0,0 +1,112 @@
+// InstanceBatcher.cpp
+#include "InstanceBatcher.h"
+#include <algorithm>
+
+InstanceBatcher::InstanceBatcher()
+    : drawCalls(0), instanceDraws(0), triangles(0), fullDetailTriangles(0), capacity(0)
+{
+    buffer = GLBuffer::Create();
+}
+
+void InstanceBatcher::Add(const Model& model)
+{
+    const std::vector<unsigned char>& visible = model.MeshVisibility();
+    const std::vector<unsigned char>& lods = model.MeshLods();
+    const std::vector<int32_t>& meshNodes = model.asset->meshNodes;
+
+    // One instance for the model and one for each scene graph node with visible meshes
+    nodeInstances.assign(model.asset->nodes.Size() + 1, NO_INSTANCE);
+    for (size_t i = 0; i < visible.size(); i++)
+    {
+        if (!visible[i])
+            continue;
+        int32_t node = i < meshNodes.size() ? meshNodes[i] : -1;
+        uint32_t& instance = nodeInstances[node + 1];
+        if (instance == NO_INSTANCE)
+        {
+            instance = static_cast<uint32_t>(instances.size());
+            InstanceData data;
+            data.model = model.MeshMatrix(i);
+            const glm::mat3& normalMatrix = model.MeshNormalMatrix(i);
+            for (int column = 0; column < 3; column++)
+                data.normalMatrix[column] = glm::vec4(normalMatrix[column], 1.0f);
+            instances.push_back(data);
+        }
+        uint32_t lod = i < lods.size() ? lods[i] : 0;
+        entries.push_back(Entry{ &model.asset->meshes[i], lod, instance });
+    }
+}
+
+void InstanceBatcher::Flush(RenderQueue& queue, const MeshProgram programs[VERTEX_FORMAT_COUNT], const glm::mat4& view, float zFar)
+{
+    drawCalls = 0;
+    instanceDraws = entries.size();
+    triangles = 0;
+    fullDetailTriangles = 0;
+    if (entries.empty())
+    {
+        instances.clear();
+        return;
+    }
+
+    // Group by mesh and level, keeping instances in the order their models were added
+    std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b)
+    {
+        return a.mesh != b.mesh ? a.mesh < b.mesh : a.lod < b.lod;
+    });
+    uploadData.resize(entries.size());
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        const Mesh* mesh = entries[i].mesh;
+        triangles += mesh->lods[entries[i].lod].indexCount / 3;
+        fullDetailTriangles += mesh->lods[0].indexCount / 3;
+        InstanceData& data = uploadData[i];
+        data = instances[entries[i].instance];
+        if (mesh->Format() == VERTEX_FORMAT_PACKED)
+        {
+            // Quantized positions: the bounds offset goes into the model matrix, the scale into the spare w's
+            data.model[3] = data.model * glm::vec4(mesh->positionOffset, 1.0f);
+            for (int column = 0; column < 3; column++)
+                data.normalMatrix[column].w = mesh->positionScale[column];
+        }
+    }
+
+    GLsizeiptr size = static_cast<GLsizeiptr>(uploadData.size() * sizeof(InstanceData));
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    if (size > capacity)
+        capacity = std::max(size, capacity * 2);
+    glBufferData(GL_ARRAY_BUFFER, capacity, NULL, GL_STREAM_DRAW); // Grow or orphan
+    glBufferSubData(GL_ARRAY_BUFFER, 0, size, uploadData.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // One packet per mesh and level, placed by its nearest instance
+    for (size_t first = 0; first < entries.size();)
+    {
+        const Mesh* mesh = entries[first].mesh;
+        uint32_t lod = entries[first].lod;
+        float depth = zFar;
+        size_t last = first;
+        for (; last < entries.size() && entries[last].mesh == mesh && entries[last].lod == lod; last++)
+        {
+            glm::vec4 center = view * (instances[entries[last].instance].model * glm::vec4(mesh->bounds.center, 1.0f));
+            depth = std::min(depth, -center.z);
+        }
+
+        const MeshProgram& program = programs[mesh->Format()];
+        DrawPacket packet;
+        packet.key = RenderQueue::MakeKey(program.shader->ID, mesh->materialKey, mesh->textureKey, mesh->GeometryKey(), depth / zFar);
+        packet.mesh = mesh;
+        packet.lod = lod;
+        packet.shader = program.shader;
+        packet.uniforms = program.uniforms;
+        packet.instanceBuffer = buffer;
+        packet.instanceOffset = static_cast<GLintptr>(first * sizeof(InstanceData));
+        packet.instanceCount = static_cast<GLsizei>(last - first);
+        queue.Push(packet);
+        drawCalls++;
+        first = last;
+    }
+
+    entries.clear();
+    instances.clear();
+}
@@ -0,0 +1,54 @@
+// InstanceBatcher.h
+#ifndef INSTANCE_BATCHER_H
+#define INSTANCE_BATCHER_H
+
+#include <glad/glad.h> // Holds all OpenGL type declarations
+#include <cstdint>
+#include <vector>
+#include "GLResource.h"
+#include "Mesh.h"
+#include "Model.h"
+#include "RenderQueue.h"
+
+// Collects the visible meshes of every model in a frame and turns each mesh into one instanced draw
+// packet for all of its instances, one per level of detail in use. Models loaded from the same file share their meshes through
+// the AssetCache, so repeated models collapse into one draw per mesh.
+class InstanceBatcher
+{
+public:
+    // Packets made by the last Flush, and how many draws it would have taken to draw each instance on its own
+    size_t drawCalls;
+    size_t instanceDraws;
+    // Triangles the last Flush drew, and how many drawing every instance at full detail would have taken
+    size_t triangles;
+    size_t fullDetailTriangles;
+
+    InstanceBatcher();
+
+    // Queues the meshes of a model that passed Model::Cull, at the levels from Model::SelectLods
+    void Add(const Model& model);
+
+    // Uploads the instance transforms and pushes one packet per queued mesh and level, then clears the batch.
+    // Each mesh is drawn with the program for its vertex format; packets are keyed front to back
+    // using the view matrix and far plane.
+    void Flush(RenderQueue& queue, const MeshProgram programs[VERTEX_FORMAT_COUNT], const glm::mat4& view, float zFar);
+
+private:
+    struct Entry {
+        const Mesh* mesh;
+        uint32_t lod;
+        uint32_t instance; // Index into instances
+    };
+
+    static constexpr uint32_t NO_INSTANCE = 0xFFFFFFFFu;
+
+    std::vector<InstanceData> instances; // One per added model and scene graph node in use
+    std::vector<uint32_t> nodeInstances; // Instance of each node of the model being added (the model itself first)
+    std::vector<Entry> entries;          // One per visible mesh
+    std::vector<InstanceData> uploadData; // Instances regrouped so each mesh and level's are contiguous
+
+    GLBuffer buffer;
+    GLsizeiptr capacity;
+};
+
+#endif // INSTANCE_BATCHER_H
@@ -3,6 +3,15 @@
 #define LIGHT_H
 
 #include <glm/glm.hpp>
+#include <limits>
+
+// Range of new lights
+const float DEFAULT_LIGHT_RADIUS = 50.0f;
+
+// Radius of lights with no falloff. Scenes saved before lights had a radius were lit without any
+// attenuation, so their lights load with this one; they light every cluster and are saved without
+// a radius.
+const float UNBOUNDED_LIGHT_RADIUS = std::numeric_limits<float>::infinity();
 
 struct Light {
     glm::vec3 position;
@@ -10,6 +19,7 @@ struct Light {
     glm::vec3 scale;
     glm::vec3 color;
     float intensity;
+    float radius; // Distance at which the light's contribution reaches zero; UNBOUNDED_LIGHT_RADIUS for no falloff
 };
 
 #endif // LIGHT_H
@@ -0,0 +1,283 @@
+// LightClusters.cpp
+#include "LightClusters.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Below this many lights the per-slice jobs cost more than they save
+const size_t PARALLEL_LIGHT_THRESHOLD = 64;
+
+LightClusterGrid::LightClusterGrid()
+    : maxLightIndices(std::numeric_limits<size_t>::max()), maxLightsPerCluster(0), droppedLightIndices(0),
+      boundsProjection(0.0f), boundsNear(0.0f), boundsFar(0.0f)
+{
+}
+
+unsigned int LightClusterGrid::SliceForDepth(float depth, float zNear, float zFar)
+{
+    if (depth <= zNear)
+        return 0;
+    float slice = std::floor(std::log(depth / zNear) / std::log(zFar / zNear) * CLUSTER_Z);
+    return static_cast<unsigned int>(std::min(slice, static_cast<float>(CLUSTER_Z - 1)));
+}
+
+void LightClusterGrid::ClusterBounds(unsigned int cluster, glm::vec3& clusterMin, glm::vec3& clusterMax) const
+{
+    clusterMin = boundsMin[cluster];
+    clusterMax = boundsMax[cluster];
+}
+
+bool LightClusterGrid::SphereIntersectsBox(const glm::vec3& center, float radius, const glm::vec3& boxMin, const glm::vec3& boxMax)
+{
+    glm::vec3 closest = glm::clamp(center, boxMin, boxMax);
+    glm::vec3 offset = center - closest;
+    return glm::dot(offset, offset) <= radius * radius;
+}
+
+void LightClusterGrid::updateBounds(const ClusterCamera& camera)
+{
+    if (!boundsMin.empty() && camera.projection == boundsProjection &&
+        camera.zNear == boundsNear && camera.zFar == boundsFar)
+        return;
+
+    boundsProjection = camera.projection;
+    boundsNear = camera.zNear;
+    boundsFar = camera.zFar;
+    boundsMin.resize(CLUSTER_COUNT);
+    boundsMax.resize(CLUSTER_COUNT);
+
+    // View-space x at depth d for a given NDC x is ndc * d / P[0][0] (likewise for y)
+    float scaleX = 1.0f / camera.projection[0][0];
+    float scaleY = 1.0f / camera.projection[1][1];
+    float depthRatio = camera.zFar / camera.zNear;
+    for (unsigned int z = 0; z < CLUSTER_Z; z++)
+    {
+        float nearDepth = camera.zNear * std::pow(depthRatio, static_cast<float>(z) / CLUSTER_Z);
+        float farDepth = camera.zNear * std::pow(depthRatio, static_cast<float>(z + 1) / CLUSTER_Z);
+        for (unsigned int y = 0; y < CLUSTER_Y; y++)
+        {
+            float bottom = -1.0f + 2.0f * y / CLUSTER_Y;
+            float top = -1.0f + 2.0f * (y + 1) / CLUSTER_Y;
+            for (unsigned int x = 0; x < CLUSTER_X; x++)
+            {
+                float left = -1.0f + 2.0f * x / CLUSTER_X;
+                float right = -1.0f + 2.0f * (x + 1) / CLUSTER_X;
+                unsigned int cluster = x + CLUSTER_X * (y + CLUSTER_Y * z);
+                boundsMin[cluster] = glm::vec3(
+                    std::min(left * nearDepth, left * farDepth) * scaleX,
+                    std::min(bottom * nearDepth, bottom * farDepth) * scaleY,
+                    -farDepth);
+                boundsMax[cluster] = glm::vec3(
+                    std::max(right * nearDepth, right * farDepth) * scaleX,
+                    std::max(top * nearDepth, top * farDepth) * scaleY,
+                    -nearDepth);
+            }
+        }
+    }
+}
+
+void LightClusterGrid::buildSlice(unsigned int slice)
+{
+    const unsigned int sliceSize = CLUSTER_X * CLUSTER_Y;
+    const unsigned int base = slice * sliceSize;
+    std::vector<glm::uvec2>& pairs = slicePairs[slice];
+    pairs.clear();
+
+    // Every cluster in a slice shares its depth range, every row its y range and every column its x range
+    float sliceMinZ = boundsMin[base].z;
+    float sliceMaxZ = boundsMax[base].z;
+    for (size_t i = 0; i < ranges.size(); i++)
+    {
+        const LightRange& range = ranges[i];
+        int s = static_cast<int>(slice);
+        if (s < range.firstSlice || s > range.lastSlice)
+            continue;
+        if (range.center.z - range.radius > sliceMaxZ || range.center.z + range.radius < sliceMinZ)
+            continue;
+
+        unsigned int firstX = CLUSTER_X, lastX = 0;
+        for (unsigned int x = 0; x < CLUSTER_X; x++)
+        {
+            if (range.center.x + range.radius >= boundsMin[base + x].x &&
+                range.center.x - range.radius <= boundsMax[base + x].x)
+            {
+                firstX = std::min(firstX, x);
+                lastX = x;
+            }
+        }
+        if (firstX > lastX)
+            continue;
+
+        for (unsigned int y = 0; y < CLUSTER_Y; y++)
+        {
+            unsigned int row = base + y * CLUSTER_X;
+            if (range.center.y + range.radius < boundsMin[row].y ||
+                range.center.y - range.radius > boundsMax[row].y)
+                continue;
+            for (unsigned int x = firstX; x <= lastX; x++)
+            {
+                if (SphereIntersectsBox(range.center, range.radius, boundsMin[row + x], boundsMax[row + x]))
+                    pairs.push_back(glm::uvec2(y * CLUSTER_X + x, static_cast<unsigned int>(i)));
+            }
+        }
+    }
+
+    // Counting sort by cluster; pairs are already in light order so each list comes out ascending
+    for (unsigned int c = 0; c < sliceSize; c++)
+        clusters[base + c] = glm::uvec2(0);
+    for (const glm::uvec2& pair : pairs)
+        clusters[base + pair.x].y++;
+    unsigned int offset = 0;
+    for (unsigned int c = 0; c < sliceSize; c++)
+    {
+        clusters[base + c].x = offset;
+        offset += clusters[base + c].y;
+    }
+    std::vector<uint32_t>& indices = sliceIndices[slice];
+    indices.resize(pairs.size());
+    std::vector<unsigned int> cursor(sliceSize);
+    for (unsigned int c = 0; c < sliceSize; c++)
+        cursor[c] = clusters[base + c].x;
+    for (const glm::uvec2& pair : pairs)
+        indices[cursor[pair.x]++] = pair.y;
+}
+
+void LightClusterGrid::Build(const std::vector<Light>& lights, const ClusterCamera& camera, ThreadPool* pool)
+{
+    updateBounds(camera);
+    clusters.resize(CLUSTER_COUNT + 1);
+    slicePairs.resize(CLUSTER_Z);
+    sliceIndices.resize(CLUSTER_Z);
+    ranges.resize(lights.size());
+    if (lights.size() < PARALLEL_LIGHT_THRESHOLD)
+        pool = nullptr;
+
+    // View-space spheres and the slices each one can reach (one slice of slack either side
+    // so rounding in SliceForDepth never hides a cluster the box test would accept)
+    auto computeRanges = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            LightRange& range = ranges[i];
+            range.center = glm::vec3(camera.view * glm::vec4(lights[i].position, 1.0f));
+            range.radius = std::max(lights[i].radius, 0.0f);
+            float depth = -range.center.z;
+            if (!std::isfinite(range.radius) || depth + range.radius < camera.zNear || depth - range.radius > camera.zFar)
+            {
+                range.firstSlice = 0;
+                range.lastSlice = -1;
+                continue;
+            }
+            int first = static_cast<int>(SliceForDepth(std::max(depth - range.radius, camera.zNear), camera.zNear, camera.zFar));
+            int last = static_cast<int>(SliceForDepth(std::min(depth + range.radius, camera.zFar), camera.zNear, camera.zFar));
+            range.firstSlice = std::max(first - 1, 0);
+            range.lastSlice = std::min(last + 1, static_cast<int>(CLUSTER_Z) - 1);
+        }
+    };
+    auto buildSlices = [&](size_t begin, size_t end) {
+        for (size_t slice = begin; slice < end; slice++)
+            buildSlice(static_cast<unsigned int>(slice));
+    };
+    if (pool)
+    {
+        pool->ParallelFor(lights.size(), 256, computeRanges);
+        pool->ParallelFor(CLUSTER_Z, 1, buildSlices);
+    }
+    else
+    {
+        computeRanges(0, lights.size());
+        buildSlices(0, CLUSTER_Z);
+    }
+
+    // Unbounded lights first, so they are never the ones dropped
+    lightIndices.clear();
+    for (size_t i = 0; i < lights.size(); i++)
+    {
+        if (!std::isfinite(lights[i].radius))
+            lightIndices.push_back(static_cast<uint32_t>(i));
+    }
+    clusters[CLUSTER_COUNT] = glm::uvec2(0, static_cast<unsigned int>(lightIndices.size()));
+
+    // Stitch the per-slice lists together
+    maxLightsPerCluster = 0;
+    droppedLightIndices = 0;
+    for (unsigned int slice = 0; slice < CLUSTER_Z; slice++)
+    {
+        const std::vector<uint32_t>& indices = sliceIndices[slice];
+        size_t sliceBase = lightIndices.size();
+        size_t room = maxLightIndices > sliceBase ? maxLightIndices - sliceBase : 0;
+        size_t kept = std::min(indices.size(), room);
+        droppedLightIndices += indices.size() - kept;
+        lightIndices.insert(lightIndices.end(), indices.begin(), indices.begin() + kept);
+
+        for (unsigned int c = 0; c < CLUSTER_X * CLUSTER_Y; c++)
+        {
+            glm::uvec2& cluster = clusters[slice * CLUSTER_X * CLUSTER_Y + c];
+            size_t first = cluster.x;
+            size_t count = first < kept ? std::min<size_t>(cluster.y, kept - first) : 0;
+            cluster = glm::uvec2(static_cast<unsigned int>(sliceBase + first), static_cast<unsigned int>(count));
+            maxLightsPerCluster = std::max<size_t>(maxLightsPerCluster, count);
+        }
+    }
+}
+
+ClusteredLightBuffers::ClusteredLightBuffers()
+{
+    GLint maxTexels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+    maxLightIndices = static_cast<size_t>(maxTexels);
+
+    create(lightData, GL_RGBA32F);
+    create(clusterData, GL_RG32UI);
+    create(indexData, GL_R32UI);
+}
+
+void ClusteredLightBuffers::create(TextureBuffer& target, GLenum format)
+{
+    // Start with a small non-empty store so the texture is always complete
+    target.buffer = GLBuffer::Create();
+    target.texture = GLTexture::Create();
+    target.capacity = 16;
+    glBindBuffer(GL_TEXTURE_BUFFER, target.buffer);
+    glBufferData(GL_TEXTURE_BUFFER, target.capacity, NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_BUFFER, target.texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, format, target.buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+void ClusteredLightBuffers::upload(TextureBuffer& target, const void* data, GLsizeiptr size)
+{
+    if (size == 0)
+        return;
+    glBindBuffer(GL_TEXTURE_BUFFER, target.buffer);
+    if (size > target.capacity)
+        target.capacity = std::max(size, target.capacity * 2);
+    glBufferData(GL_TEXTURE_BUFFER, target.capacity, NULL, GL_STREAM_DRAW); // Grow or orphan
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void ClusteredLightBuffers::Upload(const std::vector<Light>& lights, const LightClusterGrid& grid)
+{
+    lightTexels.resize(lights.size() * 2);
+    for (size_t i = 0; i < lights.size(); i++)
+    {
+        lightTexels[i * 2] = glm::vec4(lights[i].position, lights[i].radius);
+        lightTexels[i * 2 + 1] = glm::vec4(lights[i].color * lights[i].intensity, 0.0f);
+    }
+    upload(lightData, lightTexels.data(), lightTexels.size() * sizeof(glm::vec4));
+    upload(clusterData, grid.clusters.data(), grid.clusters.size() * sizeof(glm::uvec2));
+    upload(indexData, grid.lightIndices.data(), grid.lightIndices.size() * sizeof(uint32_t));
+}
+
+void ClusteredLightBuffers::Bind(GLuint firstUnit) const
+{
+    glActiveTexture(GL_TEXTURE0 + firstUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, lightData.texture);
+    glActiveTexture(GL_TEXTURE0 + firstUnit + 1);
+    glBindTexture(GL_TEXTURE_BUFFER, clusterData.texture);
+    glActiveTexture(GL_TEXTURE0 + firstUnit + 2);
+    glBindTexture(GL_TEXTURE_BUFFER, indexData.texture);
+    glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,116 @@
+// LightClusters.h
+#ifndef LIGHT_CLUSTERS_H
+#define LIGHT_CLUSTERS_H
+
+#include <glad/glad.h> // Holds all OpenGL type declarations
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "GLResource.h"
+#include "Light.h"
+
+class ThreadPool;
+
+// Froxel grid size; must match CLUSTER_X/Y/Z in fragment_shader.glsl
+const unsigned int CLUSTER_X = 16;
+const unsigned int CLUSTER_Y = 9;
+const unsigned int CLUSTER_Z = 24;
+const unsigned int CLUSTER_COUNT = CLUSTER_X * CLUSTER_Y * CLUSTER_Z;
+
+// Camera the clusters are built for. The projection must be a symmetric perspective one.
+struct ClusterCamera {
+    glm::mat4 view;
+    glm::mat4 projection;
+    float zNear;
+    float zFar;
+};
+
+// Assigns point lights to the view-space clusters (froxels) their sphere of influence touches.
+// Tiles split the screen evenly, slices split view depth exponentially between zNear and zFar.
+// Clusters are numbered x + CLUSTER_X * (y + CLUSTER_Y * z), the same as in the shader.
+// Lights with an unbounded radius are not assigned to clusters; they are listed once instead.
+class LightClusterGrid
+{
+public:
+    // (first entry in lightIndices, light count) per cluster, then one more entry at CLUSTER_COUNT
+    // for the unbounded lights, which every fragment applies
+    std::vector<glm::uvec2> clusters;
+    // Light indices of every cluster, back to back, ascending within a cluster
+    std::vector<uint32_t> lightIndices;
+
+    // Assignments beyond this are dropped (texture buffers have a size limit)
+    size_t maxLightIndices;
+    // Stats from the last Build
+    size_t maxLightsPerCluster;
+    size_t droppedLightIndices;
+
+    LightClusterGrid();
+
+    // Rebuilds the lists for this frame. Slices are shared out over the pool when one is given.
+    void Build(const std::vector<Light>& lights, const ClusterCamera& camera, ThreadPool* pool);
+
+    // Slice a view depth (distance in front of the camera) falls into; matches the shader
+    static unsigned int SliceForDepth(float depth, float zNear, float zFar);
+
+    // View-space bounding box of a cluster, valid after Build
+    void ClusterBounds(unsigned int cluster, glm::vec3& boundsMin, glm::vec3& boundsMax) const;
+
+    // True if a sphere touches an axis-aligned box
+    static bool SphereIntersectsBox(const glm::vec3& center, float radius, const glm::vec3& boxMin, const glm::vec3& boxMax);
+
+private:
+    // A light's view-space sphere and the slices it may reach
+    struct LightRange {
+        glm::vec3 center;
+        float radius;
+        int firstSlice;
+        int lastSlice; // < firstSlice if the light cannot touch any cluster
+    };
+
+    // One entry per cluster
+    std::vector<glm::vec3> boundsMin;
+    std::vector<glm::vec3> boundsMax;
+    glm::mat4 boundsProjection;
+    float boundsNear, boundsFar;
+
+    std::vector<LightRange> ranges;
+    // Per slice: (cluster within slice, light) pairs, then the sorted light indices
+    std::vector<std::vector<glm::uvec2>> slicePairs;
+    std::vector<std::vector<uint32_t>> sliceIndices;
+
+    void updateBounds(const ClusterCamera& camera);
+    void buildSlice(unsigned int slice);
+};
+
+// Texture buffers feeding the clustered light lists to fragment_shader.glsl.
+// Uses texture buffers rather than storage buffers so it runs on the GL 3.3 context.
+class ClusteredLightBuffers
+{
+public:
+    // Largest index list a texture buffer can hold on this driver
+    size_t maxLightIndices;
+
+    ClusteredLightBuffers();
+
+    // Uploads light data ((position, radius), (color * intensity, 0) per light) and the grid's lists
+    void Upload(const std::vector<Light>& lights, const LightClusterGrid& grid);
+
+    // Binds the three buffers to consecutive texture units starting at firstUnit
+    // (samplers lightData, lightClusters, lightIndices)
+    void Bind(GLuint firstUnit) const;
+
+private:
+    struct TextureBuffer {
+        GLBuffer buffer;
+        GLTexture texture;
+        GLsizeiptr capacity = 0;
+    };
+
+    TextureBuffer lightData, clusterData, indexData;
+    std::vector<glm::vec4> lightTexels;
+
+    static void create(TextureBuffer& target, GLenum format);
+    static void upload(TextureBuffer& target, const void* data, GLsizeiptr size);
+};
+
+#endif // LIGHT_CLUSTERS_H
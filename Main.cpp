@@ -17,12 +17,33 @@
 #include "Light.h"
 #include "Camera.h"
 #include "Model.h"
+#include "AssetCache.h"
+#include "TextureCache.h"
+#include "TextureStreaming.h"
+#include "PixelBufferRing.h"
+#include "ModelLoader.h"
+#include "Tools.h"
+#include "UniformBuffer.h"
+#include "LightClusters.h"
+#include "ThreadPool.h"
+#include "BVH.h"
+#include "InstanceBatcher.h"
+#include "RenderQueue.h"
+#include "MeshArena.h"
+#include "GLExtensions.h"
+#include "Scene.h"
+#include "Profiler.h"
 
 // Include standard libraries
 #include <iostream>
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
 #include <fstream> // For file operations
+#include <unordered_map>
 
 // Include nlohmann/json for JSON serialization
 #include "nlohmann/json.hpp" // Ensure you have this library installed
@@ -32,9 +53,21 @@ using json = nlohmann::json;
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+// stb_image_write implementation, for the frames --render saves
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
 // Settings
 const unsigned int SCR_WIDTH = 1280;
 const unsigned int SCR_HEIGHT = 720;
+const double UPLOAD_BUDGET_MS = 4.0; // Time per frame spent uploading loaded models to the GPU
+// Mesh arena pools are compacted once this share of their free space is in pieces and there is this much of it
+const float ARENA_COMPACT_FRAGMENTATION = 0.5f;
+const size_t ARENA_COMPACT_MIN_FREE_BYTES = 16 * 1024 * 1024;
+// Headless --render defaults: frames timed, untimed frames after loading, and how long loading may take
+const int HEADLESS_DEFAULT_FRAMES = 300;
+const int HEADLESS_WARMUP_FRAMES = 10;
+const double HEADLESS_LOAD_TIMEOUT_S = 600.0;
 
 // Camera and Cursor State
 Camera camera;
@@ -50,14 +83,71 @@ float lastFrame = 0.0f;
 bool cursorDisabled = true; // Start in Camera Mode
 bool spacePressedLastFrame = false; // To track spacebar state
 
-// Models
-std::vector<Model> models;
+// Models, stored by component; see Scene
+Scene scene;
+double sceneLoadStart = -1.0; // Time the current scene load started, negative when idle
 
 // Lights
 std::vector<Light> lights;
 
-// Supported model file extensions
-const std::vector<std::string> supportedExtensions = { ".obj", ".fbx", ".dae", ".3ds", ".ply", ".glb", ".gltf" };
+// Spatial indices over the models and lights, kept in step by updateSpatialIndices
+BVH modelBvh;
+BVH lightBvh;
+bool modelBvhDirty = true; // Models were added, removed or replaced
+bool lightBvhDirty = true; // Lights were added, removed or replaced
+
+// Model picked with the mouse in UI mode; stale once that model is deleted
+ModelHandle selectedModel;
+bool selectionChanged = false;
+
+// Everything the scene is drawn with: programs, skybox, per-frame buffers and the state of the draw
+// path. Shared by the window and the headless --render mode; created once the GL context is current.
+struct SceneRenderer {
+    Shader shader;
+    Shader packedShader; // Same program for meshes stored as PackedVertex
+    Shader skyboxShader;
+    MaterialUniforms materialUniforms;
+    MaterialUniforms packedMaterialUniforms;
+    MeshProgram meshPrograms[VERTEX_FORMAT_COUNT];
+
+    unsigned int cubeVAO, cubeVBO; // Optional cube
+    unsigned int skyboxVAO, skyboxVBO;
+    unsigned int cubemapTexture;
+
+    // Camera data shared by all programs, written once per frame
+    UniformBuffer frameBuffer;
+
+    // Per-cluster light lists, rebuilt every frame. They use the last three texture units
+    // so they never collide with the material textures bound from unit 0 up.
+    LightClusterGrid lightGrid;
+    ClusteredLightBuffers lightBuffers;
+    GLuint lightBufferUnit;
+    double clusterBuildMs;
+
+    // Culling counters from the last frame, shown in the Scene window
+    CullStats cullStats;
+    std::vector<uint32_t> visibleModels;
+
+    // Draws each visible mesh once for all models sharing it
+    InstanceBatcher instanceBatcher;
+    // Sorts the frame's draws by state and skips redundant binds
+    RenderQueue renderQueue;
+
+    // Mesh level of detail selection, tuned in the Scene window
+    LodSelection lodSelection;
+
+    // Average CPU time spent on per-frame uniform updates, shown in the Scene window
+    double uniformUpdateMs;
+
+    SceneRenderer();
+
+    // Checks the programs and sets up the skybox and light buffers; false (after printing why) on failure
+    bool Init();
+
+    // Clears the bound framebuffer and draws the scene and skybox from the camera, bringing transforms
+    // and BVHs up to date first. Returns the matrices it used.
+    void Render(int width, int height, bool modelsLoading, glm::mat4& projection, glm::mat4& view);
+};
 
 // Function prototypes
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
@@ -67,6 +157,11 @@ void processInput(GLFWwindow* window);
 unsigned int loadCubemap(std::vector<std::string> faces);
 void saveScene(const std::string& filepath);
 void loadScene(const std::string& filepath);
+void updateModelTransforms();
+void updateSpatialIndices(bool modelsLoading);
+int pickModel(GLFWwindow* window, const glm::mat4& projection, const glm::mat4& view);
+Bounds lightBounds(const Light& light);
+int runHeadless(const std::vector<std::string>& args);
 
 // Skybox vertices
 float skyboxVertices[] = {
@@ -174,31 +269,47 @@ unsigned int loadCubemap(std::vector<std::string> faces)
     glGenTextures(1, &textureID);
     glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
-    int width, height, nrChannels;
+    // Faces are decoded (and staged for upload) in parallel on the worker threads
+    std::vector<ImageData> images(faces.size());
+    std::vector<unsigned char> decoded(faces.size(), 0);
+    ThreadPool::Shared().ParallelFor(faces.size(), 1, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+            decoded[i] = DecodeImage(faces[i], images[i]) ? 1 : 0;
+    });
+
     for (unsigned int i = 0; i < faces.size(); i++)
     {
-        unsigned char* data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-        if (data)
+        ImageData& image = images[i];
+        if (!decoded[i])
         {
-            GLenum format;
-            if (nrChannels == 1)
-                format = GL_RED;
-            else if (nrChannels == 3)
-                format = GL_RGB;
-            else if (nrChannels == 4)
-                format = GL_RGBA;
-
-            glTexImage2D(
-                GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-                0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data
-            );
-            stbi_image_free(data);
+            std::cout << "Cubemap texture failed to load at path: " << faces[i] << "\n";
+            continue;
         }
-        else
+        if (image.compressed.format != 0)
         {
-            std::cout << "Cubemap texture failed to load at path: " << faces[i] << "\n";
-            stbi_image_free(data);
+            // The skybox is sampled without mips, so the base level is all it needs
+            const CompressedLevel& level = image.compressed.levels[0];
+            const unsigned char* source = PixelBufferRing::BeginUpload(image.compressed.data.data(), image.compressed.data.size(), &image.staged);
+            glCompressedTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, image.compressed.format, level.width, level.height, 0,
+                static_cast<GLsizei>(level.size), source + level.offset);
+            PixelBufferRing::EndUpload();
+            continue;
         }
+
+        GLenum format = GL_RGBA;
+        if (image.components == 1)
+            format = GL_RED;
+        else if (image.components == 3)
+            format = GL_RGB;
+
+        const unsigned char* source = PixelBufferRing::BeginUpload(image.pixels.get(),
+            static_cast<size_t>(image.width) * image.height * image.components, &image.staged);
+        glTexImage2D(
+            GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
+            0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, source
+        );
+        PixelBufferRing::EndUpload();
     }
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -216,15 +327,44 @@ void saveScene(const std::string& filepath)
 
     json sceneJson;
 
-    // Save Models
+    // Save Models. Models placed more than once are written as one entry with an "instances"
+    // array of [px, py, pz, rx, ry, rz, sx, sy, sz] transforms, in order of first appearance.
     sceneJson["models"] = json::array();
-    for (const auto& model : models)
+    std::vector<std::string> paths;
+    std::unordered_map<std::string, std::vector<size_t>> modelsByPath;
+    for (size_t i = 0; i < scene.Size(); i++)
+    {
+        std::vector<size_t>& group = modelsByPath[scene.models[i].path];
+        if (group.empty())
+            paths.push_back(scene.models[i].path);
+        group.push_back(i);
+    }
+    for (const std::string& path : paths)
     {
+        const std::vector<size_t>& group = modelsByPath[path];
         json modelJson;
-        modelJson["path"] = model.path; // Use 'path' instead of 'directory'
-        modelJson["position"] = { model.position.x, model.position.y, model.position.z };
-        modelJson["rotation"] = { model.rotation.x, model.rotation.y, model.rotation.z };
-        modelJson["scaleFactor"] = { model.scaleFactor.x, model.scaleFactor.y, model.scaleFactor.z };
+        modelJson["path"] = path; // Use 'path' instead of 'directory'
+        if (group.size() == 1)
+        {
+            glm::vec3 position = scene.transforms.Position(group[0]);
+            glm::vec3 rotation = scene.transforms.Rotation(group[0]);
+            glm::vec3 scale = scene.transforms.Scale(group[0]);
+            modelJson["position"] = { position.x, position.y, position.z };
+            modelJson["rotation"] = { rotation.x, rotation.y, rotation.z };
+            modelJson["scaleFactor"] = { scale.x, scale.y, scale.z };
+        }
+        else
+        {
+            modelJson["instances"] = json::array();
+            for (size_t index : group)
+            {
+                glm::vec3 position = scene.transforms.Position(index);
+                glm::vec3 rotation = scene.transforms.Rotation(index);
+                glm::vec3 scale = scene.transforms.Scale(index);
+                modelJson["instances"].push_back({ position.x, position.y, position.z,
+                    rotation.x, rotation.y, rotation.z, scale.x, scale.y, scale.z });
+            }
+        }
         sceneJson["models"].push_back(modelJson);
     }
 
@@ -238,6 +378,8 @@ void saveScene(const std::string& filepath)
         lightJson["scale"] = { light.scale.x, light.scale.y, light.scale.z };
         lightJson["color"] = { light.color.x, light.color.y, light.color.z };
         lightJson["intensity"] = light.intensity;
+        if (std::isfinite(light.radius))
+            lightJson["radius"] = light.radius; // Unbounded lights are saved without one, as they were loaded
         sceneJson["lights"].push_back(lightJson);
     }
 
@@ -270,9 +412,15 @@ void loadScene(const std::string& filepath)
     file >> sceneJson;
     file.close();
 
-    // Clear existing models and lights
-    models.clear();
+    // Clear existing lights; the old models are replaced once the new ones are loaded
+    // so that assets shared with the previous scene stay in the cache
+    Scene loadedScene;
     lights.clear();
+    modelBvhDirty = true;
+    lightBvhDirty = true;
+    selectedModel = ModelHandle();
+    AssetCache::ResetCounters();
+    TextureCache::ResetCounters();
 
     // Load Models
     if (sceneJson.contains("models"))
@@ -311,10 +459,35 @@ void loadScene(const std::string& filepath)
             try
             {
                 Model model(path); // Ensure 'path' is the full model file path
-                model.position = glm::vec3(modelJson["position"][0], modelJson["position"][1], modelJson["position"][2]);
-                model.rotation = glm::vec3(modelJson["rotation"][0], modelJson["rotation"][1], modelJson["rotation"][2]);
-                model.scaleFactor = glm::vec3(modelJson["scaleFactor"][0], modelJson["scaleFactor"][1], modelJson["scaleFactor"][2]);
-                models.push_back(model);
+                glm::vec3 position(0.0f), rotation(0.0f), scale(1.0f);
+                if (modelJson.contains("position"))
+                    position = glm::vec3(modelJson["position"][0], modelJson["position"][1], modelJson["position"][2]);
+                if (modelJson.contains("rotation"))
+                    rotation = glm::vec3(modelJson["rotation"][0], modelJson["rotation"][1], modelJson["rotation"][2]);
+                if (modelJson.contains("scaleFactor"))
+                    scale = glm::vec3(modelJson["scaleFactor"][0], modelJson["scaleFactor"][1], modelJson["scaleFactor"][2]);
+
+                // "instances": one model per entry, each [px, py, pz] optionally followed by rotation and scale;
+                // missing parts come from the entry's own rotation/scaleFactor
+                if (modelJson.contains("instances"))
+                {
+                    for (const auto& instanceJson : modelJson["instances"])
+                    {
+                        glm::vec3 instancePosition = position, instanceRotation = rotation, instanceScale = scale;
+                        size_t count = instanceJson.size();
+                        if (count >= 3)
+                            instancePosition = glm::vec3(instanceJson[0], instanceJson[1], instanceJson[2]);
+                        if (count >= 6)
+                            instanceRotation = glm::vec3(instanceJson[3], instanceJson[4], instanceJson[5]);
+                        if (count >= 9)
+                            instanceScale = glm::vec3(instanceJson[6], instanceJson[7], instanceJson[8]);
+                        loadedScene.Add(model, instancePosition, instanceRotation, instanceScale);
+                    }
+                }
+                else
+                {
+                    loadedScene.Add(std::move(model), position, rotation, scale);
+                }
             }
             catch (const std::exception& e)
             {
@@ -323,6 +496,13 @@ void loadScene(const std::string& filepath)
         }
     }
 
+    scene = std::move(loadedScene);
+
+    AssetCacheStats cacheStats = AssetCache::GetStats();
+    std::cout << "Asset cache: " << cacheStats.hits << " hits, " << cacheStats.misses << " misses, "
+        << cacheStats.modelsLoading << " models loading" << std::endl;
+    sceneLoadStart = glfwGetTime();
+
     // Load Lights
     if (sceneJson.contains("lights"))
     {
@@ -334,6 +514,7 @@ void loadScene(const std::string& filepath)
             light.scale = glm::vec3(lightJson["scale"][0], lightJson["scale"][1], lightJson["scale"][2]);
             light.color = glm::vec3(lightJson["color"][0], lightJson["color"][1], lightJson["color"][2]);
             light.intensity = lightJson["intensity"];
+            light.radius = lightJson.contains("radius") && lightJson["radius"].is_number() ? lightJson["radius"].get<float>() : UNBOUNDED_LIGHT_RADIUS;
             lights.push_back(light);
         }
     }
@@ -415,76 +596,132 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
     camera.ProcessMouseScroll(static_cast<float>(yoffset));
 }
 
-int main()
+// Light positions as point bounds for the light BVH
+Bounds lightBounds(const Light& light)
 {
-    // Initialize GLFW
-    if (!glfwInit())
+    return ComputeBounds(&light.position, 1, sizeof(glm::vec3));
+}
+
+// Rebuilds the matrices of the models whose transform was edited or loaded since the last frame, in
+// one SIMD batch, and moves them in the model BVH
+void updateModelTransforms()
+{
+    PROFILE_SCOPE("Transforms");
+    for (uint32_t i : scene.UpdateTransforms())
     {
-        std::cout << "Failed to initialize GLFW\n";
-        return -1;
+        if (!modelBvhDirty)
+            modelBvh.UpdateItem(i, scene.bounds[i]);
     }
-    // OpenGL version 3.3 Core Profile
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    // For Mac OS X
-#ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-#endif
+}
 
-    // Create window
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Mini Engine", NULL, NULL);
-    if (window == NULL)
+// Rebuilds the BVHs when models or lights were added or removed. While models are still loading their
+// bounds grow as meshes arrive, so the model tree is refitted every frame and rebuilt once loading ends.
+void updateSpatialIndices(bool modelsLoading)
+{
+    PROFILE_SCOPE("Spatial indices");
+    static bool wasLoading = false;
+    if (modelBvhDirty || modelsLoading || wasLoading)
     {
-        std::cout << "Failed to create GLFW window\n";
-        glfwTerminate();
-        return -1;
+        scene.RefreshBounds();
+        if (modelBvhDirty || !modelsLoading)
+            modelBvh.Build(scene.bounds);
+        else
+            modelBvh.Refit(scene.bounds);
+        modelBvhDirty = false;
     }
-    glfwMakeContextCurrent(window);
-    // Set callbacks
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetScrollCallback(window, scroll_callback);
-
-    // Capture the mouse initially
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-    cursorDisabled = true;
+    wasLoading = modelsLoading;
 
-    // Initialize GLAD before calling any OpenGL function
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    if (lightBvhDirty)
     {
-        std::cout << "Failed to initialize GLAD\n";
-        return -1;
+        std::vector<Bounds> bounds;
+        bounds.reserve(lights.size());
+        for (const Light& light : lights)
+            bounds.push_back(lightBounds(light));
+        lightBvh.Build(bounds);
+        lightBvhDirty = false;
     }
+}
 
-    // Configure global OpenGL state
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LESS); // Default depth function
+// Casts a ray through the cursor and returns the closest model whose mesh bounds it hits, or -1
+int pickModel(GLFWwindow* window, const glm::mat4& projection, const glm::mat4& view)
+{
+    double cursorX, cursorY;
+    int width, height;
+    glfwGetCursorPos(window, &cursorX, &cursorY);
+    glfwGetWindowSize(window, &width, &height);
+    if (width <= 0 || height <= 0)
+        return -1;
+
+    // Ray from the near plane to the far plane; distances along it run from 0 to 1
+    glm::vec2 ndc(2.0f * static_cast<float>(cursorX) / width - 1.0f, 1.0f - 2.0f * static_cast<float>(cursorY) / height);
+    glm::mat4 inverseViewProjection = glm::inverse(projection * view);
+    glm::vec4 nearPoint = inverseViewProjection * glm::vec4(ndc, -1.0f, 1.0f);
+    glm::vec4 farPoint = inverseViewProjection * glm::vec4(ndc, 1.0f, 1.0f);
+    glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+    glm::vec3 direction = glm::vec3(farPoint) / farPoint.w - origin;
+    glm::vec3 inverseDirection = 1.0f / direction;
+
+    float distance;
+    uint32_t hit = modelBvh.Raycast(origin, direction, 1.0f, distance, [&](uint32_t item, float) {
+        // The model's box is loose; use its per-mesh boxes instead
+        float closest = -1.0f;
+        for (const Bounds& bounds : scene.models[item].meshBounds)
+        {
+            float enter;
+            if (RayIntersectsBox(origin, inverseDirection, bounds.min, bounds.max, 1.0f, enter) && (closest < 0.0f || enter < closest))
+                closest = enter;
+        }
+        return closest;
+    });
+    return hit == BVH::NO_ITEM ? -1 : static_cast<int>(hit);
+}
 
-    // Build and compile shader program
-    Shader shader("shaders/vertex_shader.glsl", "shaders/fragment_shader.glsl");
+SceneRenderer::SceneRenderer()
+    : shader("shaders/vertex_shader.glsl", "shaders/fragment_shader.glsl"),
+      packedShader("shaders/vertex_shader.glsl", "shaders/fragment_shader.glsl", "#define PACKED_VERTEX\n"),
+      skyboxShader("shaders/skybox_vertex.glsl", "shaders/skybox_fragment.glsl"),
+      // Resolve the uniform handles used every frame
+      materialUniforms(shader),
+      packedMaterialUniforms(packedShader),
+      cubeVAO(0), cubeVBO(0), skyboxVAO(0), skyboxVBO(0), cubemapTexture(0),
+      frameBuffer(FRAME_BLOCK_BINDING, sizeof(FrameBlock)),
+      lightBufferUnit(0),
+      clusterBuildMs(0.0),
+      uniformUpdateMs(0.0)
+{
+    meshPrograms[VERTEX_FORMAT_STANDARD] = { &shader, &materialUniforms };
+    meshPrograms[VERTEX_FORMAT_PACKED] = { &packedShader, &packedMaterialUniforms };
+
+    lodSelection.enabled = true;
+    lodSelection.maxPixelError = 1.0f;
+    lodSelection.hysteresis = 0.25f;
+}
+
+bool SceneRenderer::Init()
+{
     if (shader.ID == 0)
     {
         std::cout << "Failed to create shader program.\n";
-        return -1;
+        return false;
+    }
+    if (packedShader.ID == 0)
+    {
+        std::cout << "Failed to create packed vertex shader program.\n";
+        return false;
     }
-
-    // Build and compile skybox shader program
-    Shader skyboxShader("shaders/skybox_vertex.glsl", "shaders/skybox_fragment.glsl");
     if (skyboxShader.ID == 0)
     {
         std::cout << "Failed to create skybox shader program.\n";
-        return -1;
+        return false;
     }
 
     // Setup cube VAO and VBO (optional if you're not using the cube)
-    unsigned int VBO, cubeVAO;
     glGenVertexArrays(1, &cubeVAO);
-    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &cubeVBO);
 
     glBindVertexArray(cubeVAO);
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);
 
     // Position attribute
@@ -498,7 +735,6 @@ int main()
     glEnableVertexAttribArray(2);
 
     // Skybox VAO and VBO setup
-    unsigned int skyboxVAO, skyboxVBO;
     glGenVertexArrays(1, &skyboxVAO);
     glGenBuffers(1, &skyboxVBO);
     glBindVertexArray(skyboxVAO);
@@ -519,17 +755,477 @@ int main()
         "resources/textures/skybox/back.jpg"
     };
 
-    unsigned int cubemapTexture = loadCubemap(faces);
+    cubemapTexture = loadCubemap(faces);
     if (cubemapTexture == 0)
     {
         std::cout << "Failed to load cubemap texture.\n";
-        return -1;
+        return false;
     }
 
     // Shader configuration
     skyboxShader.use();
     skyboxShader.setInt("skybox", 0);
 
+    lightGrid.maxLightIndices = lightBuffers.maxLightIndices;
+    GLint textureUnits = 16;
+    glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &textureUnits);
+    lightBufferUnit = static_cast<GLuint>(textureUnits) - 3;
+    for (const MeshProgram& program : meshPrograms)
+    {
+        program.shader->use();
+        program.shader->setInt("lightData", lightBufferUnit);
+        program.shader->setInt("lightClusters", lightBufferUnit + 1);
+        program.shader->setInt("lightIndices", lightBufferUnit + 2);
+    }
+    return true;
+}
+
+void SceneRenderer::Render(int width, int height, bool modelsLoading, glm::mat4& projection, glm::mat4& view)
+{
+    width = std::max(width, 1);
+    height = std::max(height, 1);
+    glViewport(0, 0, width, height);
+    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // Activate shader
+    shader.use();
+
+    // View/projection transformations
+    const float zNear = 0.1f, zFar = 100.0f;
+    projection = glm::perspective(glm::radians(camera.Zoom), (float)width / (float)height, zNear, zFar);
+    view = camera.GetViewMatrix();
+    double uniformStart = glfwGetTime();
+    FrameBlock frameBlock;
+    frameBlock.projection = projection;
+    frameBlock.view = view;
+    frameBlock.viewPos = glm::vec4(camera.Position, 1.0f);
+    frameBlock.clusterParams = glm::vec4(zNear, zFar, (float)width, (float)height);
+    frameBuffer.Update(&frameBlock, sizeof(frameBlock));
+
+    uniformUpdateMs += ((glfwGetTime() - uniformStart) * 1000.0 - uniformUpdateMs) * 0.05;
+
+    // Assign lights to clusters and upload the lists
+    {
+        PROFILE_SCOPE("Light clusters");
+        double clusterStart = glfwGetTime();
+        ClusterCamera clusterCamera = { view, projection, zNear, zFar };
+        lightGrid.Build(lights, clusterCamera, &ThreadPool::Shared());
+        lightBuffers.Upload(lights, lightGrid);
+        lightBuffers.Bind(lightBufferUnit);
+        clusterBuildMs += ((glfwGetTime() - clusterStart) * 1000.0 - clusterBuildMs) * 0.05;
+    }
+
+    // Bring the BVHs up to date with this frame's edits before querying them
+    updateModelTransforms();
+    updateSpatialIndices(modelsLoading);
+
+    // Render the models the BVH finds in the view frustum, skipping their meshes outside it
+    Frustum frustum(projection * view);
+    {
+        PROFILE_SCOPE("Cull");
+        cullStats = CullStats();
+        visibleModels.clear();
+        modelBvh.QueryFrustum(frustum, visibleModels);
+        std::sort(visibleModels.begin(), visibleModels.end());
+        cullStats.modelsCulled = scene.Size() - visibleModels.size();
+        lodSelection.viewPosition = camera.Position;
+        lodSelection.pixelsPerUnit = height / (2.0f * std::tan(glm::radians(camera.Zoom) / 2.0f));
+        for (uint32_t index : visibleModels)
+        {
+            Model& model = scene.models[index];
+            if (model.Cull(frustum, cullStats) > 0)
+            {
+                model.SelectLods(lodSelection);
+                TextureStreaming::Request(model, lodSelection);
+                instanceBatcher.Add(model);
+            }
+        }
+    }
+    {
+        PROFILE_GPU_SCOPE("Scene");
+        renderQueue.Clear();
+        instanceBatcher.Flush(renderQueue, meshPrograms, view, zFar);
+        renderQueue.Sort();
+        renderQueue.Submit();
+    }
+
+    // Draw skybox as last
+    {
+        PROFILE_GPU_SCOPE("Skybox");
+        glDepthFunc(GL_LEQUAL);  // Change depth function so depth test passes when values are equal to depth buffer's content
+        skyboxShader.use();
+        // Skybox cube
+        glBindVertexArray(skyboxVAO);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+        glBindVertexArray(0);
+        glDepthFunc(GL_LESS); // Set depth function back to default
+    }
+}
+
+// Creates an offscreen 3.3 core context and makes it current, for render boxes without a display: EGL
+// surfaceless through GLFW's null platform (Mesa, llvmpipe included), then OSMesa, then an invisible window
+static GLFWwindow* createHeadlessContext()
+{
+    struct ContextAttempt {
+        int platform;
+        int contextApi;
+        const char* name;
+    };
+    const ContextAttempt attempts[] = {
+        { GLFW_PLATFORM_NULL, GLFW_EGL_CONTEXT_API, "EGL surfaceless" },
+        { GLFW_PLATFORM_NULL, GLFW_OSMESA_CONTEXT_API, "OSMesa" },
+        { GLFW_ANY_PLATFORM, GLFW_NATIVE_CONTEXT_API, "hidden window" }
+    };
+    for (const ContextAttempt& attempt : attempts)
+    {
+        if (attempt.platform != GLFW_ANY_PLATFORM && !glfwPlatformSupported(attempt.platform))
+            continue;
+        glfwInitHint(GLFW_PLATFORM, attempt.platform);
+        if (!glfwInit())
+            continue;
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, attempt.contextApi);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+        GLFWwindow* window = glfwCreateWindow(64, 64, "Mini Engine", NULL, NULL);
+        if (window != NULL)
+        {
+            glfwMakeContextCurrent(window);
+            std::cout << "Context: " << attempt.name << "\n";
+            return window;
+        }
+        glfwTerminate();
+    }
+    glfwInitHint(GLFW_PLATFORM, GLFW_ANY_PLATFORM);
+    std::cout << "Failed to create an offscreen OpenGL 3.3 context\n";
+    return nullptr;
+}
+
+// Prints the average, spread and tail of a list of frame times
+static void printFrameTimes(const char* label, std::vector<double> ms)
+{
+    std::sort(ms.begin(), ms.end());
+    double total = 0.0;
+    for (double value : ms)
+        total += value;
+    auto percentile = [&](double p) { return ms[std::min(ms.size() - 1, static_cast<size_t>(p * ms.size()))]; };
+    std::printf("%-4s avg %8.3f  min %8.3f  median %8.3f  p95 %8.3f  p99 %8.3f  max %8.3f ms\n", label,
+        total / ms.size(), ms.front(), percentile(0.5), percentile(0.95), percentile(0.99), ms.back());
+}
+
+// Loads the scene, waits for its models while rendering as the window would, then renders and times
+// the frames into the framebuffer, writing each to <pngPrefix>NNNN.png when a prefix is given
+static int renderHeadlessFrames(SceneRenderer& renderer, GLuint framebuffer, const std::string& scenePath,
+    int frames, int width, int height, const std::string& pngPrefix)
+{
+    glm::mat4 projection, view;
+    auto renderFrame = [&](bool modelsLoading)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        renderer.Render(width, height, modelsLoading, projection, view);
+        // Fence this frame's texture uploads so their ring space can be reused
+        PixelBufferRing::EndFrame();
+    };
+    auto processUploads = []()
+    {
+        PROFILE_SCOPE("Uploads");
+        AssetCache::ProcessUploads(UPLOAD_BUDGET_MS);
+        TextureStreaming::Update();
+        MeshArena::CompactIfFragmented(ARENA_COMPACT_FRAGMENTATION, ARENA_COMPACT_MIN_FREE_BYTES);
+        return AssetCache::GetStats();
+    };
+
+    // Load time runs from reading the file to the last model upload, at the window's per-frame upload budget
+    double loadStart = glfwGetTime();
+    loadScene(scenePath);
+    AssetCacheStats cacheStats;
+    int loadFrames = 0;
+    do
+    {
+        Profiler::BeginFrame();
+        cacheStats = processUploads();
+        renderFrame(cacheStats.modelsLoading > 0);
+        loadFrames++;
+        if (glfwGetTime() - loadStart > HEADLESS_LOAD_TIMEOUT_S)
+        {
+            std::cout << "Scene still loading after " << HEADLESS_LOAD_TIMEOUT_S << " s (" << cacheStats.modelsLoading
+                << " models left)\n";
+            return -1;
+        }
+    } while (cacheStats.modelsLoading > 0);
+    double loadMs = (glfwGetTime() - loadStart) * 1000.0;
+    TextureCacheStats textureStats = TextureCache::GetStats();
+    std::printf("Scene loaded in %.2f ms (%d frames): %zu models from %zu files, %zu bytes resident, %zu textures (%zu shared)\n",
+        loadMs, loadFrames, scene.Size(), cacheStats.modelsResident, cacheStats.bytesResident,
+        textureStats.texturesResident, textureStats.hits);
+
+    // Untimed frames for the texture levels the view requested to arrive and first-use driver work to settle
+    for (int frame = 0; frame < HEADLESS_WARMUP_FRAMES; frame++)
+    {
+        Profiler::BeginFrame();
+        processUploads();
+        renderFrame(false);
+    }
+    glFinish();
+
+    // One elapsed-time query around each frame's GL commands, read once every frame is done
+    std::vector<GLuint> queries(frames);
+    glGenQueries(frames, queries.data());
+    std::vector<double> cpuMs(frames), gpuMs(frames);
+    std::vector<unsigned char> pixels(pngPrefix.empty() ? 0 : static_cast<size_t>(width) * height * 4);
+    stbi_flip_vertically_on_write(1); // GL rows start at the bottom
+    int failedWrites = 0;
+    for (int frame = 0; frame < frames; frame++)
+    {
+        Profiler::BeginFrame();
+        double frameStart = glfwGetTime();
+        glBeginQuery(GL_TIME_ELAPSED, queries[frame]);
+        processUploads();
+        renderFrame(false);
+        glEndQuery(GL_TIME_ELAPSED);
+        cpuMs[frame] = (glfwGetTime() - frameStart) * 1000.0;
+
+        // Read back outside the timed part; it waits for the frame, so it only skews later CPU times
+        if (!pngPrefix.empty())
+        {
+            char name[16];
+            std::snprintf(name, sizeof(name), "%04d.png", frame);
+            std::string path = pngPrefix + name;
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+            if (!stbi_write_png(path.c_str(), width, height, 4, pixels.data(), width * 4))
+            {
+                std::cout << "Failed to write " << path << "\n";
+                failedWrites++;
+            }
+        }
+    }
+    glFinish();
+
+    std::printf("%6s %10s %10s\n", "frame", "cpu ms", "gpu ms");
+    for (int frame = 0; frame < frames; frame++)
+    {
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(queries[frame], GL_QUERY_RESULT, &elapsed);
+        gpuMs[frame] = elapsed / 1e6;
+        std::printf("%6d %10.3f %10.3f\n", frame, cpuMs[frame], gpuMs[frame]);
+    }
+    glDeleteQueries(frames, queries.data());
+
+    std::printf("%d frames at %dx%d, %zu draw calls, %zu triangles, %zu of %zu models visible\n", frames, width, height,
+        renderer.renderQueue.stats.drawCalls, renderer.instanceBatcher.triangles, renderer.cullStats.modelsVisible, scene.Size());
+    printFrameTimes("cpu", cpuMs);
+    printFrameTimes("gpu", gpuMs);
+    return failedWrites == 0 ? 0 : -1;
+}
+
+// --render <scene.json> [frames] [width] [height] [png prefix]: headless benchmark of a saved scene
+int runHeadless(const std::vector<std::string>& args)
+{
+    if (args.empty())
+    {
+        std::cout << "Usage: MiniEngine --render <scene.json> [frames] [width] [height] [png prefix]\n";
+        return -1;
+    }
+    // loadScene reads from saves/; take the name with or without it
+    std::string scenePath = args[0];
+    if (scenePath.compare(0, 6, "saves/") == 0)
+        scenePath = scenePath.substr(6);
+    int frames = args.size() > 1 ? std::max(std::atoi(args[1].c_str()), 1) : HEADLESS_DEFAULT_FRAMES;
+    int width = args.size() > 2 ? std::max(std::atoi(args[2].c_str()), 1) : static_cast<int>(SCR_WIDTH);
+    int height = args.size() > 3 ? std::max(std::atoi(args[3].c_str()), 1) : static_cast<int>(SCR_HEIGHT);
+    std::string pngPrefix = args.size() > 4 ? args[4] : "";
+    if (!std::ifstream("saves/" + scenePath).good())
+    {
+        std::cout << "Failed to open file for loading: saves/" << scenePath << std::endl;
+        return -1;
+    }
+
+    GLFWwindow* context = createHeadlessContext();
+    if (context == nullptr)
+        return -1;
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD\n";
+        glfwTerminate();
+        return -1;
+    }
+    LoadGLExtensions((GLADloadproc)glfwGetProcAddress);
+    SetTextureCompression(glExtensions.textureCompressionS3TC);
+    PixelBufferRing::Init();
+    Profiler::SetThreadName("Main");
+    Profiler::InitGpu();
+    std::cout << "Renderer: " << glGetString(GL_RENDERER) << " (" << glGetString(GL_VERSION) << ")\n";
+
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+
+    int result = -1;
+    {
+        SceneRenderer renderer;
+        if (renderer.Init())
+        {
+            // The null platform has no default framebuffer, so every frame goes to this one
+            GLuint framebuffer, colorBuffer, depthBuffer;
+            glGenRenderbuffers(1, &colorBuffer);
+            glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+            glGenRenderbuffers(1, &depthBuffer);
+            glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+            glGenFramebuffers(1, &framebuffer);
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE)
+                result = renderHeadlessFrames(renderer, framebuffer, scenePath, frames, width, height, pngPrefix);
+            else
+                std::cout << "Offscreen framebuffer is incomplete\n";
+
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glDeleteFramebuffers(1, &framebuffer);
+            glDeleteRenderbuffers(1, &colorBuffer);
+            glDeleteRenderbuffers(1, &depthBuffer);
+        }
+
+        // Stop the loader and release model GPU resources while the context is still current
+        AssetCache::Shutdown();
+        scene.Clear();
+        TextureStreaming::Shutdown();
+        PixelBufferRing::Shutdown();
+        MeshArena::Shutdown();
+        Profiler::Shutdown();
+    }
+
+    glfwTerminate();
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    // Command line tools run without a window
+    if (argc > 1)
+    {
+        std::string tool = argv[1];
+        std::vector<std::string> args(argv + 2, argv + argc);
+        if (tool == "--bake")
+            return RunBakeTool(args);
+        if (tool == "--bench-load")
+            return RunLoadBenchmark(args);
+        if (tool == "--bench-uniforms")
+            return RunUniformBenchmark(args);
+        if (tool == "--bench-clusters")
+            return RunClusterBenchmark(args);
+        if (tool == "--bench-bvh")
+            return RunBVHBenchmark(args);
+        if (tool == "--bench-queue")
+            return RunQueueBenchmark(args);
+        if (tool == "--bench-arena")
+            return RunArenaBenchmark(args);
+        if (tool == "--bench-packing")
+            return RunPackingBenchmark(args);
+        if (tool == "--bench-meshopt")
+            return RunMeshOptimizerBenchmark(args);
+        if (tool == "--bench-lod")
+            return RunLodBenchmark(args);
+        if (tool == "--gen-lods")
+            return RunLodGenerator(args);
+        if (tool == "--compress-textures")
+            return RunTextureCompressor(args);
+        if (tool == "--bench-textures")
+            return RunTextureBenchmark(args);
+        if (tool == "--sim-streaming")
+            return RunStreamingSimulation(args);
+        if (tool == "--bench-transforms")
+            return RunTransformBenchmark(args);
+        if (tool == "--bench-scenegraph")
+            return RunSceneGraphBenchmark(args);
+        if (tool == "--bench-scene")
+            return RunSceneBenchmark(args);
+        if (tool == "--bench-profiler")
+            return RunProfilerBenchmark(args);
+        if (tool == "--gen-light-scene")
+            return RunLightSceneGenerator(args);
+        if (tool == "--render")
+            return runHeadless(args);
+
+        std::cout << "Unknown option: " << tool << "\n"
+            << "Usage: MiniEngine [--bake [paths...] | --bench-load [paths...] | --bench-uniforms [meshes] |\n"
+            << "                  --bench-clusters [lights] | --bench-bvh [items] | --bench-queue [packets] |\n"
+            << "                  --bench-arena [operations] | --bench-packing [paths...] | --bench-meshopt [paths...] |\n"
+            << "                  --bench-lod [paths...] | --gen-lods [paths...] | --compress-textures [paths...] |\n"
+            << "                  --bench-textures [paths...] | --sim-streaming [textures] [budget MB] [frames] |\n"
+            << "                  --bench-transforms [instances] [moved %] [frames] | --bench-scenegraph [nodes] [passes] |\n"
+            << "                  --bench-scene [instances] [moved %] [frames] | --bench-profiler [markers] [trace] |\n"
+            << "                  --gen-light-scene [count] [output] [base] |\n"
+            << "                  --render <scene.json> [frames] [width] [height] [png prefix]]\n";
+        return -1;
+    }
+
+    // Initialize GLFW
+    if (!glfwInit())
+    {
+        std::cout << "Failed to initialize GLFW\n";
+        return -1;
+    }
+    // OpenGL version 3.3 Core Profile
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    // For Mac OS X
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+    // Create window
+    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Mini Engine", NULL, NULL);
+    if (window == NULL)
+    {
+        std::cout << "Failed to create GLFW window\n";
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    // Set callbacks
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetCursorPosCallback(window, mouse_callback);
+    glfwSetScrollCallback(window, scroll_callback);
+
+    // Capture the mouse initially
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    cursorDisabled = true;
+
+    // Initialize GLAD before calling any OpenGL function
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD\n";
+        return -1;
+    }
+    LoadGLExtensions((GLADloadproc)glfwGetProcAddress);
+    SetTextureCompression(glExtensions.textureCompressionS3TC);
+    PixelBufferRing::Init();
+    Profiler::SetThreadName("Main");
+    Profiler::InitGpu();
+
+    // Configure global OpenGL state
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS); // Default depth function
+
+    // Programs, skybox and per-frame buffers, shared with the headless --render mode
+    SceneRenderer renderer;
+    if (!renderer.Init())
+        return -1;
+
     // Initialize ImGui
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
@@ -548,11 +1244,14 @@ int main()
     defaultLight.scale = glm::vec3(1.0f);
     defaultLight.color = glm::vec3(1.0f, 1.0f, 1.0f);
     defaultLight.intensity = 1.0f;
+    defaultLight.radius = DEFAULT_LIGHT_RADIUS;
     lights.push_back(defaultLight);
 
     // Render loop
     while (!glfwWindowShouldClose(window))
     {
+        Profiler::BeginFrame();
+
         // Per-frame time logic
         float currentFrame = static_cast<float>(glfwGetTime());
         deltaTime = currentFrame - lastFrame;
@@ -561,16 +1260,41 @@ int main()
         // Input
         processInput(window);
 
+        // Upload models finished by the loader threads
+        AssetCacheStats cacheStats;
+        {
+            PROFILE_SCOPE("Uploads");
+            AssetCache::ProcessUploads(UPLOAD_BUDGET_MS);
+            TextureStreaming::Update();
+            cacheStats = AssetCache::GetStats();
+            MeshArena::CompactIfFragmented(ARENA_COMPACT_FRAGMENTATION, ARENA_COMPACT_MIN_FREE_BYTES);
+        }
+        if (sceneLoadStart >= 0.0)
+        {
+            if (cacheStats.modelsLoading == 0)
+            {
+                TextureCacheStats textureStats = TextureCache::GetStats();
+                std::cout << "Scene models loaded in " << (glfwGetTime() - sceneLoadStart) * 1000.0 << " ms, "
+                    << cacheStats.modelsResident << " models / " << cacheStats.bytesResident << " bytes resident, "
+                    << textureStats.texturesResident << " textures (" << textureStats.hits << " shared)" << std::endl;
+                sceneLoadStart = -1.0;
+            }
+        }
+
         // Start the Dear ImGui frame
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
+        // Left click in UI mode outside the ImGui windows picks a model
+        bool pickRequested = !cursorDisabled && !io.WantCaptureMouse && ImGui::IsMouseClicked(ImGuiMouseButton_Left);
+
         // ImGui window for lights
         {
+            PROFILE_SCOPE("UI lights");
             ImGui::Begin("Lights");
 
-            if (ImGui::Button("Add Light") && lights.size() < 10)
+            if (ImGui::Button("Add Light"))
             {
                 Light newLight;
                 newLight.position = glm::vec3(0.0f);
@@ -578,16 +1302,30 @@ int main()
                 newLight.scale = glm::vec3(1.0f);
                 newLight.color = glm::vec3(1.0f);
                 newLight.intensity = 1.0f;
+                newLight.radius = DEFAULT_LIGHT_RADIUS;
                 lights.push_back(newLight);
+                lightBvhDirty = true;
             }
 
+            // Cluster assignment from the previous frame
+            ImGui::Text("%zu lights, %zu cluster entries (max %zu per cluster)",
+                lights.size(), renderer.lightGrid.lightIndices.size(), renderer.lightGrid.maxLightsPerCluster);
+            ImGui::Text("Cluster build: %.3f ms/frame", renderer.clusterBuildMs);
+            if (renderer.lightGrid.droppedLightIndices > 0)
+                ImGui::Text("Dropped %zu cluster entries (texture buffer full)", renderer.lightGrid.droppedLightIndices);
+            float nearestDistance;
+            uint32_t nearestLight = lightBvh.Nearest(camera.Position, 1e30f, nearestDistance);
+            if (nearestLight != BVH::NO_ITEM)
+                ImGui::Text("Nearest to camera: Light %u (%.2f)", nearestLight + 1, nearestDistance);
+
             for (size_t i = 0; i < lights.size(); ++i)
             {
                 std::string header = "Light " + std::to_string(i + 1);
                 if (ImGui::CollapsingHeader(header.c_str()))
                 {
                     // Position
-                    ImGui::DragFloat3(("Position##" + std::to_string(i)).c_str(), glm::value_ptr(lights[i].position), 0.1f);
+                    if (ImGui::DragFloat3(("Position##" + std::to_string(i)).c_str(), glm::value_ptr(lights[i].position), 0.1f))
+                        lightBvh.UpdateItem(static_cast<uint32_t>(i), lightBounds(lights[i]));
                     // Rotation
                     ImGui::DragFloat3(("Rotation##" + std::to_string(i)).c_str(), glm::value_ptr(lights[i].rotation), 1.0f);
                     // Scale
@@ -596,10 +1334,23 @@ int main()
                     ImGui::ColorEdit3(("Color##" + std::to_string(i)).c_str(), glm::value_ptr(lights[i].color));
                     // Intensity
                     ImGui::DragFloat(("Intensity##" + std::to_string(i)).c_str(), &lights[i].intensity, 0.1f, 0.0f, 10.0f);
+                    // Radius; lights from older scenes have none until one is given
+                    if (std::isfinite(lights[i].radius))
+                    {
+                        ImGui::DragFloat(("Radius##" + std::to_string(i)).c_str(), &lights[i].radius, 0.1f, 0.1f, 500.0f);
+                    }
+                    else
+                    {
+                        ImGui::Text("Radius: unbounded");
+                        ImGui::SameLine();
+                        if (ImGui::Button(("Limit##" + std::to_string(i)).c_str()))
+                            lights[i].radius = DEFAULT_LIGHT_RADIUS;
+                    }
                     // Delete button
                     if (ImGui::Button(("Delete##" + std::to_string(i)).c_str()))
                     {
                         lights.erase(lights.begin() + i);
+                        lightBvhDirty = true;
                         break;
                     }
                 }
@@ -610,6 +1361,7 @@ int main()
 
         // ImGui window for models
         {
+            PROFILE_SCOPE("UI models");
             ImGui::Begin("Model Importer");
 
             // Input for model file path
@@ -641,7 +1393,8 @@ int main()
                         std::ifstream infile(fullPath);
                         if (infile.good()) {
                             try {
-                                models.emplace_back(pathStr);  // Pass original path, Model constructor will handle resources/
+                                scene.Add(Model(pathStr));  // Pass original path, Model constructor will handle resources/
+                                modelBvhDirty = true;
                                 std::cout << "Loaded model: " << fullPath << std::endl;
                                 modelPath[0] = '\0';
                             }
@@ -661,24 +1414,51 @@ int main()
 
             ImGui::Separator();
 
+            // Model picked by clicking in the scene
+            size_t selectedIndex = scene.IndexOf(selectedModel);
+            if (selectedIndex != Scene::NO_INDEX)
+            {
+                ImGui::Text("Selected: Model %zu (%s)", selectedIndex + 1, scene.models[selectedIndex].path.c_str());
+                float nearestDistance;
+                uint32_t nearestLight = lightBvh.Nearest(scene.bounds[selectedIndex].center, 1e30f, nearestDistance);
+                if (nearestLight != BVH::NO_ITEM)
+                    ImGui::Text("Nearest light: Light %u (%.2f)", nearestLight + 1, nearestDistance);
+            }
+            else
+            {
+                ImGui::Text("Click a model in UI mode to select it");
+            }
+
+            ImGui::Separator();
+
             // List of loaded models
-            for (size_t i = 0; i < models.size(); ++i)
+            for (size_t i = 0; i < scene.Size(); ++i)
             {
-                std::string modelName = "Model " + std::to_string(i + 1);
+                // Widget IDs follow the model's slot, so they stay put when a delete moves the model
+                std::string id = "##" + std::to_string(scene.HandleAt(i).slot);
+                std::string modelName = "Model " + std::to_string(i + 1) + id;
+                if (selectionChanged && i == selectedIndex)
+                    ImGui::SetNextItemOpen(true);
                 if (ImGui::TreeNode(modelName.c_str()))
                 {
                     // Display model path
-                    ImGui::Text("Path: %s", models[i].path.c_str());
+                    ImGui::Text("Path: %s", scene.models[i].path.c_str());
 
                     // Transformation controls
-                    ImGui::DragFloat3(("Position##" + std::to_string(i)).c_str(), glm::value_ptr(models[i].position), 0.1f);
-                    ImGui::DragFloat3(("Rotation##" + std::to_string(i)).c_str(), glm::value_ptr(models[i].rotation), 1.0f);
-                    ImGui::DragFloat3(("Scale##" + std::to_string(i)).c_str(), glm::value_ptr(models[i].scaleFactor), 0.1f, 0.1f, 10.0f);
-
-                    // Delete button
-                    if (ImGui::Button(("Delete##" + std::to_string(i)).c_str()))
+                    glm::vec3 position = scene.transforms.Position(i);
+                    glm::vec3 rotation = scene.transforms.Rotation(i);
+                    glm::vec3 scale = scene.transforms.Scale(i);
+                    bool moved = ImGui::DragFloat3(("Position" + id).c_str(), glm::value_ptr(position), 0.1f);
+                    moved |= ImGui::DragFloat3(("Rotation" + id).c_str(), glm::value_ptr(rotation), 1.0f);
+                    moved |= ImGui::DragFloat3(("Scale" + id).c_str(), glm::value_ptr(scale), 0.1f, 0.1f, 10.0f);
+                    if (moved)
+                        scene.SetTransform(i, position, rotation, scale);
+
+                    // Delete button; the last model moves into this one's place
+                    if (ImGui::Button(("Delete" + id).c_str()))
                     {
-                        models.erase(models.begin() + i);
+                        scene.Remove(scene.HandleAt(i));
+                        modelBvhDirty = true;
                         ImGui::TreePop();
                         break;
                     }
@@ -686,12 +1466,14 @@ int main()
                     ImGui::TreePop();
                 }
             }
+            selectionChanged = false;
 
             ImGui::End();
         }
 
         // ImGui window for Scene Save/Load
         {
+            PROFILE_SCOPE("UI scene");
             ImGui::Begin("Scene");
 
             // Input for scene file path
@@ -711,74 +1493,142 @@ int main()
                 loadScene(pathStr);
             }
 
+            ImGui::Separator();
+
+            // Asset cache counters
+            ImGui::Text("Asset cache: %zu hits, %zu misses", cacheStats.hits, cacheStats.misses);
+            ImGui::Text("Resident: %zu models, %.2f MB", cacheStats.modelsResident, cacheStats.bytesResident / (1024.0 * 1024.0));
+            if (cacheStats.modelsLoading > 0)
+                ImGui::Text("Loading: %zu models", cacheStats.modelsLoading);
+            TextureCacheStats textureStats = TextureCache::GetStats();
+            ImGui::Text("Texture cache: %zu hits, %zu misses (%.0f%% hit rate), %zu textures, %.2f MB", textureStats.hits, textureStats.misses,
+                textureStats.HitRate() * 100.0, textureStats.texturesResident, textureStats.bytesResident / (1024.0 * 1024.0));
+            bool packVertices = VertexPackingEnabled();
+            if (ImGui::Checkbox("Pack vertices of new imports", &packVertices))
+                SetVertexPacking(packVertices);
+            bool optimizeMeshes = MeshOptimizationEnabled();
+            if (ImGui::Checkbox("Optimize meshes of new imports", &optimizeMeshes))
+                SetMeshOptimization(optimizeMeshes);
+            bool generateLods = LodGenerationEnabled();
+            if (ImGui::Checkbox("Generate LODs of new imports", &generateLods))
+                SetLodGeneration(generateLods);
+            if (glExtensions.textureCompressionS3TC)
+            {
+                bool compressTextures = TextureCompressionEnabled();
+                if (ImGui::Checkbox("Compress textures of new imports", &compressTextures))
+                    SetTextureCompression(compressTextures);
+            }
+            else
+            {
+                ImGui::Text("Texture compression: not supported (no S3TC)");
+            }
+            bool streamTextures = TextureStreamingEnabled();
+            if (ImGui::Checkbox("Stream texture mips of new imports", &streamTextures))
+                SetTextureStreaming(streamTextures);
+            int budgetMB = static_cast<int>(TextureStreaming::Budget() >> 20);
+            if (ImGui::SliderInt("Texture budget", &budgetMB, 16, 2048, "%d MB"))
+                TextureStreaming::SetBudget(static_cast<size_t>(budgetMB) << 20);
+            TextureStreamingStats streamingStats = TextureStreaming::GetStats();
+            ImGui::Text("Streaming: %zu textures, %.2f MB resident, %.2f MB wanted", streamingStats.textures,
+                streamingStats.residentBytes / (1024.0 * 1024.0), streamingStats.wantedBytes / (1024.0 * 1024.0));
+            ImGui::Text("Streaming: %zu loads in flight, %zu loads, %zu evictions", streamingStats.loadsInFlight, streamingStats.loads, streamingStats.evictions);
+            if (PixelBufferRing::Enabled())
+            {
+                PixelUploadStats uploadStats = PixelBufferRing::GetStats();
+                ImGui::Text("Pixel uploads: %zu, %.2f MB through the ring, %.2f MB direct, %.3f ms stalled last frame", uploadStats.frameUploads,
+                    uploadStats.frameBytes / (1024.0 * 1024.0), uploadStats.frameDirectBytes / (1024.0 * 1024.0), uploadStats.frameStallMs);
+                ImGui::Text("Pixel ring: %.2f / %.2f MB in use, %.2f MB uploaded (%.2f MB staged by decoders), %.2f ms stalled",
+                    uploadStats.usedBytes / (1024.0 * 1024.0), uploadStats.capacity / (1024.0 * 1024.0), uploadStats.totalBytes / (1024.0 * 1024.0),
+                    uploadStats.workerStagedBytes / (1024.0 * 1024.0), uploadStats.totalStallMs);
+            }
+            else
+            {
+                ImGui::Text("Pixel uploads: synchronous (no buffer storage)");
+            }
+            ImGui::Checkbox("Select LODs by screen-space error", &renderer.lodSelection.enabled);
+            ImGui::SliderFloat("LOD pixel error", &renderer.lodSelection.maxPixelError, 0.25f, 16.0f, "%.2f px");
+            ImGui::SliderFloat("LOD hysteresis", &renderer.lodSelection.hysteresis, 0.0f, 0.9f);
+            ImGui::Text("Triangles: %zu (%zu at full detail)", renderer.instanceBatcher.triangles, renderer.instanceBatcher.fullDetailTriangles);
+            ImGui::Text("Uniform updates: %.3f ms/frame", renderer.uniformUpdateMs);
+            ImGui::Text("Models: %zu visible, %zu culled", renderer.cullStats.modelsVisible, renderer.cullStats.modelsCulled);
+            ImGui::Text("Meshes in visible models: %zu visible, %zu culled", renderer.cullStats.meshesVisible, renderer.cullStats.meshesCulled);
+            ImGui::Text("Draw calls: %zu (%zu without instancing)", renderer.instanceBatcher.drawCalls, renderer.instanceBatcher.instanceDraws);
+            const RenderQueueStats& queueStats = renderer.renderQueue.stats;
+            ImGui::Text("State changes: %zu, %zu avoided", queueStats.StateChanges(), queueStats.StateChangesAvoided());
+            ImGui::Text("  program %zu, material %zu, textures %zu, VAO %zu, instance buffer %zu",
+                queueStats.programChanges, queueStats.materialChanges, queueStats.textureChanges,
+                queueStats.vertexArrayChanges, queueStats.instanceBufferChanges);
+            ImGui::Text("GL draw calls: %zu", queueStats.drawCalls);
+            if (glExtensions.multiDrawIndirect)
+                ImGui::Checkbox("Multi-draw indirect", &renderer.renderQueue.multiDrawIndirect);
+            else
+                ImGui::Text("Multi-draw indirect: not supported (GL %d.%d)", glExtensions.majorVersion, glExtensions.minorVersion);
+            ImGui::Text("BVH: %zu models / %zu nodes, %zu lights", modelBvh.ItemCount(), modelBvh.NodeCount(), lightBvh.ItemCount());
+
+            // Shared vertex/index arena usage, one pool per vertex format
+            const char* formatNames[VERTEX_FORMAT_COUNT] = { "float", "packed" };
+            for (int format = 0; format < VERTEX_FORMAT_COUNT; format++)
+            {
+                ArenaStats arenaStats = MeshArena::GetStats(static_cast<VertexFormat>(format));
+                ImGui::PushID(format);
+                ImGui::Text("Mesh arena (%s vertices): %zu meshes, %.2f MB vertices, %zu compactions", formatNames[format], arenaStats.allocations,
+                    arenaStats.vertexUsed * VertexFormatSize(static_cast<VertexFormat>(format)) / (1024.0 * 1024.0), arenaStats.compactions);
+                ImGui::Text("  vertices %zu / %zu, %zu free blocks (largest %zu)", arenaStats.vertexUsed, arenaStats.vertexCapacity,
+                    arenaStats.vertexFreeBlocks, arenaStats.vertexLargestFree);
+                ImGui::Text("  index words %zu / %zu, %zu free blocks (largest %zu)", arenaStats.indexUsed, arenaStats.indexCapacity,
+                    arenaStats.indexFreeBlocks, arenaStats.indexLargestFree);
+                ImGui::Text("  fragmentation %.0f%%", arenaStats.Fragmentation() * 100.0f);
+                ImGui::SameLine();
+                if (ImGui::Button("Compact"))
+                    MeshArena::Compact(static_cast<VertexFormat>(format));
+                ImGui::PopID();
+            }
+
             ImGui::End();
         }
 
+        Profiler::DrawWindow();
+
         // Rendering
         ImGui::Render();
-        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        glm::mat4 projection, view;
+        renderer.Render(framebufferWidth, framebufferHeight, cacheStats.modelsLoading > 0, projection, view);
 
-        // Activate shader
-        shader.use();
-
-        // View/projection transformations
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom),
-            (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-        glm::mat4 view = camera.GetViewMatrix();
-        shader.setMat4("projection", projection);
-        shader.setMat4("view", view);
-
-        // Set view position
-        shader.setVec3("viewPos", camera.Position);
-
-        // Set lights
-        shader.setInt("numLights", static_cast<int>(lights.size()));
-        for (size_t i = 0; i < lights.size() && i < 10; ++i)
+        // Pick against the BVH the frame just brought up to date
+        if (pickRequested)
         {
-            std::string base = "lights[" + std::to_string(i) + "].";
-            shader.setVec3(base + "position", lights[i].position);
-            shader.setVec3(base + "rotation", lights[i].rotation);
-            shader.setVec3(base + "scale", lights[i].scale);
-            shader.setVec3(base + "color", lights[i].color);
-            shader.setFloat(base + "intensity", lights[i].intensity);
+            int picked = pickModel(window, projection, view);
+            selectedModel = picked < 0 ? ModelHandle() : scene.HandleAt(static_cast<size_t>(picked));
+            selectionChanged = true;
         }
 
-        // Render all models
-        for (auto& model : models)
+        // Render ImGui on top
         {
-            glm::mat4 modelMatrix = glm::mat4(1.0f);
-            modelMatrix = glm::translate(modelMatrix, model.position);
-            modelMatrix = glm::rotate(modelMatrix, glm::radians(model.rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
-            modelMatrix = glm::rotate(modelMatrix, glm::radians(model.rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
-            modelMatrix = glm::rotate(modelMatrix, glm::radians(model.rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
-            modelMatrix = glm::scale(modelMatrix, model.scaleFactor);
-            shader.setMat4("model", modelMatrix);
-            model.Draw(shader);
+            PROFILE_GPU_SCOPE("ImGui");
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
         }
 
-        // Draw skybox as last
-        glDepthFunc(GL_LEQUAL);  // Change depth function so depth test passes when values are equal to depth buffer's content
-        skyboxShader.use();
-        glm::mat4 skyboxView = glm::mat4(glm::mat3(camera.GetViewMatrix())); // Remove translation from the view matrix
-        skyboxShader.setMat4("view", skyboxView);
-        skyboxShader.setMat4("projection", projection);
-        // Skybox cube
-        glBindVertexArray(skyboxVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
-        glDepthFunc(GL_LESS); // Set depth function back to default
-
-        // Render ImGui on top
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        // Fence this frame's texture uploads so their ring space can be reused
+        PixelBufferRing::EndFrame();
 
         // Swap buffers and poll IO events
-        glfwSwapBuffers(window);
+        {
+            PROFILE_SCOPE("Swap");
+            glfwSwapBuffers(window);
+        }
         glfwPollEvents();
     }
 
+    // Stop the loader and release model GPU resources while the context is still current
+    AssetCache::Shutdown();
+    scene.Clear();
+    TextureStreaming::Shutdown();
+    PixelBufferRing::Shutdown();
+    MeshArena::Shutdown();
+    Profiler::Shutdown();
+
     // Cleanup ImGui and GLFW
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
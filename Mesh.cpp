@@ -1,82 +1,175 @@
 #include "Mesh.h"
+#include <cstring>
+#include <unordered_map>
 
-Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures, Material material)
+// Sampler name prefixes, in the order used by MaterialUniforms::samplers
+static const char* const SAMPLER_TYPES[4] = { "texture_diffuse", "texture_specular", "texture_normal", "texture_height" };
+
+// Interns a byte string, handing out ids in order of first appearance (main thread only)
+static uint32_t InternKey(std::unordered_map<std::string, uint32_t>& keys, const std::string& bytes)
 {
-    this->vertices = vertices;
-    this->indices = indices;
-    this->textures = textures;
-    this->material = material;  // Initialize the material
+    auto it = keys.find(bytes);
+    if (it != keys.end())
+        return it->second;
+    uint32_t key = static_cast<uint32_t>(keys.size());
+    keys.emplace(bytes, key);
+    return key;
+}
 
-    // Now that we have all the required data, set the vertex buffers and attribute pointers.
-    setupMesh();
+static uint32_t MaterialKeyFor(const Material& material)
+{
+    static std::unordered_map<std::string, uint32_t> keys;
+    std::string bytes(sizeof(float) * 7 + 1, '\0');
+    std::memcpy(&bytes[0], &material.diffuseColor[0], sizeof(float) * 3);
+    std::memcpy(&bytes[12], &material.specularColor[0], sizeof(float) * 3);
+    std::memcpy(&bytes[24], &material.shininess, sizeof(float));
+    bytes[28] = material.hasTexture ? 1 : 0;
+    return InternKey(keys, bytes);
 }
 
-void Mesh::setupMesh()
+static uint32_t TextureKeyFor(const std::vector<Texture>& textures)
 {
-    // Create buffers/arrays
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
-
-    glBindVertexArray(VAO);
-    // Load data into vertex buffers
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-    // Set the vertex attribute pointers
-    // Vertex Positions
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-    // Vertex Normals
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-    // Vertex Texture Coords
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-
-    glBindVertexArray(0);
+    static std::unordered_map<std::string, uint32_t> keys;
+    std::string bytes;
+    for (const Texture& texture : textures)
+    {
+        bytes.append(reinterpret_cast<const char*>(&texture.id), sizeof(texture.id));
+        bytes += texture.type;
+        bytes += '\0';
+    }
+    return InternKey(keys, bytes);
+}
+
+MaterialUniforms::MaterialUniforms(const Shader& shader)
+{
+    useTextures = shader.getUniform<bool>("useTextures");
+    materialColor = shader.getUniform<glm::vec3>("materialColor");
+    materialSpecular = shader.getUniform<glm::vec3>("materialSpecular");
+    materialShininess = shader.getUniform<float>("materialShininess");
+    for (unsigned int type = 0; type < 4; type++)
+    {
+        for (unsigned int number = 1; number <= MAX_SAMPLERS_PER_TYPE; number++)
+            samplers[type * MAX_SAMPLERS_PER_TYPE + number - 1] = shader.getUniform<int>(SAMPLER_TYPES[type] + std::to_string(number));
+    }
 }
 
-void Mesh::Draw(Shader& shader)
+size_t VertexFormatSize(VertexFormat format)
+{
+    switch (format)
+    {
+    case VERTEX_FORMAT_STANDARD: return sizeof(Vertex);
+    case VERTEX_FORMAT_PACKED: return sizeof(PackedVertex);
+    default: return 0;
+    }
+}
+
+Mesh::Mesh(VertexFormat format, const void* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount,
+           std::vector<Texture> textures, Material material, const Bounds& bounds, std::vector<MeshLod> lods)
+{
+    this->vertexCount = static_cast<unsigned int>(vertexCount);
+    this->indexCount = static_cast<unsigned int>(indexCount);
+    this->textures = std::move(textures);
+    this->material = material;  // Initialize the material
+    this->bounds = bounds;
+    this->lods = std::move(lods);
+    if (this->lods.empty())
+        this->lods.push_back(MeshLod{ 0, static_cast<uint32_t>(indexCount), 0.0f });
+    positionOffset = format == VERTEX_FORMAT_PACKED ? bounds.min : glm::vec3(0.0f);
+    positionScale = format == VERTEX_FORMAT_PACKED ? bounds.max - bounds.min : glm::vec3(1.0f);
+
+    // Work out each texture's sampler (texture_diffuse1, texture_diffuse2, ...) once instead of per draw
+    unsigned int counts[4] = { 0, 0, 0, 0 };
+    for (const Texture& texture : this->textures)
+    {
+        int sampler = -1;
+        for (unsigned int type = 0; type < 4; type++)
+        {
+            if (texture.type == SAMPLER_TYPES[type])
+            {
+                if (counts[type] < MAX_SAMPLERS_PER_TYPE)
+                    sampler = static_cast<int>(type * MAX_SAMPLERS_PER_TYPE + counts[type]);
+                counts[type]++;
+                break;
+            }
+        }
+        textureSamplers.push_back(sampler);
+    }
+
+    materialKey = MaterialKeyFor(this->material);
+    textureKey = TextureKeyFor(this->textures);
+
+    // Now that we have all the required data, copy it into the shared vertex/index arena
+    allocation = ArenaAllocation(MeshArena::Allocate(format, vertices, vertexCount, indices, indexCount));
+}
+
+void Mesh::BindMaterial(Shader& shader, const MaterialUniforms& uniforms) const
 {
     // Pass material properties to shader
-    shader.setBool("useTextures", material.hasTexture);
-    shader.setVec3("materialColor", material.diffuseColor);
-    shader.setVec3("materialSpecular", material.specularColor);
-    shader.setFloat("materialShininess", material.shininess);
+    shader.set(uniforms.useTextures, material.hasTexture);
+    shader.set(uniforms.materialColor, material.diffuseColor);
+    shader.set(uniforms.materialSpecular, material.specularColor);
+    shader.set(uniforms.materialShininess, material.shininess);
+}
 
+void Mesh::BindTextures(Shader& shader, const MaterialUniforms& uniforms) const
+{
     // Bind appropriate textures
-    unsigned int diffuseNr = 1;
-    unsigned int specularNr = 1;
-    unsigned int normalNr = 1;
-    unsigned int heightNr = 1;
     for (unsigned int i = 0; i < textures.size(); i++)
     {
         glActiveTexture(GL_TEXTURE0 + i); // Activate proper texture unit before binding
-        std::string number;
-        std::string name = textures[i].type;
-        if (name == "texture_diffuse")
-            number = std::to_string(diffuseNr++);
-        else if (name == "texture_specular")
-            number = std::to_string(specularNr++);
-        else if (name == "texture_normal")
-            number = std::to_string(normalNr++);
-        else if (name == "texture_height")
-            number = std::to_string(heightNr++);
 
         // Now set the sampler to the correct texture unit
-        glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
+        if (textureSamplers[i] >= 0)
+            shader.set(uniforms.samplers[textureSamplers[i]], static_cast<int>(i));
         glBindTexture(GL_TEXTURE_2D, textures[i].id);
     }
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void SetInstanceAttributes(GLintptr offset)
+{
+    for (GLuint column = 0; column < 4; column++)
+        glVertexAttribPointer(INSTANCE_MODEL_LOCATION + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+            (void*)(offset + offsetof(InstanceData, model) + column * sizeof(glm::vec4)));
+    for (GLuint column = 0; column < 3; column++)
+        glVertexAttribPointer(INSTANCE_NORMAL_LOCATION + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+            (void*)(offset + offsetof(InstanceData, normalMatrix) + column * sizeof(glm::vec4)));
+}
+
+int Mesh::SelectLod(float projectedScale, int previous, float maxPixels, float hysteresis) const
+{
+    int lod = 0;
+    for (int i = static_cast<int>(lods.size()) - 1; i > 0; i--)
+    {
+        if (lods[i].error * projectedScale <= maxPixels)
+        {
+            lod = i;
+            break;
+        }
+    }
+    // Refining happens at once; coarsening waits until the level is comfortably within budget
+    while (lod > previous && previous >= 0 && lods[lod].error * projectedScale > maxPixels * (1.0f - hysteresis))
+        lod--;
+    return lod;
+}
 
-    // Draw mesh
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+void Mesh::DrawInstances(uint32_t lod, GLintptr instanceOffset, GLsizei instanceCount) const
+{
+    const ArenaRange& range = MeshArena::Range(allocation);
+    SetInstanceAttributes(instanceOffset);
+    size_t indexSize = range.indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, lods[lod].indexCount, range.indexType,
+        (void*)((range.firstIndex + lods[lod].firstIndex) * indexSize), instanceCount, range.baseVertex);
+}
 
-    // Always good practice to set everything back to defaults once configured.
-    glActiveTexture(GL_TEXTURE0);
+DrawElementsIndirectCommand Mesh::IndirectCommand(uint32_t lod, GLuint baseInstance, GLuint instanceCount) const
+{
+    const ArenaRange& range = MeshArena::Range(allocation);
+    DrawElementsIndirectCommand command;
+    command.count = lods[lod].indexCount;
+    command.instanceCount = instanceCount;
+    command.firstIndex = range.firstIndex + lods[lod].firstIndex;
+    command.baseVertex = range.baseVertex;
+    command.baseInstance = baseInstance;
+    return command;
 }
@@ -4,10 +4,14 @@
 #include <glad/glad.h> // Holds all OpenGL type declarations
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <cstdint>
 #include <vector>
 #include <string>
 #include "Shader.h"
+#include "GLResource.h"
 #include "Texture.h" // Include Texture.h to use Texture struct
+#include "Bounds.h"
+#include "MeshArena.h"
 
 struct Vertex {
     glm::vec3 Position;
@@ -16,6 +20,27 @@ struct Vertex {
     // Add more attributes if needed (e.g., Tangents, Bitangents)
 };
 
+// Compact vertex, 16 bytes against Vertex's 32 (decoded by the PACKED_VERTEX path of vertex_shader.glsl).
+// Positions are stored relative to the mesh bounds; Mesh::positionScale/positionOffset map them back.
+struct PackedVertex {
+    GLushort position[4]; // xyz: unorm16 between bounds min and max; w: tangent code (see EncodeTangent)
+    GLshort normal[2];    // Octahedral normal, snorm16
+    GLhalf texCoords[2];
+};
+
+// Size of one vertex in the given format
+size_t VertexFormatSize(VertexFormat format);
+
+// One level of detail of a mesh: a run of its indices over the shared vertices (see MeshSimplifier.h)
+struct MeshLod {
+    uint32_t firstIndex; // Relative to the mesh's first index
+    uint32_t indexCount;
+    float error;         // Model-space distance to the full-detail surface, at most
+};
+
+// Level 0 is the full mesh; each mesh has at most this many levels
+const size_t MAX_MESH_LODS = 5;
+
 struct Material {
     glm::vec3 diffuseColor;
     glm::vec3 specularColor;
@@ -24,26 +49,105 @@ struct Material {
     // You can add more material properties here (ambient, emissive, etc.)
 };
 
+// Per-instance vertex attributes, read from the instance buffer bound when drawing.
+// The model matrix takes attribute locations 3-6 and the normal matrix 7-9 (see vertex_shader.glsl).
+struct InstanceData {
+    glm::mat4 model;
+    glm::vec4 normalMatrix[3]; // Columns of the inverse transpose of the model matrix's upper 3x3; w: Mesh::positionScale
+};
+const GLuint INSTANCE_MODEL_LOCATION = 3;
+const GLuint INSTANCE_NORMAL_LOCATION = 7;
+
+// Points the instance attributes of the bound VAO at the GL_ARRAY_BUFFER, starting at offset bytes
+void SetInstanceAttributes(GLintptr offset);
+
+// Samplers are named texture_<type><N>; this many of each type are resolved
+const unsigned int MAX_SAMPLERS_PER_TYPE = 4;
+
+// Material uniform and sampler handles resolved once per shader
+struct MaterialUniforms {
+    Uniform<bool> useTextures;
+    Uniform<glm::vec3> materialColor;
+    Uniform<glm::vec3> materialSpecular;
+    Uniform<float> materialShininess;
+    Uniform<int> samplers[4 * MAX_SAMPLERS_PER_TYPE]; // diffuse, specular, normal, height
+
+    explicit MaterialUniforms(const Shader& shader);
+};
+
+// The program meshes of one vertex format are drawn with, and its material handles
+struct MeshProgram {
+    Shader* shader;
+    const MaterialUniforms* uniforms;
+};
+
 class Mesh {
 public:
     // Mesh Data
-    std::vector<Vertex> vertices;
-    std::vector<unsigned int> indices;
+    unsigned int vertexCount;
+    unsigned int indexCount;
     std::vector<Texture> textures;
     Material material;  // Material properties for the mesh
+    Bounds bounds;      // Model-space bounds, used for culling
+    std::vector<MeshLod> lods; // Level 0 first, always present
+
+    // Small ids shared by meshes with identical material values / texture bindings, for render queue sort keys
+    uint32_t materialKey;
+    uint32_t textureKey;
+
+    // Stored positions to model space (offset + position * scale): the bounds' box for PackedVertex,
+    // no change for Vertex. Applied through the instance data.
+    glm::vec3 positionOffset;
+    glm::vec3 positionScale;
+
+    // Constructor, copies the vertex/index data (Vertex or PackedVertex array, by format) into the
+    // MeshArena; the arrays are not kept on the CPU. The indices hold every level of detail; with no
+    // lods given they form a single level.
+    Mesh(VertexFormat format, const void* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount,
+         std::vector<Texture> textures, Material material, const Bounds& bounds, std::vector<MeshLod> lods = {});
+
+    // Meshes own their arena space, so they can be moved but not copied
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+    Mesh(Mesh&&) = default;
+    Mesh& operator=(Mesh&&) = default;
+
+    // Sets the material uniforms
+    void BindMaterial(Shader& shader, const MaterialUniforms& uniforms) const;
+
+    // Binds the textures to units 0.. and points the samplers at them
+    void BindTextures(Shader& shader, const MaterialUniforms& uniforms) const;
 
-    // Constructor
-    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures, Material material);
+    VertexFormat Format() const { return MeshArena::Range(allocation).format; }
 
-    // Render the mesh
-    void Draw(Shader& shader);
+    // The arena pool's VAO, shared by every mesh of the same vertex format
+    GLuint VertexArray() const { return MeshArena::VertexArray(Format()); }
+
+    // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    GLenum IndexType() const { return MeshArena::Range(allocation).indexType; }
+
+    // VAO and index type for render queue sort keys; meshes with equal keys can share an indirect draw
+    GLuint GeometryKey() const { return VertexArray() << 1 | (IndexType() == GL_UNSIGNED_INT ? 1u : 0u); }
+
+    // Level to draw when one model unit covers projectedScale pixels: the coarsest whose error stays
+    // within maxPixels. Coming from level previous (-1 for none), a coarser level is only taken once
+    // its error is below maxPixels * (1 - hysteresis), so levels don't flicker at the threshold.
+    int SelectLod(float projectedScale, int previous, float maxPixels, float hysteresis) const;
+
+    // Draws instanceCount instances of level lod with the mesh's VAO already bound. Their InstanceData
+    // is read from the buffer bound to GL_ARRAY_BUFFER, starting at instanceOffset bytes.
+    void DrawInstances(uint32_t lod, GLintptr instanceOffset, GLsizei instanceCount) const;
+
+    // The same draw as a multi-draw indirect command; instance attributes must point at the start
+    // of the instance buffer, baseInstance being the first instance's index in it
+    DrawElementsIndirectCommand IndirectCommand(uint32_t lod, GLuint baseInstance, GLuint instanceCount) const;
 
 private:
-    // Render data
-    unsigned int VAO, VBO, EBO;
+    // Index into MaterialUniforms::samplers for each texture, -1 if it has no sampler
+    std::vector<int> textureSamplers;
 
-    // Initializes all the buffer objects/arrays
-    void setupMesh();
+    // Render data
+    ArenaAllocation allocation;
 };
 
 #endif // MESH_H
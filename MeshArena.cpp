@@ -0,0 +1,408 @@
+// MeshArena.cpp
+#include "MeshArena.h"
+#include "Mesh.h"
+#include <algorithm>
+
+// Pools start this big and double when full
+const size_t ARENA_INITIAL_VERTICES = 1 << 16;
+const size_t ARENA_INITIAL_INDICES = 1 << 18;
+
+void RangeAllocator::Reset(size_t capacity, size_t used)
+{
+    this->capacity = capacity;
+    this->used = used;
+    byOffset.clear();
+    bySize.clear();
+    if (used < capacity)
+        addFree(used, capacity - used);
+}
+
+void RangeAllocator::Grow(size_t newCapacity)
+{
+    if (newCapacity <= capacity)
+        return;
+    size_t oldCapacity = capacity;
+    capacity = newCapacity;
+    used += newCapacity - oldCapacity; // Free hands it back, merging with a free block at the old end
+    Free(oldCapacity, newCapacity - oldCapacity);
+}
+
+size_t RangeAllocator::Allocate(size_t count)
+{
+    if (count == 0)
+        return 0;
+    // Smallest block that fits, lowest offset among equals
+    auto fit = bySize.lower_bound(std::make_pair(count, size_t(0)));
+    if (fit == bySize.end())
+        return NO_SPACE;
+
+    size_t offset = fit->second;
+    size_t size = fit->first;
+    removeFree(byOffset.find(offset));
+    if (size > count)
+        addFree(offset + count, size - count);
+    used += count;
+    return offset;
+}
+
+void RangeAllocator::Free(size_t offset, size_t count)
+{
+    if (count == 0)
+        return;
+    used -= count;
+
+    // Merge with the free blocks on either side
+    auto next = byOffset.lower_bound(offset);
+    if (next != byOffset.end() && next->first == offset + count)
+    {
+        count += next->second;
+        next = std::next(next);
+        removeFree(std::prev(next));
+    }
+    if (next != byOffset.begin())
+    {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset)
+        {
+            offset = previous->first;
+            count += previous->second;
+            removeFree(previous);
+        }
+    }
+    addFree(offset, count);
+}
+
+void RangeAllocator::addFree(size_t offset, size_t count)
+{
+    byOffset.emplace(offset, count);
+    bySize.emplace(count, offset);
+}
+
+void RangeAllocator::removeFree(std::map<size_t, size_t>::iterator block)
+{
+    bySize.erase(std::make_pair(block->second, block->first));
+    byOffset.erase(block);
+}
+
+float ArenaStats::Fragmentation() const
+{
+    size_t vertexFree = vertexCapacity - vertexUsed;
+    size_t indexFree = indexCapacity - indexUsed;
+    float vertexFragmentation = vertexFree > 0 ? 1.0f - static_cast<float>(vertexLargestFree) / vertexFree : 0.0f;
+    float indexFragmentation = indexFree > 0 ? 1.0f - static_cast<float>(indexLargestFree) / indexFree : 0.0f;
+    return std::max(vertexFragmentation, indexFragmentation);
+}
+
+MeshArena::Pool MeshArena::pools[VERTEX_FORMAT_COUNT];
+std::vector<ArenaRange> MeshArena::allocations;
+std::vector<GLuint> MeshArena::freeSlots;
+std::vector<GLushort> MeshArena::shortIndices;
+
+GLuint MeshArena::Allocate(VertexFormat format, const void* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount)
+{
+    Pool& pool = pools[format];
+    if (pool.vertexArray == 0)
+        createPool(format, ARENA_INITIAL_VERTICES, ARENA_INITIAL_INDICES);
+
+    ArenaRange range;
+    range.format = format;
+    range.vertexCount = static_cast<GLsizei>(vertexCount);
+    range.indexType = vertexCount <= MAX_SHORT_INDEX_VERTICES ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    range.indexCount = static_cast<GLsizei>(indexCount);
+    size_t indexWordCount = indexWords(range);
+
+    size_t vertexOffset = pool.vertices.Allocate(vertexCount);
+    size_t indexOffset = pool.indices.Allocate(indexWordCount);
+    if (vertexOffset == RangeAllocator::NO_SPACE || indexOffset == RangeAllocator::NO_SPACE)
+    {
+        // Put back whichever half succeeded and grow; the added space alone fits the mesh
+        if (vertexOffset != RangeAllocator::NO_SPACE)
+            pool.vertices.Free(vertexOffset, vertexCount);
+        if (indexOffset != RangeAllocator::NO_SPACE)
+            pool.indices.Free(indexOffset, indexWordCount);
+        size_t vertexCapacity = pool.vertices.Capacity() + std::max(pool.vertices.Capacity(), vertexCount);
+        size_t indexCapacity = pool.indices.Capacity() + std::max(pool.indices.Capacity(), indexWordCount);
+        resize(format, vertexCapacity, indexCapacity, false);
+        vertexOffset = pool.vertices.Allocate(vertexCount);
+        indexOffset = pool.indices.Allocate(indexWordCount);
+    }
+    range.baseVertex = static_cast<GLint>(vertexOffset);
+
+    size_t stride = VertexFormatSize(format);
+    glBindBuffer(GL_ARRAY_BUFFER, pool.vertexBuffer);
+    glBufferSubData(GL_ARRAY_BUFFER, vertexOffset * stride, vertexCount * stride, vertices);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    // GL_ELEMENT_ARRAY_BUFFER is VAO state, so upload indices through the copy target instead
+    glBindBuffer(GL_COPY_WRITE_BUFFER, pool.indexBuffer);
+    if (range.indexType == GL_UNSIGNED_SHORT)
+    {
+        shortIndices.assign(indices, indices + indexCount);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, indexOffset * sizeof(unsigned int), indexCount * sizeof(GLushort), shortIndices.data());
+        range.firstIndex = static_cast<GLuint>(indexOffset * 2);
+    }
+    else
+    {
+        glBufferSubData(GL_COPY_WRITE_BUFFER, indexOffset * sizeof(unsigned int), indexCount * sizeof(unsigned int), indices);
+        range.firstIndex = static_cast<GLuint>(indexOffset);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    GLuint id;
+    if (!freeSlots.empty())
+    {
+        id = freeSlots.back();
+        freeSlots.pop_back();
+        allocations[id - 1] = range;
+    }
+    else
+    {
+        allocations.push_back(range);
+        id = static_cast<GLuint>(allocations.size());
+    }
+    pool.allocations++;
+    return id;
+}
+
+void MeshArena::Free(GLuint allocation)
+{
+    if (allocation == 0 || allocation > allocations.size())
+        return;
+    ArenaRange& range = allocations[allocation - 1];
+    if (range.format == VERTEX_FORMAT_COUNT)
+        return;
+
+    Pool& pool = pools[range.format];
+    pool.vertices.Free(range.baseVertex, range.vertexCount);
+    pool.indices.Free(indexWordOffset(range), indexWords(range));
+    pool.allocations--;
+    range.format = VERTEX_FORMAT_COUNT;
+    freeSlots.push_back(allocation);
+}
+
+GLuint MeshArena::VertexArray(VertexFormat format)
+{
+    return pools[format].vertexArray;
+}
+
+ArenaStats MeshArena::GetStats(VertexFormat format)
+{
+    const Pool& pool = pools[format];
+    ArenaStats stats;
+    stats.allocations = pool.allocations;
+    stats.vertexCapacity = pool.vertices.Capacity();
+    stats.vertexUsed = pool.vertices.Used();
+    stats.vertexFreeBlocks = pool.vertices.FreeBlocks();
+    stats.vertexLargestFree = pool.vertices.LargestFree();
+    stats.indexCapacity = pool.indices.Capacity();
+    stats.indexUsed = pool.indices.Used();
+    stats.indexFreeBlocks = pool.indices.FreeBlocks();
+    stats.indexLargestFree = pool.indices.LargestFree();
+    stats.compactions = pool.compactions;
+    return stats;
+}
+
+size_t MeshArena::Compact(VertexFormat format)
+{
+    Pool& pool = pools[format];
+    if (pool.vertexArray == 0)
+        return 0;
+
+    size_t stride = VertexFormatSize(format);
+    size_t freeBefore = (pool.vertices.Capacity() - pool.vertices.Used()) * stride
+        + (pool.indices.Capacity() - pool.indices.Used()) * sizeof(unsigned int);
+
+    // Keep half the live size spare so the next loads don't have to grow straight away
+    size_t vertexCapacity = std::max(ARENA_INITIAL_VERTICES, pool.vertices.Used() + pool.vertices.Used() / 2);
+    size_t indexCapacity = std::max(ARENA_INITIAL_INDICES, pool.indices.Used() + pool.indices.Used() / 2);
+    resize(format, vertexCapacity, indexCapacity, true);
+    pool.compactions++;
+
+    size_t freeAfter = (pool.vertices.Capacity() - pool.vertices.Used()) * stride
+        + (pool.indices.Capacity() - pool.indices.Used()) * sizeof(unsigned int);
+    return freeBefore > freeAfter ? freeBefore - freeAfter : 0;
+}
+
+void MeshArena::CompactIfFragmented(float threshold, size_t minFreeBytes)
+{
+    for (int format = 0; format < VERTEX_FORMAT_COUNT; format++)
+    {
+        ArenaStats stats = GetStats(static_cast<VertexFormat>(format));
+        size_t freeBytes = (stats.vertexCapacity - stats.vertexUsed) * VertexFormatSize(static_cast<VertexFormat>(format))
+            + (stats.indexCapacity - stats.indexUsed) * sizeof(unsigned int);
+        if (stats.Fragmentation() > threshold && freeBytes >= minFreeBytes)
+            Compact(static_cast<VertexFormat>(format));
+    }
+}
+
+void MeshArena::Shutdown()
+{
+    for (Pool& pool : pools)
+        pool = Pool();
+    allocations.clear();
+    freeSlots.clear();
+    shortIndices = std::vector<GLushort>();
+}
+
+size_t MeshArena::indexWordOffset(const ArenaRange& range)
+{
+    return range.indexType == GL_UNSIGNED_SHORT ? range.firstIndex / 2 : range.firstIndex;
+}
+
+size_t MeshArena::indexWords(const ArenaRange& range)
+{
+    size_t count = static_cast<size_t>(range.indexCount);
+    return range.indexType == GL_UNSIGNED_SHORT ? (count + 1) / 2 : count;
+}
+
+void MeshArena::createPool(VertexFormat format, size_t vertexCapacity, size_t indexCapacity)
+{
+    Pool& pool = pools[format];
+    pool.vertexArray = GLVertexArray::Create();
+    pool.vertexBuffer = GLBuffer::Create();
+    pool.indexBuffer = GLBuffer::Create();
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, pool.vertexBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, vertexCapacity * VertexFormatSize(format), NULL, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, pool.indexBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, indexCapacity * sizeof(unsigned int), NULL, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    pool.vertices.Reset(vertexCapacity, 0);
+    pool.indices.Reset(indexCapacity, 0);
+
+    setupVertexArray(format);
+}
+
+void MeshArena::setupVertexArray(VertexFormat format)
+{
+    Pool& pool = pools[format];
+    glBindVertexArray(pool.vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, pool.vertexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.indexBuffer);
+
+    switch (format)
+    {
+    case VERTEX_FORMAT_STANDARD:
+        // Vertex Positions
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        // Vertex Normals
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+        // Vertex Texture Coords
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+        break;
+    case VERTEX_FORMAT_PACKED:
+        // Quantized position + tangent code, octahedral normal (as raw integers, scaled in the shader), half float UVs
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 4, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, texCoords));
+        break;
+    default:
+        break;
+    }
+
+    // Instance transforms advance once per instance; SetInstanceAttributes points them at the instance buffer
+    for (GLuint column = 0; column < 4; column++)
+    {
+        glEnableVertexAttribArray(INSTANCE_MODEL_LOCATION + column);
+        glVertexAttribDivisor(INSTANCE_MODEL_LOCATION + column, 1);
+    }
+    for (GLuint column = 0; column < 3; column++)
+    {
+        glEnableVertexAttribArray(INSTANCE_NORMAL_LOCATION + column);
+        glVertexAttribDivisor(INSTANCE_NORMAL_LOCATION + column, 1);
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// Copies the old buffer's contents into new buffers of the given sizes. With pack, live allocations
+// are moved to the front in their current order; otherwise everything keeps its offset.
+void MeshArena::resize(VertexFormat format, size_t vertexCapacity, size_t indexCapacity, bool pack)
+{
+    Pool& pool = pools[format];
+    size_t stride = VertexFormatSize(format);
+
+    GLBuffer vertexBuffer = GLBuffer::Create();
+    GLBuffer indexBuffer = GLBuffer::Create();
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, vertexCapacity * stride, NULL, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, indexCapacity * sizeof(unsigned int), NULL, GL_STATIC_DRAW);
+
+    if (!pack)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, pool.vertexBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, pool.vertices.Capacity() * stride);
+        glBindBuffer(GL_COPY_READ_BUFFER, pool.indexBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, pool.indices.Capacity() * sizeof(unsigned int));
+        pool.vertices.Grow(vertexCapacity);
+        pool.indices.Grow(indexCapacity);
+    }
+    else
+    {
+        std::vector<GLuint> live;
+        for (GLuint i = 0; i < allocations.size(); i++)
+        {
+            if (allocations[i].format == format)
+                live.push_back(i);
+        }
+
+        // Vertices and indices are packed separately, each in current offset order, merging
+        // neighbouring allocations into one copy
+        std::sort(live.begin(), live.end(), [](GLuint a, GLuint b) { return allocations[a].baseVertex < allocations[b].baseVertex; });
+        glBindBuffer(GL_COPY_READ_BUFFER, pool.vertexBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+        size_t packed = 0;
+        for (size_t first = 0; first < live.size();)
+        {
+            size_t source = allocations[live[first]].baseVertex;
+            size_t count = 0;
+            size_t last = first;
+            for (; last < live.size() && static_cast<size_t>(allocations[live[last]].baseVertex) == source + count; last++)
+            {
+                count += allocations[live[last]].vertexCount;
+                allocations[live[last]].baseVertex = static_cast<GLint>(packed + count - allocations[live[last]].vertexCount);
+            }
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, source * stride, packed * stride, count * stride);
+            packed += count;
+            first = last;
+        }
+        pool.vertices.Reset(vertexCapacity, packed);
+
+        std::sort(live.begin(), live.end(), [](GLuint a, GLuint b) { return indexWordOffset(allocations[a]) < indexWordOffset(allocations[b]); });
+        glBindBuffer(GL_COPY_READ_BUFFER, pool.indexBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+        packed = 0;
+        for (size_t first = 0; first < live.size();)
+        {
+            size_t source = indexWordOffset(allocations[live[first]]);
+            size_t count = 0;
+            size_t last = first;
+            for (; last < live.size() && indexWordOffset(allocations[live[last]]) == source + count; last++)
+            {
+                ArenaRange& range = allocations[live[last]];
+                size_t words = indexWords(range);
+                range.firstIndex = static_cast<GLuint>((packed + count) * (range.indexType == GL_UNSIGNED_SHORT ? 2 : 1));
+                count += words;
+            }
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, source * sizeof(unsigned int), packed * sizeof(unsigned int), count * sizeof(unsigned int));
+            packed += count;
+            first = last;
+        }
+        pool.indices.Reset(indexCapacity, packed);
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    pool.vertexBuffer = std::move(vertexBuffer);
+    pool.indexBuffer = std::move(indexBuffer);
+    setupVertexArray(format);
+}
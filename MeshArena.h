@@ -0,0 +1,146 @@
+// MeshArena.h
+#ifndef MESH_ARENA_H
+#define MESH_ARENA_H
+
+#include <glad/glad.h> // Holds all OpenGL type declarations
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <vector>
+#include "GLResource.h"
+
+// Vertex layouts the arena keeps a separate pool (vertex buffer, index buffer, VAO) for
+enum VertexFormat {
+    VERTEX_FORMAT_STANDARD, // Vertex
+    VERTEX_FORMAT_PACKED,   // PackedVertex
+    VERTEX_FORMAT_COUNT
+};
+
+// Layout glMultiDrawElementsIndirect reads from GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// Best-fit allocator over the element range [0, capacity), with a free list that merges neighbours
+class RangeAllocator
+{
+public:
+    static const size_t NO_SPACE = ~size_t(0);
+
+    // Starts over with everything in [0, used) taken and the rest free
+    void Reset(size_t capacity, size_t used);
+
+    // Adds free space at the end
+    void Grow(size_t newCapacity);
+
+    // Returns the offset of a free range of count elements, or NO_SPACE
+    size_t Allocate(size_t count);
+    void Free(size_t offset, size_t count);
+
+    size_t Capacity() const { return capacity; }
+    size_t Used() const { return used; }
+    size_t FreeBlocks() const { return byOffset.size(); }
+    size_t LargestFree() const { return bySize.empty() ? 0 : bySize.rbegin()->first; }
+
+private:
+    size_t capacity = 0;
+    size_t used = 0;
+    std::map<size_t, size_t> byOffset;              // Free blocks: offset -> size
+    std::set<std::pair<size_t, size_t>> bySize;     // Free blocks: (size, offset)
+
+    void addFree(size_t offset, size_t count);
+    void removeFree(std::map<size_t, size_t>::iterator block);
+};
+
+// How one pool is using its buffers: vertices in elements, index space in 4-byte words
+// (one 32-bit index or two 16-bit ones)
+struct ArenaStats {
+    size_t allocations;
+    size_t vertexCapacity, vertexUsed, vertexFreeBlocks, vertexLargestFree;
+    size_t indexCapacity, indexUsed, indexFreeBlocks, indexLargestFree;
+    size_t compactions;
+
+    // Share of the free space that is not in the largest free block, 0 (one hole) to 1 (all crumbs)
+    float Fragmentation() const;
+};
+
+// Where a mesh's data currently sits in its pool
+struct ArenaRange {
+    VertexFormat format; // VERTEX_FORMAT_COUNT for a free slot
+    GLint baseVertex;    // First vertex; indices are relative to it
+    GLsizei vertexCount;
+    GLenum indexType;    // GL_UNSIGNED_SHORT when the mesh has at most 65536 vertices, else GL_UNSIGNED_INT
+    GLuint firstIndex;   // In indices of indexType
+    GLsizei indexCount;
+};
+
+// Largest vertex count whose indices are stored as 16 bits
+const size_t MAX_SHORT_INDEX_VERTICES = 65536;
+
+// Shared vertex/index storage. Every mesh suballocates its vertices and indices from the pool for
+// its vertex format, so all meshes of a format draw with one VAO and can be batched into one
+// glMultiDrawElementsIndirect call per index type. Indices are narrowed to 16 bits when the mesh
+// allows it; index space is handed out in 4-byte words so both types stay aligned in one buffer.
+// Pools grow by doubling and can be compacted; both move data around on the GPU, so meshes keep
+// an allocation id and look up their range when drawing. Render thread only.
+class MeshArena
+{
+public:
+    // Copies the data into the format's pool and returns the allocation id (never 0)
+    static GLuint Allocate(VertexFormat format, const void* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount);
+
+    // Returns an allocation's space to the free lists; unknown ids are ignored
+    static void Free(GLuint allocation);
+
+    static const ArenaRange& Range(GLuint allocation) { return allocations[allocation - 1]; }
+
+    // VAO of a format's pool: vertex attributes, index buffer and instance attribute layout
+    static GLuint VertexArray(VertexFormat format);
+
+    static ArenaStats GetStats(VertexFormat format);
+
+    // Moves every allocation of a pool to the front of fresh buffers, closing the holes.
+    // Returns the bytes of free space removed.
+    static size_t Compact(VertexFormat format);
+
+    // Compacts pools whose fragmentation is above the threshold and that have at least minFreeBytes free
+    static void CompactIfFragmented(float threshold, size_t minFreeBytes);
+
+    // Deletes the buffers; call before destroying the GL context
+    static void Shutdown();
+
+private:
+    struct Pool {
+        GLVertexArray vertexArray;
+        GLBuffer vertexBuffer, indexBuffer;
+        RangeAllocator vertices, indices;
+        size_t allocations = 0;
+        size_t compactions = 0;
+    };
+
+    static Pool pools[VERTEX_FORMAT_COUNT];
+    static std::vector<ArenaRange> allocations; // Indexed by id - 1
+    static std::vector<GLuint> freeSlots;
+    static std::vector<GLushort> shortIndices;  // Upload scratch for narrowed indices
+
+    // A range's index space in words
+    static size_t indexWordOffset(const ArenaRange& range);
+    static size_t indexWords(const ArenaRange& range);
+
+    static void createPool(VertexFormat format, size_t vertexCapacity, size_t indexCapacity);
+    static void setupVertexArray(VertexFormat format);
+    static void resize(VertexFormat format, size_t vertexCapacity, size_t indexCapacity, bool pack);
+};
+
+// Owns a MeshArena allocation and frees it when it goes away
+struct ArenaAllocationTraits {
+    static void Delete(GLuint id) { MeshArena::Free(id); }
+};
+typedef GLObject<ArenaAllocationTraits> ArenaAllocation;
+
+#endif // MESH_ARENA_H
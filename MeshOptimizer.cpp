@@ -0,0 +1,318 @@
+// MeshOptimizer.cpp
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+VertexCacheStats AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize)
+{
+    VertexCacheStats stats;
+    stats.triangles = indexCount / 3;
+
+    // A vertex is cached while fewer than cacheSize misses happened since it went in
+    std::vector<size_t> cachedAt(vertexCount, 0);
+    std::vector<bool> referenced(vertexCount, false);
+    size_t time = cacheSize + 1;
+    for (size_t i = 0; i < indexCount; i++)
+    {
+        unsigned int vertex = indices[i];
+        if (!referenced[vertex])
+        {
+            referenced[vertex] = true;
+            stats.vertices++;
+        }
+        if (time - cachedAt[vertex] > cacheSize)
+        {
+            cachedAt[vertex] = time++;
+            stats.transformed++;
+        }
+    }
+    return stats;
+}
+
+// FNV-1a over the vertex and its tangent
+struct VertexHasher {
+    const std::vector<Vertex>* vertices;
+    const std::vector<glm::vec4>* tangents;
+
+    size_t operator()(unsigned int index) const
+    {
+        uint64_t hash = 14695981039346656037ull;
+        auto add = [&hash](const void* data, size_t size)
+        {
+            const unsigned char* bytes = static_cast<const unsigned char*>(data);
+            for (size_t i = 0; i < size; i++)
+                hash = (hash ^ bytes[i]) * 1099511628211ull;
+        };
+        add(&(*vertices)[index], sizeof(Vertex));
+        if (!tangents->empty())
+            add(&(*tangents)[index], sizeof(glm::vec4));
+        return static_cast<size_t>(hash);
+    }
+};
+
+struct VertexEqual {
+    const std::vector<Vertex>* vertices;
+    const std::vector<glm::vec4>* tangents;
+
+    bool operator()(unsigned int a, unsigned int b) const
+    {
+        if (std::memcmp(&(*vertices)[a], &(*vertices)[b], sizeof(Vertex)) != 0)
+            return false;
+        return tangents->empty() || std::memcmp(&(*tangents)[a], &(*tangents)[b], sizeof(glm::vec4)) == 0;
+    }
+};
+
+size_t WeldVertices(std::vector<Vertex>& vertices, std::vector<glm::vec4>& tangents, std::vector<unsigned int>& indices)
+{
+    // Distinct vertices are compacted to the front in first-use order. Keys are slots below count,
+    // which no longer change; slot count is the candidate being looked up.
+    std::unordered_map<unsigned int, unsigned int, VertexHasher, VertexEqual> unique(
+        vertices.size(), VertexHasher{ &vertices, &tangents }, VertexEqual{ &vertices, &tangents });
+    std::vector<unsigned int> remap(vertices.size());
+    size_t count = 0;
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        vertices[count] = vertices[i];
+        if (!tangents.empty())
+            tangents[count] = tangents[i];
+        auto inserted = unique.emplace(static_cast<unsigned int>(count), static_cast<unsigned int>(count));
+        remap[i] = inserted.first->second;
+        if (inserted.second)
+            count++;
+    }
+    vertices.resize(count);
+    if (!tangents.empty())
+        tangents.resize(count);
+
+    size_t kept = 0;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        unsigned int a = remap[indices[i]], b = remap[indices[i + 1]], c = remap[indices[i + 2]];
+        if (a == b || b == c || c == a)
+            continue;
+        indices[kept++] = a;
+        indices[kept++] = b;
+        indices[kept++] = c;
+    }
+    indices.resize(kept);
+    return count;
+}
+
+void OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount, std::vector<size_t>& clusters, unsigned int cacheSize)
+{
+    clusters.clear();
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // Triangles around each vertex, and how many of them are still to be emitted
+    std::vector<unsigned int> live(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+        live[indices[i]]++;
+    std::vector<size_t> adjacencyStart(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++)
+        adjacencyStart[v + 1] = adjacencyStart[v] + live[v];
+    std::vector<unsigned int> adjacency(triangleCount * 3);
+    std::vector<size_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+        adjacency[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+
+    std::vector<size_t> cachedAt(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<unsigned int> deadEnds; // Recently used vertices, to restart from when a fan runs out
+    std::vector<unsigned int> candidates;
+    std::vector<unsigned int> output;
+    output.reserve(triangleCount * 3);
+    size_t time = cacheSize + 1;
+    size_t cursor = 0;
+
+    long long fanning = indices[0];
+    clusters.push_back(0);
+    while (fanning >= 0)
+    {
+        // Emit every remaining triangle around the fanning vertex
+        candidates.clear();
+        for (size_t a = adjacencyStart[fanning]; a < adjacencyStart[fanning + 1]; a++)
+        {
+            unsigned int triangle = adjacency[a];
+            if (emitted[triangle])
+                continue;
+            emitted[triangle] = true;
+            for (int corner = 0; corner < 3; corner++)
+            {
+                unsigned int vertex = indices[triangle * 3 + corner];
+                output.push_back(vertex);
+                deadEnds.push_back(vertex);
+                candidates.push_back(vertex);
+                live[vertex]--;
+                if (time - cachedAt[vertex] > cacheSize)
+                    cachedAt[vertex] = time++;
+            }
+        }
+
+        // Next, the oldest candidate that stays cached while its own fan is emitted, else any live one
+        long long next = -1;
+        long long bestPriority = -1;
+        for (unsigned int vertex : candidates)
+        {
+            if (live[vertex] == 0)
+                continue;
+            long long priority = 0;
+            if (time - cachedAt[vertex] + 2 * live[vertex] <= cacheSize)
+                priority = static_cast<long long>(time - cachedAt[vertex]);
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                next = vertex;
+            }
+        }
+
+        if (next < 0)
+        {
+            // Dead end: back up through recently used vertices, then scan for any vertex left
+            while (!deadEnds.empty() && next < 0)
+            {
+                unsigned int vertex = deadEnds.back();
+                deadEnds.pop_back();
+                if (live[vertex] > 0)
+                    next = vertex;
+            }
+            for (; next < 0 && cursor < vertexCount; cursor++)
+            {
+                if (live[cursor] > 0)
+                    next = static_cast<long long>(cursor);
+            }
+            if (next >= 0)
+                clusters.push_back(output.size() / 3);
+        }
+        fanning = next;
+    }
+    indices.swap(output);
+}
+
+void OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, std::vector<size_t>& clusters, unsigned int cacheSize)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || clusters.empty())
+        return;
+    float meshACMR = AnalyzeVertexCache(indices.data(), indices.size(), vertices.size(), cacheSize).ACMR();
+
+    // Split each cluster wherever its own ACMR has come down to near the mesh's
+    std::vector<size_t> cachedAt(vertices.size(), 0);
+    size_t time = cacheSize + 1;
+    std::vector<size_t> starts;
+    for (size_t c = 0; c < clusters.size(); c++)
+    {
+        size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+        size_t start = clusters[c];
+        starts.push_back(start);
+        time += cacheSize + 1; // Cold cache
+        size_t misses = 0;
+        for (size_t triangle = start; triangle < end; triangle++)
+        {
+            for (int corner = 0; corner < 3; corner++)
+            {
+                unsigned int vertex = indices[triangle * 3 + corner];
+                if (time - cachedAt[vertex] > cacheSize)
+                {
+                    cachedAt[vertex] = time++;
+                    misses++;
+                }
+            }
+            size_t count = triangle + 1 - start;
+            if (triangle + 1 < end && static_cast<float>(misses) <= OVERDRAW_CACHE_THRESHOLD * meshACMR * count)
+            {
+                start = triangle + 1;
+                starts.push_back(start);
+                time += cacheSize + 1;
+                misses = 0;
+            }
+        }
+    }
+
+    glm::vec3 meshCentroid(0.0f);
+    for (unsigned int vertex : indices)
+        meshCentroid += vertices[vertex].Position;
+    meshCentroid /= static_cast<float>(indices.size());
+
+    // Clusters far out along their own facing direction are likely to cover the others
+    std::vector<float> sortKey(starts.size());
+    for (size_t c = 0; c < starts.size(); c++)
+    {
+        size_t end = c + 1 < starts.size() ? starts[c + 1] : triangleCount;
+        glm::vec3 centroid(0.0f), normal(0.0f), average(0.0f);
+        float area = 0.0f;
+        for (size_t triangle = starts[c]; triangle < end; triangle++)
+        {
+            const glm::vec3& p0 = vertices[indices[triangle * 3]].Position;
+            const glm::vec3& p1 = vertices[indices[triangle * 3 + 1]].Position;
+            const glm::vec3& p2 = vertices[indices[triangle * 3 + 2]].Position;
+            glm::vec3 cross = glm::cross(p1 - p0, p2 - p0);
+            float triangleArea = glm::length(cross);
+            centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+            average += (p0 + p1 + p2) / 3.0f;
+            normal += cross;
+            area += triangleArea;
+        }
+        centroid = area > 0.0f ? centroid / area : average / static_cast<float>(end - starts[c]);
+        float normalLength = glm::length(normal);
+        sortKey[c] = normalLength > 0.0f ? glm::dot(centroid - meshCentroid, normal / normalLength) : -1e30f;
+    }
+
+    std::vector<size_t> order(starts.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::stable_sort(order.begin(), order.end(), [&sortKey](size_t a, size_t b) { return sortKey[a] > sortKey[b]; });
+
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+    clusters.clear();
+    for (size_t c : order)
+    {
+        size_t end = c + 1 < starts.size() ? starts[c + 1] : triangleCount;
+        clusters.push_back(output.size() / 3);
+        output.insert(output.end(), indices.begin() + starts[c] * 3, indices.begin() + end * 3);
+    }
+    indices.swap(output);
+}
+
+void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<glm::vec4>& tangents, std::vector<unsigned int>& indices)
+{
+    const unsigned int unused = ~0u;
+    std::vector<unsigned int> remap(vertices.size(), unused);
+    std::vector<Vertex> reordered;
+    std::vector<glm::vec4> reorderedTangents;
+    reordered.reserve(vertices.size());
+    for (unsigned int& index : indices)
+    {
+        if (remap[index] == unused)
+        {
+            remap[index] = static_cast<unsigned int>(reordered.size());
+            reordered.push_back(vertices[index]);
+            if (!tangents.empty())
+                reorderedTangents.push_back(tangents[index]);
+        }
+        index = remap[index];
+    }
+    vertices.swap(reordered);
+    if (!tangents.empty())
+        tangents.swap(reorderedTangents);
+}
+
+void OptimizeMesh(std::vector<Vertex>& vertices, std::vector<glm::vec4>& tangents, std::vector<unsigned int>& indices)
+{
+    WeldVertices(vertices, tangents, indices);
+
+    // Authoring tools sometimes export a good order already; keep it if ours does not beat it
+    std::vector<unsigned int> reordered = indices;
+    std::vector<size_t> clusters;
+    OptimizeVertexCache(reordered, vertices.size(), clusters);
+    OptimizeOverdraw(reordered, vertices, clusters);
+    if (AnalyzeVertexCache(reordered.data(), reordered.size(), vertices.size()).transformed <=
+        AnalyzeVertexCache(indices.data(), indices.size(), vertices.size()).transformed)
+        indices.swap(reordered);
+
+    OptimizeVertexFetch(vertices, tangents, indices);
+}
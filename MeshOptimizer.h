@@ -0,0 +1,53 @@
+// MeshOptimizer.h
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <vector>
+#include "Mesh.h"
+
+// Post-transform vertex cache size the triangle order is tuned for (FIFO, as in most hardware)
+const unsigned int VERTEX_CACHE_SIZE = 16;
+
+// How much the overdraw pass may give back of the cache order: a cluster is split wherever its
+// running ACMR is within this factor of the whole mesh's
+const float OVERDRAW_CACHE_THRESHOLD = 1.05f;
+
+// Transformed vertex counts of an index buffer through a FIFO vertex cache
+struct VertexCacheStats {
+    size_t triangles = 0;
+    size_t vertices = 0;    // Distinct vertices referenced
+    size_t transformed = 0; // Cache misses
+
+    // Average cache miss ratio: transformed vertices per triangle (0.5 at best, 3 at worst)
+    float ACMR() const { return triangles ? static_cast<float>(transformed) / triangles : 0.0f; }
+    // Average transform to vertex ratio: how often each vertex is transformed (1 at best)
+    float ATVR() const { return vertices ? static_cast<float>(transformed) / vertices : 0.0f; }
+};
+
+VertexCacheStats AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount,
+                                    unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+// Merges vertices that are bit-identical (with their tangent, if tangents is not empty) and drops
+// triangles that become degenerate. Returns the number of vertices left.
+size_t WeldVertices(std::vector<Vertex>& vertices, std::vector<glm::vec4>& tangents, std::vector<unsigned int>& indices);
+
+// Reorders triangles for the vertex cache (Tipsify, Sander et al. 2007). Fills clusters with the
+// first triangle of each run Tipsify had to restart from a dead end, for OptimizeOverdraw.
+void OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount, std::vector<size_t>& clusters,
+                         unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+// Reorders the clusters so that ones facing out from the mesh centre draw first and occlude the
+// rest, after splitting them further where the cache order allows (see OVERDRAW_CACHE_THRESHOLD)
+void OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, std::vector<size_t>& clusters,
+                      unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+// Renumbers vertices in order of first use so vertex fetches walk memory forwards; unreferenced
+// vertices are dropped. tangents may be empty.
+void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<glm::vec4>& tangents, std::vector<unsigned int>& indices);
+
+// All of the above, in order. The triangle order is only replaced if it transforms fewer vertices.
+void OptimizeMesh(std::vector<Vertex>& vertices, std::vector<glm::vec4>& tangents, std::vector<unsigned int>& indices);
+
+#endif // MESH_OPTIMIZER_H
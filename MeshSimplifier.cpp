@@ -0,0 +1,276 @@
+// MeshSimplifier.cpp
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <unordered_map>
+
+// Least cosine between a moved triangle's normal before and after a collapse
+const float COLLAPSE_MIN_NORMAL_COSINE = 0.25f;
+
+MeshSimplifier::MeshSimplifier(const std::vector<Vertex>& vertices, const unsigned int* indices, size_t indexCount)
+    : vertices(vertices), indices(indices, indices + indexCount - indexCount % 3)
+{
+    size_t vertexCount = vertices.size();
+
+    // Group vertices by position; a group with several referenced vertices sits on an attribute seam
+    std::vector<unsigned int> order(vertexCount);
+    std::iota(order.begin(), order.end(), 0u);
+    auto positionLess = [&vertices](unsigned int a, unsigned int b)
+    {
+        const glm::vec3& pa = vertices[a].Position;
+        const glm::vec3& pb = vertices[b].Position;
+        if (pa.x != pb.x) return pa.x < pb.x;
+        if (pa.y != pb.y) return pa.y < pb.y;
+        return pa.z < pb.z;
+    };
+    std::sort(order.begin(), order.end(), positionLess);
+    group.resize(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++)
+        group[order[i]] = i > 0 && !positionLess(order[i - 1], order[i]) ? group[order[i - 1]] : order[i];
+
+    std::vector<unsigned int> referencedGroup(vertexCount, ~0u); // A referenced vertex of each group
+    locked.assign(vertexCount, false);
+    for (unsigned int vertex : this->indices)
+    {
+        unsigned int g = group[vertex];
+        if (referencedGroup[g] == ~0u)
+            referencedGroup[g] = vertex;
+        else if (referencedGroup[g] != vertex)
+            locked[g] = true;
+    }
+
+    // Edges used by one triangle are open borders, by more than two non-manifold
+    std::unordered_map<uint64_t, unsigned int> edgeUses;
+    edgeUses.reserve(this->indices.size());
+    for (size_t i = 0; i < this->indices.size(); i += 3)
+    {
+        for (int corner = 0; corner < 3; corner++)
+        {
+            uint64_t a = group[this->indices[i + corner]], b = group[this->indices[i + (corner + 1) % 3]];
+            edgeUses[std::min(a, b) << 32 | std::max(a, b)]++;
+        }
+    }
+    for (const auto& edge : edgeUses)
+    {
+        if (edge.second != 2)
+        {
+            locked[edge.first >> 32] = true;
+            locked[edge.first & 0xFFFFFFFFu] = true;
+        }
+    }
+
+    quadrics.assign(vertexCount, Quadric{});
+    for (size_t i = 0; i < this->indices.size(); i += 3)
+    {
+        const glm::vec3& p0 = vertices[this->indices[i]].Position;
+        const glm::vec3& p1 = vertices[this->indices[i + 1]].Position;
+        const glm::vec3& p2 = vertices[this->indices[i + 2]].Position;
+        for (int corner = 0; corner < 3; corner++)
+            AddPlane(quadrics[group[this->indices[i + corner]]], p0, p1, p2);
+    }
+}
+
+void MeshSimplifier::AddPlane(Quadric& quadric, const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2)
+{
+    glm::dvec3 normal = glm::cross(glm::dvec3(p1) - glm::dvec3(p0), glm::dvec3(p2) - glm::dvec3(p0));
+    double length = glm::length(normal);
+    if (length == 0.0)
+        return;
+    normal /= length;
+    double d = -glm::dot(normal, glm::dvec3(p0));
+    quadric.a00 += normal.x * normal.x; quadric.a01 += normal.x * normal.y; quadric.a02 += normal.x * normal.z; quadric.a03 += normal.x * d;
+    quadric.a11 += normal.y * normal.y; quadric.a12 += normal.y * normal.z; quadric.a13 += normal.y * d;
+    quadric.a22 += normal.z * normal.z; quadric.a23 += normal.z * d;
+    quadric.a33 += d * d;
+}
+
+double MeshSimplifier::Evaluate(const Quadric& q, const glm::vec3& point)
+{
+    double x = point.x, y = point.y, z = point.z;
+    double cost = q.a00 * x * x + q.a11 * y * y + q.a22 * z * z + q.a33
+        + 2.0 * (q.a01 * x * y + q.a02 * x * z + q.a12 * y * z + q.a03 * x + q.a13 * y + q.a23 * z);
+    return std::max(cost, 0.0);
+}
+
+float MeshSimplifier::Error() const
+{
+    return static_cast<float>(std::sqrt(maxCost));
+}
+
+bool MeshSimplifier::Simplify(size_t targetIndexCount, float maxError)
+{
+    const double costLimit = static_cast<double>(maxError) * maxError;
+    size_t vertexCount = vertices.size();
+    std::vector<size_t> adjacencyStart(vertexCount + 1);
+    std::vector<unsigned int> adjacency;
+    std::vector<Collapse> collapses;
+    std::vector<bool> touched(vertexCount);
+    std::vector<unsigned int> remap(vertexCount);
+    std::vector<unsigned int> fromRing, toRing;
+
+    // Each pass collapses a set of edges whose neighbourhoods do not overlap, cheapest first
+    while (indices.size() > targetIndexCount)
+    {
+        size_t triangleCount = indices.size() / 3;
+
+        // Triangles around each group
+        std::fill(adjacencyStart.begin(), adjacencyStart.end(), 0);
+        for (unsigned int vertex : indices)
+            adjacencyStart[group[vertex] + 1]++;
+        std::partial_sum(adjacencyStart.begin(), adjacencyStart.end(), adjacencyStart.begin());
+        adjacency.resize(indices.size());
+        std::vector<size_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++)
+            adjacency[fill[group[indices[i]]]++] = static_cast<unsigned int>(i / 3);
+
+        collapses.clear();
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            for (int corner = 0; corner < 3; corner++)
+            {
+                unsigned int a = indices[i + corner], b = indices[i + (corner + 1) % 3];
+                if (!locked[group[a]])
+                    collapses.push_back(Collapse{ a, b, Evaluate(quadrics[group[a]], vertices[b].Position) });
+                if (!locked[group[b]])
+                    collapses.push_back(Collapse{ b, a, Evaluate(quadrics[group[b]], vertices[a].Position) });
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+        std::fill(touched.begin(), touched.end(), false);
+        std::iota(remap.begin(), remap.end(), 0u);
+        size_t removeGoal = (indices.size() - targetIndexCount + 2) / 3;
+        size_t removed = 0;
+        for (const Collapse& collapse : collapses)
+        {
+            if (collapse.cost > costLimit || removed >= removeGoal)
+                break;
+            unsigned int from = group[collapse.from], to = group[collapse.to];
+            if (touched[from] || touched[to])
+                continue;
+
+            // Triangles on the edge vanish; the others must keep their facing and the edge's vertex
+            // must be the one every triangle on it uses, or attributes would be torn apart
+            bool valid = true;
+            size_t edgeTriangles = 0;
+            fromRing.clear();
+            const glm::vec3& target = vertices[collapse.to].Position;
+            for (size_t a = adjacencyStart[from]; a < adjacencyStart[from + 1] && valid; a++)
+            {
+                const unsigned int* triangle = &indices[adjacency[a] * 3];
+                int moved = -1, shared = -1;
+                for (int corner = 0; corner < 3; corner++)
+                {
+                    unsigned int g = group[triangle[corner]];
+                    if (g == from)
+                        moved = corner;
+                    else if (g == to)
+                        shared = corner;
+                    else
+                        fromRing.push_back(g);
+                }
+                if (shared >= 0)
+                {
+                    edgeTriangles++;
+                    valid = triangle[shared] == collapse.to;
+                    continue;
+                }
+                const glm::vec3& p0 = vertices[triangle[0]].Position;
+                const glm::vec3& p1 = vertices[triangle[1]].Position;
+                const glm::vec3& p2 = vertices[triangle[2]].Position;
+                glm::vec3 before = glm::cross(p1 - p0, p2 - p0);
+                glm::vec3 corners[3] = { p0, p1, p2 };
+                corners[moved] = target;
+                glm::vec3 after = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+                valid = glm::dot(before, after) > COLLAPSE_MIN_NORMAL_COSINE * glm::length(before) * glm::length(after);
+            }
+            if (!valid)
+                continue;
+
+            // Link condition: the two ends may only share the neighbours opposite the edge
+            toRing.clear();
+            for (size_t a = adjacencyStart[to]; a < adjacencyStart[to + 1]; a++)
+            {
+                const unsigned int* triangle = &indices[adjacency[a] * 3];
+                for (int corner = 0; corner < 3; corner++)
+                {
+                    unsigned int g = group[triangle[corner]];
+                    if (g != from && g != to)
+                        toRing.push_back(g);
+                }
+            }
+            std::sort(fromRing.begin(), fromRing.end());
+            fromRing.erase(std::unique(fromRing.begin(), fromRing.end()), fromRing.end());
+            std::sort(toRing.begin(), toRing.end());
+            toRing.erase(std::unique(toRing.begin(), toRing.end()), toRing.end());
+            size_t common = 0;
+            for (size_t i = 0, j = 0; i < fromRing.size() && j < toRing.size();)
+            {
+                if (fromRing[i] < toRing[j])
+                    i++;
+                else if (toRing[j] < fromRing[i])
+                    j++;
+                else
+                    common++, i++, j++;
+            }
+            if (common != edgeTriangles)
+                continue;
+
+            remap[collapse.from] = collapse.to;
+            Quadric& q = quadrics[to];
+            const Quadric& r = quadrics[from];
+            q.a00 += r.a00; q.a01 += r.a01; q.a02 += r.a02; q.a03 += r.a03; q.a11 += r.a11;
+            q.a12 += r.a12; q.a13 += r.a13; q.a22 += r.a22; q.a23 += r.a23; q.a33 += r.a33;
+            maxCost = std::max(maxCost, collapse.cost);
+            touched[from] = touched[to] = true;
+            for (unsigned int g : fromRing)
+                touched[g] = true;
+            removed += edgeTriangles;
+        }
+        if (removed == 0)
+            return false;
+
+        size_t kept = 0;
+        for (size_t i = 0; i < triangleCount * 3; i += 3)
+        {
+            unsigned int a = remap[indices[i]], b = remap[indices[i + 1]], c = remap[indices[i + 2]];
+            if (group[a] == group[b] || group[b] == group[c] || group[c] == group[a])
+                continue;
+            indices[kept++] = a;
+            indices[kept++] = b;
+            indices[kept++] = c;
+        }
+        indices.resize(kept);
+    }
+    return true;
+}
+
+void GenerateLods(const std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, float radius, std::vector<MeshLod>& lods)
+{
+    lods.clear();
+    lods.push_back(MeshLod{ 0, static_cast<uint32_t>(indices.size()), 0.0f });
+    if (indices.size() / 3 <= LOD_MIN_TRIANGLES)
+        return;
+
+    MeshSimplifier simplifier(vertices, indices.data(), indices.size());
+    std::vector<unsigned int> levelIndices;
+    std::vector<size_t> clusters;
+    while (lods.size() < MAX_MESH_LODS)
+    {
+        size_t previous = lods.back().indexCount / 3;
+        size_t target = std::max(static_cast<size_t>(previous * LOD_TRIANGLE_RATIO), LOD_MIN_TRIANGLES);
+        simplifier.Simplify(target * 3, LOD_MAX_ERROR * radius);
+        size_t triangles = simplifier.Indices().size() / 3;
+        if (triangles > previous * (1.0f - LOD_MIN_REDUCTION))
+            break;
+
+        levelIndices = simplifier.Indices();
+        OptimizeVertexCache(levelIndices, vertices.size(), clusters);
+        lods.push_back(MeshLod{ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(levelIndices.size()), simplifier.Error() });
+        indices.insert(indices.end(), levelIndices.begin(), levelIndices.end());
+        if (triangles <= LOD_MIN_TRIANGLES)
+            break;
+    }
+}
@@ -0,0 +1,66 @@
+// MeshSimplifier.h
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <cstddef>
+#include <vector>
+#include "Mesh.h"
+
+// LOD chain generation: each level aims for this share of the previous level's triangles
+const float LOD_TRIANGLE_RATIO = 0.5f;
+// A level that removes less than this share of the previous one ends the chain
+const float LOD_MIN_REDUCTION = 0.2f;
+// Meshes, and levels, below this many triangles are not simplified further
+const size_t LOD_MIN_TRIANGLES = 64;
+// Largest error a level may have, as a fraction of the mesh's bounding radius
+const float LOD_MAX_ERROR = 0.05f;
+
+// Quadric error metric simplification by half-edge collapse (Garland & Heckbert 1997): vertices
+// only ever move onto a neighbour, so the vertex array is kept and every level just indexes it.
+// Vertices on open borders, on attribute seams (several vertices at one position) or on
+// non-manifold edges stay in place. Quadrics accumulate across calls, so Error() is measured
+// against the original surface however many levels have been taken.
+class MeshSimplifier
+{
+public:
+    MeshSimplifier(const std::vector<Vertex>& vertices, const unsigned int* indices, size_t indexCount);
+
+    // Collapses edges, cheapest first, until at most targetIndexCount indices remain or the next
+    // collapse would exceed maxError (model units). Call again with a lower target to continue.
+    // Returns true if the target was reached.
+    bool Simplify(size_t targetIndexCount, float maxError);
+
+    const std::vector<unsigned int>& Indices() const { return indices; }
+
+    // Largest collapse error so far, the root of the summed squared plane distances: it overstates
+    // the distance to the original surface rather than understating it
+    float Error() const;
+
+private:
+    // Symmetric 4x4 matrix of summed squared plane distances, upper triangle
+    struct Quadric {
+        double a00, a01, a02, a03, a11, a12, a13, a22, a23, a33;
+    };
+    struct Collapse {
+        unsigned int from, to;
+        double cost;
+    };
+
+    const std::vector<Vertex>& vertices;
+    std::vector<unsigned int> indices;
+    std::vector<unsigned int> group;   // First vertex at the same position, per vertex
+    std::vector<Quadric> quadrics;     // Per group
+    std::vector<bool> locked;          // Per group
+    double maxCost = 0.0;
+
+    static void AddPlane(Quadric& quadric, const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2);
+    static double Evaluate(const Quadric& quadric, const glm::vec3& point);
+};
+
+// Builds a LOD chain for a mesh in place: level 0 keeps the given indices, each further level is
+// appended to indices and recorded in lods (level 0 included). Levels stop at MAX_MESH_LODS, at
+// LOD_MIN_TRIANGLES, when a level would save less than LOD_MIN_REDUCTION, or when its error
+// would pass LOD_MAX_ERROR of the bounding radius.
+void GenerateLods(const std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, float radius, std::vector<MeshLod>& lods);
+
+#endif // MESH_SIMPLIFIER_H
@@ -3,51 +3,126 @@
 
 #include <vector>
 #include <string>
+#include <memory>
 #include <glm/glm.hpp>
 #include "Shader.h"
 #include "Mesh.h"
 #include "Texture.h" // Include Texture.h to use Texture struct
-#include <assimp/Importer.hpp>
-#include <assimp/scene.h>
-#include <assimp/postprocess.h>
+#include "Frustum.h"
+#include "TextureCache.h"
+#include "SceneGraph.h"
 
-class Model
+// Mesh and texture data loaded once per model file and shared by every Model that uses it.
+// Instances are handed out by the AssetCache; meshes appear as the upload queue fills them in.
+class ModelAsset
 {
 public:
     // Model data
     std::vector<Mesh> meshes;
     std::string directory;
     std::vector<Texture> textures_loaded; // To avoid loading duplicate textures
+    std::vector<TextureHandle> textureHandles; // Keeps the shared textures of textures_loaded alive
 
-    // Transformations
-    glm::vec3 position;
-    glm::vec3 rotation;
-    glm::vec3 scaleFactor;
+    // Animated nodes of the file's hierarchy (static ones are baked into the vertices) and, per mesh,
+    // the node it moves with or -1 for the model itself
+    SceneGraph nodes;
+    std::vector<int32_t> meshNodes;
 
     // Model path
     std::string path;
 
+    // Vertex and index memory owned by this asset; textures are counted by the TextureCache
+    size_t residentBytes;
+
+    // Set once every mesh and texture has been uploaded
+    bool loaded;
+
+    // Constructor, creates an empty asset for the (already resolved) path; the data is filled in by the loader.
+    ModelAsset(std::string const& path);
+
+    // Assets own GL resources and are shared by pointer, never copied
+    ModelAsset(const ModelAsset&) = delete;
+    ModelAsset& operator=(const ModelAsset&) = delete;
+
+};
+
+// Per-frame inputs for choosing mesh levels of detail by screen-space error
+struct LodSelection {
+    glm::vec3 viewPosition;
+    float pixelsPerUnit; // Framebuffer height / (2 tan(fovy / 2)): pixels covered by one unit at distance 1
+    float maxPixelError; // Largest on-screen geometric error a level may show
+    float hysteresis;    // See Mesh::SelectLod
+    bool enabled;        // Otherwise every mesh draws level 0
+};
+
+// A placed instance of a model asset: a shared handle to the asset data plus the per-mesh state that
+// follows from where it is placed. The transform itself lives in the Scene, which hands the matrices
+// built from it to SetTransform.
+class Model
+{
+public:
+    // Shared mesh/texture data
+    std::shared_ptr<const ModelAsset> asset;
+
+    // Model path
+    std::string path;
+
+    // Derived from the transform by SetTransform
+    glm::mat4 modelMatrix;
+    glm::mat3 normalMatrix;
+    std::vector<glm::mat4> nodeMatrices;       // World transforms of the asset's scene graph nodes
+    std::vector<glm::mat3> nodeNormalMatrices;
+    std::vector<Bounds> meshBounds; // World-space bounds per mesh of the asset
+    Bounds bounds;                  // World-space bounds of the whole model
+
     // Constructor, expects a filepath to a 3D model.
     Model(std::string const& path);
 
-    // Draws the model, and thus all its meshes
-    void Draw(Shader& shader);
+    // Places an asset that is already loaded or loading
+    Model(std::shared_ptr<const ModelAsset> asset);
 
-private:
-    // Loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-    void loadModel(std::string const& path);
+    // Takes matrices built from the transform (see TransformCache) and updates the world bounds
+    void SetTransform(const glm::mat4& model, const glm::mat3& normal);
+
+    // Recomputes the world bounds if more meshes were uploaded since the last call
+    void RefreshBounds();
 
-    // Processes a node in a recursive fashion.
-    void processNode(aiNode* node, const aiScene* scene);
+    // World transform of a mesh of the asset: its node's, or the model matrix
+    const glm::mat4& MeshMatrix(size_t mesh) const
+    {
+        int32_t node = mesh < asset->meshNodes.size() ? asset->meshNodes[mesh] : -1;
+        return node < 0 ? modelMatrix : nodeMatrices[node];
+    }
+    const glm::mat3& MeshNormalMatrix(size_t mesh) const
+    {
+        int32_t node = mesh < asset->meshNodes.size() ? asset->meshNodes[mesh] : -1;
+        return node < 0 ? normalMatrix : nodeNormalMatrices[node];
+    }
 
-    // Processes a mesh and returns a Mesh object.
-    Mesh processMesh(aiMesh* mesh, const aiScene* scene);
+    // Tests the meshes against the frustum and returns how many are visible; see MeshVisibility
+    size_t Cull(const Frustum& frustum, CullStats& stats);
 
-    // Loads textures from file
-    std::vector<Texture> LoadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName);
+    // 1 for each mesh that passed the last Cull, 0 otherwise
+    const std::vector<unsigned char>& MeshVisibility() const { return meshVisible; }
+
+    // Picks the level of detail of each visible mesh from its distance to the viewer; call after Cull.
+    // The levels picked last time feed the hysteresis.
+    void SelectLods(const LodSelection& selection);
+
+    // Level of detail per mesh from the last SelectLods
+    const std::vector<unsigned char>& MeshLods() const { return meshLods; }
+
+private:
+    std::vector<unsigned char> meshVisible;
+    std::vector<unsigned char> meshLods;
+
+    void updateBounds();
 };
 
-// Utility function for loading a 2D texture from file
-unsigned int TextureFromFile(const char* path, const std::string& directory, bool gamma = false);
+// Supported model file extensions
+extern const std::vector<std::string> supportedExtensions;
+
+// Prepends "resources/" to a model path if it doesn't already start with it
+std::string ResolveModelPath(std::string const& path);
 
 #endif // MODEL_H
@@ -0,0 +1,677 @@
+// ModelLoader.cpp
+#include "ModelLoader.h"
+#include "Model.h"
+#include "BakedModel.h"
+#include "VertexPacking.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "TextureCache.h"
+#include "TextureStreaming.h"
+#include "ThreadPool.h"
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include <atomic>
+#include <unordered_set>
+#include <chrono>
+#include <stb_image.h>
+
+// Read by the import workers
+static std::atomic<bool> vertexPacking(true);
+static std::atomic<bool> meshOptimization(true);
+static std::atomic<bool> lodGeneration(true);
+static std::atomic<bool> textureCompression(true);
+static std::atomic<bool> textureStreaming(true);
+
+void SetVertexPacking(bool enabled)
+{
+    vertexPacking = enabled;
+}
+
+bool VertexPackingEnabled()
+{
+    return vertexPacking;
+}
+
+void SetMeshOptimization(bool enabled)
+{
+    meshOptimization = enabled;
+}
+
+bool MeshOptimizationEnabled()
+{
+    return meshOptimization;
+}
+
+void SetLodGeneration(bool enabled)
+{
+    lodGeneration = enabled;
+}
+
+bool LodGenerationEnabled()
+{
+    return lodGeneration;
+}
+
+void SetTextureCompression(bool enabled)
+{
+    textureCompression = enabled;
+}
+
+bool TextureCompressionEnabled()
+{
+    return textureCompression;
+}
+
+void SetTextureStreaming(bool enabled)
+{
+    textureStreaming = enabled;
+}
+
+bool TextureStreamingEnabled()
+{
+    return textureStreaming;
+}
+
+void ImageDeleter::operator()(unsigned char* pixels) const
+{
+    stbi_image_free(pixels);
+}
+
+std::string ResolveTexturePath(const std::string& path, const std::string& directory)
+{
+    std::string filename = path;
+    // If the path is not absolute and doesn't start with resources/, prepend the directory
+    if (filename.find('/') == std::string::npos && filename.find('\\') == std::string::npos)
+    {
+        // First ensure directory starts with resources/
+        std::string dir = directory;
+        if (dir.substr(0, 10) != "resources/") {
+            dir = "resources/" + dir;
+        }
+        filename = dir + '/' + filename;
+    }
+    else if (filename.substr(0, 10) != "resources/") {
+        filename = "resources/" + filename;
+    }
+    return filename;
+}
+
+std::string EmbeddedTexturePath(const std::string& modelPath, unsigned int index)
+{
+    return modelPath + '#' + std::to_string(index);
+}
+
+// Decodes the image at 'path', or from its encoded file bytes when given (an embedded texture).
+// The compressed copy lives next to 'path' and is current if not older than 'sourcePath'.
+static bool DecodeImageSource(const std::string& path, const std::string& sourcePath, const unsigned char* encoded, size_t encodedSize,
+    ImageData& image, int maxSize)
+{
+    bool compress = TextureCompressionEnabled();
+    std::string compressedPath = CompressedTexturePath(path);
+    if (compress && IsCompressedTextureCurrent(sourcePath, compressedPath) && ReadCompressedTexture(compressedPath, image.compressed, 0, UINT32_MAX, maxSize))
+    {
+        image.width = image.compressed.levels[0].width;
+        image.height = image.compressed.levels[0].height;
+        image.components = image.compressed.format == GL_COMPRESSED_RED_RGTC1 ? 1 : image.compressed.format == GL_COMPRESSED_RG_RGTC2 ? 2 :
+            image.compressed.format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? 3 : 4;
+        image.staged = PixelBufferRing::Stage(image.compressed.data.data(), image.compressed.data.size());
+        return true;
+    }
+
+    if (encoded)
+        image.pixels.reset(stbi_load_from_memory(encoded, static_cast<int>(encodedSize), &image.width, &image.height, &image.components, 0));
+    else
+        image.pixels.reset(stbi_load(path.c_str(), &image.width, &image.height, &image.components, 0));
+    if (!image.pixels)
+    {
+        std::cout << "Texture failed to load at path: " << path << std::endl;
+        return false;
+    }
+
+    // Compress once and keep the copy for the next launch
+    if (compress && CompressImage(image.pixels.get(), image.width, image.height, image.components, image.compressed))
+    {
+        WriteCompressedTexture(image.compressed, compressedPath);
+        image.pixels.reset();
+        if (maxSize > 0)
+        {
+            // Drop the levels above the size so only the kept ones are staged and uploaded
+            CompressedImage& compressed = image.compressed;
+            compressed.firstLevel = FirstLevelWithin(image.width, image.height, maxSize);
+            size_t start = compressed.levels[compressed.firstLevel].offset;
+            compressed.data.erase(compressed.data.begin(), compressed.data.begin() + start);
+            for (uint32_t mip = compressed.firstLevel; mip <= compressed.lastLevel; mip++)
+                compressed.levels[mip].offset -= start;
+        }
+        image.staged = PixelBufferRing::Stage(image.compressed.data.data(), image.compressed.data.size());
+        return true;
+    }
+    image.staged = PixelBufferRing::Stage(image.pixels.get(), static_cast<size_t>(image.width) * image.height * image.components);
+    return true;
+}
+
+bool DecodeImage(const std::string& filename, ImageData& image, int maxSize)
+{
+    return DecodeImageSource(filename, filename, nullptr, 0, image, maxSize);
+}
+
+bool DecodeEmbeddedImage(const unsigned char* data, size_t size, const std::string& path, const std::string& modelPath, ImageData& image, int maxSize)
+{
+    return DecodeImageSource(path, modelPath, data, size, image, maxSize);
+}
+
+bool LoadImageData(const std::string& filename, ImageData& image)
+{
+    image.key = TextureCache::PathKey(filename);
+    if (TextureCache::IsResident(image.key))
+        return true;
+    if (DecodeImage(filename, image, TextureStreamingEnabled() ? STREAMING_TAIL_SIZE : 0))
+        return true;
+    image.key.clear(); // Nothing to decode again at upload
+    return false;
+}
+
+bool LoadEmbeddedImageData(const unsigned char* data, size_t size, const std::string& path, const std::string& modelPath, ImageData& image)
+{
+    image.key = TextureCache::ContentKey(data, size);
+    if (TextureCache::IsResident(image.key))
+        return true;
+    if (DecodeEmbeddedImage(data, size, path, modelPath, image, TextureStreamingEnabled() ? STREAMING_TAIL_SIZE : 0))
+        return true;
+    image.key.clear();
+    return false;
+}
+
+unsigned int UploadTexture(const ImageData& image, size_t* bytes)
+{
+    if (image.compressed.format != 0)
+    {
+        const unsigned char* source = PixelBufferRing::BeginUpload(image.compressed.data.data(), image.compressed.data.size(), &image.staged);
+        unsigned int textureID = UploadCompressedTexture(image.compressed, bytes, source);
+        PixelBufferRing::EndUpload();
+        return textureID;
+    }
+    if (!image.pixels)
+        return 0;
+
+    GLenum format = GL_RGBA;
+    if (image.components == 1)
+        format = GL_RED;
+    else if (image.components == 2)
+        format = GL_RG;
+    else if (image.components == 3)
+        format = GL_RGB;
+    else if (image.components == 4)
+        format = GL_RGBA;
+
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+
+    // Rows of 1 and 3 component images are not 4-byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    size_t size = static_cast<size_t>(image.width) * image.height * image.components;
+    const unsigned char* source = PixelBufferRing::BeginUpload(image.pixels.get(), size, &image.staged);
+    glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, source);
+    PixelBufferRing::EndUpload();
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    // Base level plus roughly a third more for the mip chain
+    if (bytes)
+        *bytes = static_cast<size_t>(image.width) * image.height * image.components * 4 / 3;
+
+    return textureID;
+}
+
+// Lists the textures of the given type used by a material, returns their indices in model.images.
+// They are decoded once the whole scene has been walked.
+static std::vector<unsigned int> LoadMaterialTextures(ModelData& model, aiMaterial* mat, aiTextureType type, const std::string& typeName, const aiScene* scene)
+{
+    std::vector<unsigned int> textures;
+    for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
+    {
+        aiString str;
+        mat->GetTexture(type, i, &str);
+
+        // Embedded textures ("*0" in .glb files) are read from the scene, not from disk
+        std::pair<const aiTexture*, int> embedded = scene->GetEmbeddedTextureAndIndex(str.C_Str());
+        std::string texturePath = embedded.first ? EmbeddedTexturePath(model.path, static_cast<unsigned int>(embedded.second)) :
+            ResolveTexturePath(str.C_Str(), model.directory);
+
+        // Check if texture was loaded before
+        bool skip = false;
+        for (unsigned int j = 0; j < model.images.size(); j++)
+        {
+            if (model.images[j].path == texturePath)
+            {
+                textures.push_back(j);
+                skip = true;
+                break;
+            }
+        }
+        if (!skip)
+        {
+            std::cout << "Loading texture from: " << texturePath << std::endl;
+            ImageData image;
+            image.path = texturePath;
+            image.type = typeName;
+            image.width = image.height = image.components = 0;
+            image.embeddedIndex = embedded.first ? embedded.second : -1;
+            textures.push_back(static_cast<unsigned int>(model.images.size()));
+            model.images.push_back(std::move(image));
+        }
+    }
+    return textures;
+}
+
+// Moves a mesh into the space of the node it was attached to, by that node's offset from the scene graph
+// node the mesh now moves with. A mirroring transform flips the winding and the bitangent signs back.
+static void BakeNodeTransform(std::vector<Vertex>& vertices, std::vector<glm::vec4>& tangents, std::vector<unsigned int>& indices, const glm::mat4& transform)
+{
+    glm::mat3 linear(transform);
+    glm::mat3 normalMatrix = glm::transpose(glm::inverse(linear));
+    for (Vertex& vertex : vertices)
+    {
+        vertex.Position = glm::vec3(transform * glm::vec4(vertex.Position, 1.0f));
+        glm::vec3 normal = normalMatrix * vertex.Normal;
+        float length = glm::length(normal);
+        vertex.Normal = length > 0.0f ? normal / length : normal;
+    }
+
+    bool mirrored = glm::determinant(linear) < 0.0f;
+    for (glm::vec4& tangent : tangents)
+    {
+        glm::vec3 direction = linear * glm::vec3(tangent);
+        float length = glm::length(direction);
+        tangent = glm::vec4(length > 0.0f ? direction / length : direction, mirrored ? -tangent.w : tangent.w);
+    }
+    if (mirrored)
+    {
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+            std::swap(indices[i + 1], indices[i + 2]);
+    }
+}
+
+// Process the mesh data and extract vertex, index, and texture information. The vertices are
+// transformed by 'transform', the static part of the mesh's node transform.
+static MeshData ProcessMesh(ModelData& model, aiMesh* mesh, const aiScene* scene, const glm::mat4& transform)
+{
+    MeshData data;
+    std::vector<Vertex>& vertices = data.vertices;
+    std::vector<unsigned int>& indices = data.indices;
+    // Tangent (xyz) and bitangent sign (w) per vertex, kept only by the packed format
+    std::vector<glm::vec4> tangents;
+
+    vertices.reserve(mesh->mNumVertices);
+    indices.reserve(static_cast<size_t>(mesh->mNumFaces) * 3);
+
+    // Process vertices
+    for (unsigned int i = 0; i < mesh->mNumVertices; i++)
+    {
+        Vertex vertex;
+        glm::vec3 vector;
+
+        vector.x = mesh->mVertices[i].x;
+        vector.y = mesh->mVertices[i].y;
+        vector.z = mesh->mVertices[i].z;
+        vertex.Position = vector;
+
+        if (mesh->HasNormals())
+        {
+            vector.x = mesh->mNormals[i].x;
+            vector.y = mesh->mNormals[i].y;
+            vector.z = mesh->mNormals[i].z;
+            vertex.Normal = vector;
+        }
+        else
+        {
+            vertex.Normal = glm::vec3(0.0f);
+        }
+
+        if (mesh->mTextureCoords[0])
+        {
+            glm::vec2 vec;
+            vec.x = mesh->mTextureCoords[0][i].x;
+            vec.y = mesh->mTextureCoords[0][i].y;
+            vertex.TexCoords = vec;
+        }
+        else
+        {
+            vertex.TexCoords = glm::vec2(0.0f, 0.0f);
+        }
+
+        if (mesh->HasTangentsAndBitangents())
+        {
+            glm::vec3 tangent(mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z);
+            glm::vec3 bitangent(mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z);
+            float handedness = glm::dot(glm::cross(vertex.Normal, tangent), bitangent) < 0.0f ? -1.0f : 1.0f;
+            tangents.push_back(glm::vec4(tangent, handedness));
+        }
+
+        vertices.push_back(vertex);
+    }
+
+    // Process indices
+    for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+    {
+        const aiFace& face = mesh->mFaces[i];
+        for (unsigned int j = 0; j < face.mNumIndices; j++)
+            indices.push_back(face.mIndices[j]);
+    }
+
+    if (transform != glm::mat4(1.0f))
+        BakeNodeTransform(vertices, tangents, indices, transform);
+
+    // Weld duplicates, then order triangles for the vertex cache and overdraw and vertices for fetching
+    if (MeshOptimizationEnabled())
+        OptimizeMesh(vertices, tangents, indices);
+    data.bounds = ComputeBounds(vertices.empty() ? nullptr : &vertices[0].Position, vertices.size(), sizeof(Vertex));
+
+    // Simplified levels are appended to the indices, over the same vertices
+    if (LodGenerationEnabled())
+        GenerateLods(vertices, indices, data.bounds.radius, data.lods);
+
+    // Switch to the packed layout when it keeps the mesh's texture coordinates intact
+    if (VertexPackingEnabled() &&
+        PackVertices(vertices.data(), tangents.empty() ? nullptr : tangents.data(), vertices.size(), data.bounds, data.packedVertices))
+    {
+        data.format = VERTEX_FORMAT_PACKED;
+        data.vertices = std::vector<Vertex>();
+    }
+
+
+    Material& material = data.material;
+    material.diffuseColor = glm::vec3(0.0f);
+    material.specularColor = glm::vec3(0.0f);
+    material.shininess = 0.0f;
+    material.hasTexture = false;
+
+    if (mesh->mMaterialIndex < scene->mNumMaterials)
+    {
+        aiMaterial* mat = scene->mMaterials[mesh->mMaterialIndex];
+
+        aiColor3D diffuse(0.0f, 0.0f, 0.0f);
+        aiColor3D specular(0.0f, 0.0f, 0.0f);
+        float shininess = 0.0f;
+
+        mat->Get(AI_MATKEY_COLOR_DIFFUSE, diffuse);
+        mat->Get(AI_MATKEY_COLOR_SPECULAR, specular);
+        mat->Get(AI_MATKEY_SHININESS, shininess);
+
+        material.diffuseColor = glm::vec3(diffuse.r, diffuse.g, diffuse.b);
+        material.specularColor = glm::vec3(specular.r, specular.g, specular.b);
+        material.shininess = shininess;
+        material.hasTexture = mat->GetTextureCount(aiTextureType_DIFFUSE) > 0;
+
+        if (material.hasTexture)
+            data.textures = LoadMaterialTextures(model, mat, aiTextureType_DIFFUSE, "texture_diffuse", scene);
+    }
+
+    return data;
+}
+
+static glm::mat4 ToMat4(const aiMatrix4x4& matrix)
+{
+    // Assimp matrices are row-major
+    return glm::mat4(matrix.a1, matrix.b1, matrix.c1, matrix.d1,
+                     matrix.a2, matrix.b2, matrix.c2, matrix.d2,
+                     matrix.a3, matrix.b3, matrix.c3, matrix.d3,
+                     matrix.a4, matrix.b4, matrix.c4, matrix.d4);
+}
+
+// Walks the node hierarchy breadth first into a scene graph and flattens it: only animated nodes are
+// kept, in model.nodes, and every other node's transform is baked into the vertices of its meshes,
+// which then move with the nearest animated ancestor (or the model itself).
+static void ProcessNodes(ModelData& model, const aiScene* scene)
+{
+    SceneGraph graph;
+    std::vector<const aiNode*> nodes;
+    graph.Add(-1, ToMat4(scene->mRootNode->mTransformation));
+    nodes.push_back(scene->mRootNode);
+    for (size_t next = 0; next < nodes.size(); next++)
+    {
+        for (unsigned int i = 0; i < nodes[next]->mNumChildren; i++)
+        {
+            graph.Add(static_cast<int32_t>(next), ToMat4(nodes[next]->mChildren[i]->mTransformation));
+            nodes.push_back(nodes[next]->mChildren[i]);
+        }
+    }
+
+    std::unordered_set<std::string> animated;
+    for (unsigned int i = 0; i < scene->mNumAnimations; i++)
+    {
+        const aiAnimation* animation = scene->mAnimations[i];
+        for (unsigned int j = 0; j < animation->mNumChannels; j++)
+            animated.insert(animation->mChannels[j]->mNodeName.C_Str());
+    }
+    std::vector<unsigned char> dynamic(nodes.size());
+    for (size_t i = 0; i < nodes.size(); i++)
+        dynamic[i] = animated.count(nodes[i]->mName.C_Str()) ? 1 : 0;
+
+    std::vector<FlattenedNode> placement;
+    model.nodes = graph.Flatten(dynamic, placement);
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        for (unsigned int j = 0; j < nodes[i]->mNumMeshes; j++)
+        {
+            aiMesh* mesh = scene->mMeshes[nodes[i]->mMeshes[j]];
+            model.meshes.push_back(ProcessMesh(model, mesh, scene, placement[i].offset));
+            model.meshes.back().node = placement[i].node;
+        }
+    }
+}
+
+std::unique_ptr<ModelData> ImportModel(const std::string& path)
+{
+    std::unique_ptr<ModelData> model(new ModelData());
+    model->path = path;
+
+    size_t lastSlash = path.find_last_of("/\\");
+    model->directory = (lastSlash != std::string::npos) ? path.substr(0, lastSlash) : ".";
+
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+    {
+        std::cout << "ERROR::ASSIMP::" << importer.GetErrorString() << std::endl;
+        return model;
+    }
+
+    ProcessNodes(*model, scene);
+
+    // Decode the textures in parallel, the embedded ones straight from the scene's buffers.
+    // A texture that fails to decode uploads as texture 0.
+    ThreadPool::Shared().ParallelFor(model->images.size(), 1, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            ImageData& image = model->images[i];
+            if (image.embeddedIndex < 0)
+            {
+                LoadImageData(image.path, image);
+                continue;
+            }
+            const aiTexture* texture = scene->mTextures[image.embeddedIndex];
+            if (texture->mHeight != 0)
+            {
+                std::cout << "ERROR::ASSIMP::UNSUPPORTED_EMBEDDED_TEXTURE: uncompressed texels in " << image.path << std::endl;
+                continue;
+            }
+            const unsigned char* bytes = reinterpret_cast<const unsigned char*>(texture->pcData);
+            LoadEmbeddedImageData(bytes, texture->mWidth, image.path, model->path, image);
+            // The baked file has no scene to read them from
+            image.encoded.assign(bytes, bytes + texture->mWidth);
+        }
+    });
+    return model;
+}
+
+std::unique_ptr<ModelData> LoadModelData(const std::string& path)
+{
+    std::string bakedPath = BakedModelPath(path);
+    if (IsBakedModelCurrent(path, bakedPath))
+    {
+        std::unique_ptr<ModelData> model = ReadBakedModel(bakedPath, path);
+        if (model)
+            return model;
+    }
+
+    std::unique_ptr<ModelData> model = ImportModel(path);
+    if (!model->meshes.empty())
+        WriteBakedModel(*model, bakedPath);
+    return model;
+}
+
+UploadQueue::UploadQueue(size_t capacity)
+    : capacity(capacity), closed(false)
+{
+}
+
+bool UploadQueue::Push(std::weak_ptr<ModelAsset> target, std::unique_ptr<ModelData> data)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    spaceAvailable.wait(lock, [this] { return closed || jobs.size() < capacity; });
+    if (closed)
+        return false;
+
+    Job job;
+    job.target = std::move(target);
+    job.data = std::move(data);
+    job.nextImage = 0;
+    job.nextMesh = 0;
+    jobs.push_back(std::move(job));
+    return true;
+}
+
+size_t UploadQueue::Process(double budgetMs)
+{
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+    size_t steps = 0;
+
+    for (;;)
+    {
+        if (!current)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (jobs.empty())
+                break;
+            current.reset(new Job(std::move(jobs.front())));
+            jobs.pop_front();
+            spaceAvailable.notify_one();
+        }
+
+        if (uploadStep(*current))
+            current.reset();
+        steps++;
+
+        double elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        if (elapsedMs >= budgetMs)
+            break;
+    }
+    return steps;
+}
+
+bool UploadQueue::uploadStep(Job& job)
+{
+    std::shared_ptr<ModelAsset> asset = job.target.lock();
+    if (!asset)
+        return true; // Every Model using the asset was deleted while it was loading
+
+    ModelData& data = *job.data;
+
+    // Textures go first so that meshes can refer to them
+    if (job.nextImage < data.images.size())
+    {
+        ImageData& image = data.images[job.nextImage++];
+        TextureHandle handle = TextureCache::Find(image.key);
+        if (!handle)
+        {
+            // Skipped at import because the cache held it, but released since
+            if (!image.pixels && image.compressed.format == 0 && !image.key.empty())
+            {
+                int maxSize = TextureStreamingEnabled() ? STREAMING_TAIL_SIZE : 0;
+                if (image.embeddedIndex >= 0)
+                    DecodeEmbeddedImage(image.encoded.data(), image.encoded.size(), image.path, data.path, image, maxSize);
+                else
+                    DecodeImage(image.path, image, maxSize);
+            }
+            handle = TextureCache::Upload(image);
+        }
+        Texture texture;
+        texture.id = handle->object;
+        texture.bytes = handle->bytes;
+        texture.streamId = handle->streamId;
+        texture.type = image.type;
+        texture.path = image.path;
+        image.pixels.reset();
+        image.compressed = CompressedImage();
+        image.staged.reset();
+        image.encoded = std::vector<unsigned char>();
+
+        asset->textures_loaded.push_back(texture);
+        asset->textureHandles.push_back(handle);
+        return false;
+    }
+
+    if (job.nextMesh < data.meshes.size())
+    {
+        if (asset->meshes.empty())
+        {
+            asset->meshes.reserve(data.meshes.size());
+            asset->nodes = data.nodes;
+        }
+
+        MeshData& mesh = data.meshes[job.nextMesh++];
+        std::vector<Texture> textures;
+        for (unsigned int index : mesh.textures)
+            textures.push_back(asset->textures_loaded[index]);
+
+        size_t indexSize = mesh.VertexCount() <= MAX_SHORT_INDEX_VERTICES ? sizeof(GLushort) : sizeof(unsigned int); // As the arena stores them
+        asset->residentBytes += mesh.VertexCount() * VertexFormatSize(mesh.format) + mesh.IndexCount() * indexSize;
+        asset->meshes.emplace_back(mesh.format, mesh.VertexData(), mesh.VertexCount(), mesh.IndexData(), mesh.IndexCount(),
+            std::move(textures), mesh.material, mesh.bounds, mesh.lods);
+        asset->meshNodes.push_back(mesh.node);
+
+        // The CPU copy is no longer needed once the buffers are filled
+        mesh.vertices = std::vector<Vertex>();
+        mesh.packedVertices = std::vector<PackedVertex>();
+        mesh.indices = std::vector<unsigned int>();
+        if (job.nextMesh < data.meshes.size())
+            return false;
+    }
+
+    asset->directory = data.directory;
+    asset->loaded = true;
+    return true;
+}
+
+size_t UploadQueue::Pending()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return jobs.size() + (current ? 1 : 0);
+}
+
+void UploadQueue::Close()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+    }
+    spaceAvailable.notify_all();
+}
+
+void UploadQueue::Clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    jobs.clear();
+    current.reset();
+}
@@ -0,0 +1,193 @@
+// ModelLoader.h
+#ifndef MODEL_LOADER_H
+#define MODEL_LOADER_H
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Mesh.h"
+#include "MappedFile.h"
+#include "TextureCompression.h"
+#include "PixelBufferRing.h"
+#include "SceneGraph.h"
+
+class ModelAsset;
+
+// Frees pixel memory allocated by stb_image
+struct ImageDeleter {
+    void operator()(unsigned char* pixels) const;
+};
+
+// A decoded image waiting to be uploaded as a texture
+struct ImageData {
+    std::string path;
+    std::string type;
+    int width;
+    int height;
+    int components;
+    std::unique_ptr<unsigned char, ImageDeleter> pixels;
+    CompressedImage compressed; // Used instead of pixels when it holds a format
+    std::string key;            // TextureCache key; left undecoded if the cache held it at import
+    StagedPixels staged;        // Copy of the pixels or compressed data in the PixelBufferRing, if it had room
+    int embeddedIndex = -1;     // Index among the textures embedded in the model file, -1 for an image file
+    std::vector<unsigned char> encoded; // Encoded file bytes of an embedded texture, kept for baking and decoding again
+};
+
+// CPU-side mesh produced by the importer or read from a baked file
+struct MeshData {
+    VertexFormat format = VERTEX_FORMAT_STANDARD;
+    std::vector<Vertex> vertices;             // VERTEX_FORMAT_STANDARD
+    std::vector<PackedVertex> packedVertices; // VERTEX_FORMAT_PACKED, quantized to bounds
+    std::vector<unsigned int> indices;
+    std::vector<unsigned int> textures; // Indices into ModelData::images
+    Material material;
+    Bounds bounds; // Model-space bounds of the vertices
+    std::vector<MeshLod> lods; // Levels of detail within indices; empty for a single level
+    int32_t node = -1;         // Node of ModelData::nodes the mesh moves with, -1 for the model itself
+
+    // Set when the mesh comes from a baked file: the arrays then live inside ModelData::mapping
+    const void* mappedVertices = nullptr; // In 'format'
+    const unsigned int* mappedIndices = nullptr;
+    size_t mappedVertexCount = 0;
+    size_t mappedIndexCount = 0;
+
+    // Vertex array in 'format'
+    const void* VertexData() const
+    {
+        if (mappedVertices)
+            return mappedVertices;
+        return format == VERTEX_FORMAT_PACKED ? static_cast<const void*>(packedVertices.data()) : vertices.data();
+    }
+    size_t VertexCount() const
+    {
+        if (mappedVertices)
+            return mappedVertexCount;
+        return format == VERTEX_FORMAT_PACKED ? packedVertices.size() : vertices.size();
+    }
+    const unsigned int* IndexData() const { return mappedIndices ? mappedIndices : indices.data(); }
+    size_t IndexCount() const { return mappedIndices ? mappedIndexCount : indices.size(); }
+};
+
+// Everything read from a model file, ready to be uploaded to the GPU
+struct ModelData {
+    std::string path;
+    std::string directory;
+    std::vector<MeshData> meshes;
+    std::vector<ImageData> images;
+    SceneGraph nodes; // Animated nodes of the hierarchy; the static ones are baked into the meshes
+    std::shared_ptr<MappedFile> mapping; // Keeps baked mesh data alive until it is uploaded
+};
+
+// Whether imports store meshes as PackedVertex. Each mesh is still checked on its own and kept as
+// Vertex if its texture coordinates do not fit half floats. Baked files record the setting and are
+// re-imported when it changes. On by default.
+void SetVertexPacking(bool enabled);
+bool VertexPackingEnabled();
+
+// Whether imports run each mesh through OptimizeMesh (welding, vertex cache, overdraw and fetch
+// order). Recorded in baked files like vertex packing. On by default.
+void SetMeshOptimization(bool enabled);
+bool MeshOptimizationEnabled();
+
+// Whether imports simplify each mesh into a LOD chain (see GenerateLods). Recorded in baked files
+// like vertex packing. On by default.
+void SetLodGeneration(bool enabled);
+bool LodGenerationEnabled();
+
+// Whether decoded images are block-compressed with their mips precomputed, cached as .ktx files next
+// to the sources and uploaded with glCompressedTexImage2D. Needs EXT_texture_compression_s3tc, so the
+// renderer turns it off on drivers without it; images are decoded as before then. On by default.
+void SetTextureCompression(bool enabled);
+bool TextureCompressionEnabled();
+
+// Whether compressed textures of new imports are streamed: only the mips up to STREAMING_TAIL_SIZE
+// are read and uploaded at import, and TextureStreaming brings in the rest as they are seen. On by
+// default.
+void SetTextureStreaming(bool enabled);
+bool TextureStreamingEnabled();
+
+// Imports a model file through Assimp and decodes its textures in parallel.
+// Touches no GL state, so it can run on a worker thread.
+std::unique_ptr<ModelData> ImportModel(const std::string& path);
+
+// Loads a model, preferring an up-to-date baked file and baking the import otherwise.
+// Touches no GL state, so it can run on a worker thread.
+std::unique_ptr<ModelData> LoadModelData(const std::string& path);
+
+// Resolves a texture path from a material relative to the model directory
+std::string ResolveTexturePath(const std::string& path, const std::string& directory);
+
+// Decodes an image file with stb_image; returns false if the file could not be read. With texture
+// compression on, an up-to-date cached copy is read instead, or written after decoding; a maxSize
+// then keeps only the mips no larger than it. The result is staged in the PixelBufferRing when it
+// is running, so decoder threads also do the copy for the upload.
+bool DecodeImage(const std::string& filename, ImageData& image, int maxSize = 0);
+
+// Decodes a texture embedded in a model from its encoded file bytes (PNG, JPEG...) in memory, like
+// DecodeImage otherwise. Its compressed copy is cached next to 'path' (see EmbeddedTexturePath) and
+// is current while not older than the model file.
+bool DecodeEmbeddedImage(const unsigned char* data, size_t size, const std::string& path, const std::string& modelPath, ImageData& image, int maxSize = 0);
+
+// Sets the image's TextureCache key from its path and decodes it, unless the cache already holds
+// the texture. With texture streaming on, only the mip tail is kept. Returns false (and clears the
+// key) if the file could not be read.
+bool LoadImageData(const std::string& filename, ImageData& image);
+
+// LoadImageData for a texture embedded in a model, decoded with DecodeEmbeddedImage. It is keyed by
+// its encoded bytes, so an image embedded in several model files is decoded and uploaded once.
+bool LoadEmbeddedImageData(const unsigned char* data, size_t size, const std::string& path, const std::string& modelPath, ImageData& image);
+
+// Path standing for the index-th texture embedded in a model file, used in messages and to name
+// its compressed copy
+std::string EmbeddedTexturePath(const std::string& modelPath, unsigned int index);
+
+// Creates a mipmapped 2D texture from decoded pixels or a compressed mip chain, returns 0 on failure
+unsigned int UploadTexture(const ImageData& image, size_t* bytes = nullptr);
+
+// Imported models waiting for their GL upload on the main thread.
+// Workers push finished imports; the render loop drains the queue within a per-frame time budget.
+class UploadQueue
+{
+public:
+    // The queue holds at most 'capacity' imports; Push blocks while it is full
+    explicit UploadQueue(size_t capacity);
+
+    // Queues an import for upload into the target asset. Returns false if the queue was closed.
+    bool Push(std::weak_ptr<ModelAsset> target, std::unique_ptr<ModelData> data);
+
+    // Uploads textures and meshes until the budget is spent (always at least one step).
+    // Must be called on the thread owning the GL context. Returns the number of steps done.
+    size_t Process(double budgetMs);
+
+    // Number of imports queued or partially uploaded
+    size_t Pending();
+
+    // Wakes blocked producers and rejects further pushes
+    void Close();
+
+    // Discards everything that has not been uploaded yet
+    void Clear();
+
+private:
+    struct Job {
+        std::weak_ptr<ModelAsset> target;
+        std::unique_ptr<ModelData> data;
+        size_t nextImage;
+        size_t nextMesh;
+    };
+
+    std::deque<Job> jobs;
+    std::unique_ptr<Job> current; // Job being uploaded, only touched by the main thread
+    std::mutex mutex;
+    std::condition_variable spaceAvailable;
+    size_t capacity;
+    bool closed;
+
+    // Uploads the next texture or mesh of the current job, returns true when the job is finished
+    bool uploadStep(Job& job);
+};
+
+#endif // MODEL_LOADER_H
@@ -0,0 +1,262 @@
+// PixelBufferRing.cpp
+#include "PixelBufferRing.h"
+#include "GLExtensions.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+// Ranges start on cache line boundaries so decoder threads never share a line
+const size_t RANGE_ALIGNMENT = 64;
+// Longest wait for one fence before checking the ring again
+const GLuint64 FENCE_WAIT_NS = 1000000000;
+
+GLBuffer PixelBufferRing::buffer;
+unsigned char* PixelBufferRing::mapped = nullptr;
+size_t PixelBufferRing::capacity = 0;
+size_t PixelBufferRing::head = 0;
+uint64_t PixelBufferRing::firstId = 1;
+std::deque<PixelBufferRing::Range> PixelBufferRing::ranges;
+std::deque<PixelBufferRing::Fence> PixelBufferRing::fences;
+uint64_t PixelBufferRing::batch = 1;
+uint64_t PixelBufferRing::completedBatch = 0;
+bool PixelBufferRing::batchPending = false;
+uint64_t PixelBufferRing::uploadId = 0;
+PixelUploadStats PixelBufferRing::counters = {};
+PixelUploadStats PixelBufferRing::lastFrame = {};
+std::mutex PixelBufferRing::mutex;
+
+void StagedPixels::reset()
+{
+    if (id != 0)
+        PixelBufferRing::Release(id);
+    id = 0;
+}
+
+bool PixelBufferRing::Init(size_t ringCapacity)
+{
+    if (!glExtensions.bufferStorage || mapped)
+        return mapped != nullptr;
+
+    buffer = GLBuffer::Create();
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glExtensions.BufferStorage(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(ringCapacity), nullptr, flags);
+    mapped = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(ringCapacity), flags));
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (!mapped)
+    {
+        std::cout << "ERROR::PIXEL_BUFFER_RING::MAP_FAILED" << std::endl;
+        buffer.reset();
+        return false;
+    }
+    capacity = ringCapacity;
+    head = 0;
+    return true;
+}
+
+void PixelBufferRing::Shutdown()
+{
+    if (!mapped)
+        return;
+    for (const Fence& fence : fences)
+        glDeleteSync(fence.sync);
+    fences.clear();
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    buffer.reset();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    mapped = nullptr;
+    firstId += ranges.size();
+    ranges.clear();
+}
+
+bool PixelBufferRing::Enabled()
+{
+    return mapped != nullptr;
+}
+
+uint64_t PixelBufferRing::Allocate(size_t size, size_t& offset)
+{
+    size_t aligned = (size + RANGE_ALIGNMENT - 1) / RANGE_ALIGNMENT * RANGE_ALIGNMENT;
+    if (!mapped || size == 0 || aligned > capacity)
+        return 0;
+
+    // Free space runs from head to the oldest live range, wrapping around the end of the buffer;
+    // head never catches up with that range, so head == tail only when the ring is empty
+    if (ranges.empty())
+    {
+        offset = 0;
+    }
+    else
+    {
+        size_t tail = ranges.front().offset;
+        if (head >= tail && capacity - head >= aligned)
+            offset = head;
+        else if (head >= tail && tail > aligned)
+            offset = 0;
+        else if (head < tail && tail - head > aligned)
+            offset = head;
+        else
+            return 0;
+    }
+    ranges.push_back(Range{ offset, aligned, RANGE_STAGED, 0 });
+    head = offset + aligned;
+    return firstId + ranges.size() - 1;
+}
+
+void PixelBufferRing::Release(uint64_t id)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!mapped || id < firstId)
+        return;
+    Range& range = ranges[id - firstId];
+    if (range.state == RANGE_STAGED)
+        range.state = RANGE_FREE;
+    while (!ranges.empty() && ranges.front().state == RANGE_FREE)
+    {
+        ranges.pop_front();
+        firstId++;
+    }
+}
+
+void PixelBufferRing::Retire(bool wait)
+{
+    // Fences pass in order; when waiting, block on the oldest only
+    while (!fences.empty())
+    {
+        GLenum result = glClientWaitSync(fences.front().sync, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? FENCE_WAIT_NS : 0);
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+            break;
+        completedBatch = fences.front().batch;
+        glDeleteSync(fences.front().sync);
+        fences.pop_front();
+        wait = false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    while (!ranges.empty() && (ranges.front().state == RANGE_FREE ||
+        (ranges.front().state == RANGE_SUBMITTED && ranges.front().batch <= completedBatch)))
+    {
+        ranges.pop_front();
+        firstId++;
+    }
+}
+
+StagedPixels PixelBufferRing::Stage(const void* data, size_t size)
+{
+    StagedPixels staged;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        staged.id = Allocate(size, staged.offset);
+        if (staged.id == 0)
+            return staged;
+        staged.size = size;
+        counters.workerStagedBytes += size;
+    }
+    // The range is ours until released, so the copy needs no lock
+    std::memcpy(mapped + staged.offset, data, size);
+    return staged;
+}
+
+const unsigned char* PixelBufferRing::BeginUpload(const void* data, size_t size, const StagedPixels* staged)
+{
+    size_t offset = 0;
+    uint64_t id = 0;
+    if (staged && *staged && staged->size == size)
+    {
+        id = staged->id;
+        offset = staged->offset;
+    }
+    else if (mapped)
+    {
+        // Waiting only helps while the oldest range is one the GPU is reading; a staged one
+        // holds the ring until its own upload
+        bool waitable;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            id = Allocate(size, offset);
+            waitable = !ranges.empty() && ranges.front().state == RANGE_SUBMITTED;
+        }
+        if (id == 0 && waitable && size <= capacity)
+        {
+            // Fence what has been submitted so far so there is something to wait for
+            if (batchPending)
+            {
+                fences.push_back(Fence{ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), batch++ });
+                batchPending = false;
+            }
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            while (id == 0 && waitable && !fences.empty())
+            {
+                Retire(true);
+                std::lock_guard<std::mutex> lock(mutex);
+                id = Allocate(size, offset);
+                waitable = !ranges.empty() && ranges.front().state == RANGE_SUBMITTED;
+            }
+            counters.frameStallMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        if (id != 0)
+            std::memcpy(mapped + offset, data, size);
+    }
+
+    counters.totalBytes += size;
+    if (id == 0)
+    {
+        counters.frameDirectBytes += size;
+        return static_cast<const unsigned char*>(data);
+    }
+    counters.frameUploads++;
+    counters.frameBytes += size;
+    uploadId = id;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+    return reinterpret_cast<const unsigned char*>(offset);
+}
+
+void PixelBufferRing::EndUpload()
+{
+    if (uploadId == 0)
+        return;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    std::lock_guard<std::mutex> lock(mutex);
+    Range& range = ranges[uploadId - firstId];
+    range.state = RANGE_SUBMITTED;
+    range.batch = batch;
+    batchPending = true;
+    uploadId = 0;
+}
+
+void PixelBufferRing::EndFrame()
+{
+    if (batchPending)
+    {
+        fences.push_back(Fence{ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), batch++ });
+        batchPending = false;
+    }
+    Retire(false);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    counters.totalStallMs += counters.frameStallMs;
+    lastFrame = counters;
+    counters.frameUploads = 0;
+    counters.frameBytes = 0;
+    counters.frameDirectBytes = 0;
+    counters.frameStallMs = 0.0;
+}
+
+PixelUploadStats PixelBufferRing::GetStats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    PixelUploadStats stats = lastFrame;
+    stats.totalBytes = counters.totalBytes;
+    stats.workerStagedBytes = counters.workerStagedBytes;
+    stats.totalStallMs = counters.totalStallMs;
+    stats.capacity = capacity;
+    if (!ranges.empty())
+    {
+        size_t tail = ranges.front().offset;
+        stats.usedBytes = head > tail ? head - tail : capacity - tail + head;
+    }
+    return stats;
+}
@@ -0,0 +1,136 @@
+// PixelBufferRing.h
+#ifndef PIXEL_BUFFER_RING_H
+#define PIXEL_BUFFER_RING_H
+
+#include <glad/glad.h> // Holds all OpenGL type declarations
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include "GLResource.h"
+
+// Size of the pixel unpack ring created at startup
+const size_t PIXEL_RING_CAPACITY = size_t(64) << 20;
+
+// A range of the ring holding a copy of some pixel data, made by PixelBufferRing::Stage.
+// Move-only; the range is given back when the handle goes away, unless an upload used it, in
+// which case it is freed once the GPU has read it.
+class StagedPixels
+{
+public:
+    StagedPixels() : id(0), offset(0), size(0) {}
+    ~StagedPixels() { reset(); }
+
+    StagedPixels(const StagedPixels&) = delete;
+    StagedPixels& operator=(const StagedPixels&) = delete;
+
+    StagedPixels(StagedPixels&& other) noexcept : id(other.id), offset(other.offset), size(other.size) { other.id = 0; }
+    StagedPixels& operator=(StagedPixels&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            id = other.id;
+            offset = other.offset;
+            size = other.size;
+            other.id = 0;
+        }
+        return *this;
+    }
+
+    // Gives the range back unless an upload has used it
+    void reset();
+
+    explicit operator bool() const { return id != 0; }
+
+private:
+    friend class PixelBufferRing;
+    uint64_t id;   // Allocation number, 0 when empty
+    size_t offset; // Into the ring
+    size_t size;
+};
+
+// Counters shown in the Scene window
+struct PixelUploadStats {
+    size_t frameUploads;      // Texture uploads sourced from the ring last frame
+    size_t frameBytes;        // Bytes they copied
+    size_t frameDirectBytes;  // Bytes uploaded from client memory because the ring had no room
+    double frameStallMs;      // Time spent waiting for the GPU to free ring space
+    size_t totalBytes;        // Since startup, ring and direct
+    size_t workerStagedBytes; // Since startup, bytes copied into the ring by worker threads
+    double totalStallMs;
+    size_t usedBytes;         // Ring space currently allocated
+    size_t capacity;
+};
+
+// Ring of pixel unpack memory, persistently mapped (GL 4.4 / ARB_buffer_storage), through which
+// texture uploads are made. Decoder threads copy images into it as soon as they are decoded, so the
+// glTexImage calls on the render thread only point the GPU at a buffer offset and return; the copy
+// into the texture overlaps with rendering. Ranges are handed out in order and come back once the
+// fence placed after their upload has passed. Without buffer storage, or when the ring is full or
+// the data is larger than it, uploads read client memory as before.
+// Stage may be called from any thread; everything else runs on the render thread.
+class PixelBufferRing
+{
+public:
+    // Creates and maps the ring; returns false (and stays disabled) without buffer storage
+    static bool Init(size_t capacity = PIXEL_RING_CAPACITY);
+
+    // Unmaps and deletes the ring; staged handles still alive become no-ops
+    static void Shutdown();
+
+    static bool Enabled();
+
+    // Copies data into the ring without waiting; returns an empty handle if there is no room
+    static StagedPixels Stage(const void* data, size_t size);
+
+    // Prepares an upload of 'size' bytes at data: binds the ring as GL_PIXEL_UNPACK_BUFFER and
+    // returns the offset to pass as the glTexImage pixels pointer. Uses staged if it holds the
+    // data, otherwise copies it in now, waiting for the GPU to free room if it must. Returns data
+    // with no unpack buffer bound when the ring cannot take it.
+    static const unsigned char* BeginUpload(const void* data, size_t size, const StagedPixels* staged = nullptr);
+
+    // Unbinds the unpack buffer; the range BeginUpload used is freed once the GPU is past this point
+    static void EndUpload();
+
+    // Fences the frame's uploads, frees the ranges the GPU is done with and rolls the frame counters
+    static void EndFrame();
+
+    static PixelUploadStats GetStats();
+
+private:
+    friend class StagedPixels;
+
+    enum RangeState { RANGE_STAGED, RANGE_SUBMITTED, RANGE_FREE };
+    struct Range {
+        size_t offset;
+        size_t size;
+        RangeState state;
+        uint64_t batch; // Upload batch of a submitted range
+    };
+    struct Fence {
+        GLsync sync;
+        uint64_t batch; // Last batch it covers
+    };
+
+    static GLBuffer buffer;
+    static unsigned char* mapped;
+    static size_t capacity;
+    static size_t head;                 // Where the next range goes
+    static uint64_t firstId;            // Allocation number of ranges.front()
+    static std::deque<Range> ranges;    // Live ranges in allocation order
+    static std::deque<Fence> fences;
+    static uint64_t batch;              // Batch the current uploads belong to
+    static uint64_t completedBatch;     // Last batch the GPU is done with
+    static bool batchPending;           // The current batch has uploads but no fence yet
+    static uint64_t uploadId;           // Range of the upload between BeginUpload and EndUpload
+    static PixelUploadStats counters;   // Frame counters of the frame in progress, and the totals
+    static PixelUploadStats lastFrame;
+    static std::mutex mutex;            // Guards ranges, head and the counters Stage touches
+
+    static uint64_t Allocate(size_t size, size_t& offset);
+    static void Release(uint64_t id);
+    static void Retire(bool wait);
+};
+
+#endif // PIXEL_BUFFER_RING_H
@@ -0,0 +1,426 @@
+// Profiler.cpp
+#include "Profiler.h"
+#include "imgui.h"
+#include "nlohmann/json.hpp"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using json = nlohmann::json;
+
+thread_local uint32_t profileScopeDepth = 0;
+
+// Events of one thread in a ring only that thread writes. Readers copy what is published by
+// 'written' and drop whatever the writer may have lapped while they copied.
+struct ProfileThreadBuffer {
+    std::string name;
+    uint32_t lane;
+    std::atomic<uint64_t> written;
+    uint64_t frameRead; // Render thread's cursor for the per-frame snapshot
+    std::unique_ptr<ProfileEvent[]> events;
+};
+
+// GPU ranges are read back this many frames after they were issued
+static const int GPU_FRAMES = 4;
+static const int GPU_RANGES_PER_FRAME = 64;
+
+struct GpuFrame {
+    const char* names[GPU_RANGES_PER_FRAME];
+    uint32_t depths[GPU_RANGES_PER_FRAME];
+    int count;
+    int64_t clockOffset; // CPU clock minus GPU clock when the frame began
+};
+
+static std::mutex threadsMutex;
+static std::vector<std::unique_ptr<ProfileThreadBuffer>> threads;
+static thread_local ProfileThreadBuffer* currentThread = nullptr;
+
+// Last finished frame, as the window shows it
+static std::vector<ProfileEvent> frameEvents;
+static uint64_t frameBegin = 0, frameEnd = 0, nextFrameBegin = 0;
+static bool paused = false;
+static std::string exportMessage;
+
+static bool gpuReady = false;
+static GLuint gpuQueries[GPU_FRAMES][GPU_RANGES_PER_FRAME][2];
+static GpuFrame gpuFrames[GPU_FRAMES];
+static int gpuFrame = 0;
+static uint32_t gpuDepth = 0;
+static size_t gpuFramesDropped = 0; // Frames whose results were not ready in time
+static std::vector<ProfileEvent> gpuFrameEvents; // Ranges of the last frame read back
+static std::vector<ProfileEvent> gpuHistory;     // Ring of every range read back, for export
+static uint64_t gpuWritten = 0;
+
+// Clock readings taken together at startup; the tick rate is measured from here on
+static const uint64_t epochNs = Profiler::Now();
+static const uint64_t epochTicks = Profiler::Ticks();
+
+// Nanoseconds per tick over the run so far, which gets more precise the longer it runs
+static double NsPerTick()
+{
+#ifdef PROFILER_USE_TSC
+    uint64_t ticks = Profiler::Ticks() - epochTicks;
+    return ticks > 0 ? static_cast<double>(Profiler::Now() - epochNs) / ticks : 1.0;
+#else
+    return 1.0;
+#endif
+}
+
+static uint64_t TicksToNs(uint64_t ticks, double nsPerTick)
+{
+    return epochNs + static_cast<int64_t>(static_cast<int64_t>(ticks - epochTicks) * nsPerTick);
+}
+
+static ProfileThreadBuffer& ThreadBuffer()
+{
+    if (!currentThread)
+    {
+        std::unique_ptr<ProfileThreadBuffer> buffer(new ProfileThreadBuffer());
+        buffer->written = 0;
+        buffer->frameRead = 0;
+        buffer->events.reset(new ProfileEvent[Profiler::THREAD_CAPACITY]);
+        std::lock_guard<std::mutex> lock(threadsMutex);
+        buffer->lane = static_cast<uint32_t>(threads.size());
+        buffer->name = "Thread " + std::to_string(buffer->lane);
+        currentThread = buffer.get();
+        threads.push_back(std::move(buffer));
+    }
+    return *currentThread;
+}
+
+// Appends the intact events written at or after 'from', in nanoseconds, and returns how far the buffer was read
+static uint64_t ReadEvents(const ProfileThreadBuffer& buffer, uint64_t from, std::vector<ProfileEvent>& out)
+{
+    double nsPerTick = NsPerTick();
+    const uint64_t capacity = Profiler::THREAD_CAPACITY;
+    uint64_t written = buffer.written.load(std::memory_order_acquire);
+    uint64_t first = std::max(from, written > capacity ? written - capacity : 0);
+    size_t start = out.size();
+    for (uint64_t i = first; i < written; i++)
+        out.push_back(buffer.events[i & (capacity - 1)]);
+
+    // The slot being written next may hold the oldest copied event
+    uint64_t after = buffer.written.load(std::memory_order_acquire);
+    uint64_t intact = after >= capacity ? after - capacity + 1 : 0;
+    if (intact > first)
+        out.erase(out.begin() + start, out.begin() + start + static_cast<size_t>(std::min(intact, written) - first));
+    for (size_t i = start; i < out.size(); i++)
+    {
+        out[i].begin = TicksToNs(out[i].begin, nsPerTick);
+        out[i].end = TicksToNs(out[i].end, nsPerTick);
+    }
+    return written;
+}
+
+bool Profiler::Compiled()
+{
+#ifdef PROFILER_ENABLED
+    return true;
+#else
+    return false;
+#endif
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+    ProfileThreadBuffer& buffer = ThreadBuffer();
+    std::lock_guard<std::mutex> lock(threadsMutex);
+    buffer.name = name;
+}
+
+void Profiler::Record(const char* name, uint64_t begin, uint64_t end, uint32_t depth)
+{
+    ProfileThreadBuffer& buffer = ThreadBuffer();
+    uint64_t index = buffer.written.load(std::memory_order_relaxed);
+    ProfileEvent& event = buffer.events[index & (THREAD_CAPACITY - 1)];
+    event.name = name;
+    event.begin = begin;
+    event.end = end;
+    event.depth = depth;
+    event.lane = buffer.lane;
+    buffer.written.store(index + 1, std::memory_order_release);
+}
+
+void Profiler::InitGpu()
+{
+    if (!Compiled() || gpuReady)
+        return;
+    glGenQueries(GPU_FRAMES * GPU_RANGES_PER_FRAME * 2, &gpuQueries[0][0][0]);
+    for (GpuFrame& frame : gpuFrames)
+        frame.count = 0;
+    gpuHistory.resize(THREAD_CAPACITY);
+    gpuReady = true;
+}
+
+int Profiler::BeginGpuRange(const char* name)
+{
+    GpuFrame& frame = gpuFrames[gpuFrame];
+    if (!gpuReady || frame.count == GPU_RANGES_PER_FRAME)
+        return -1;
+    int range = frame.count++;
+    frame.names[range] = name;
+    frame.depths[range] = gpuDepth++;
+    glQueryCounter(gpuQueries[gpuFrame][range][0], GL_TIMESTAMP);
+    return range;
+}
+
+void Profiler::EndGpuRange(int range)
+{
+    if (range < 0)
+        return;
+    glQueryCounter(gpuQueries[gpuFrame][range][1], GL_TIMESTAMP);
+    gpuDepth--;
+}
+
+void Profiler::BeginFrame()
+{
+    uint64_t now = Now();
+    ThreadBuffer(); // The render thread always has a lane
+
+    // CPU: the events finished since the last call make up the frame that just ended
+    {
+        std::lock_guard<std::mutex> lock(threadsMutex);
+        if (!paused)
+        {
+            frameEvents.clear();
+            frameBegin = nextFrameBegin;
+            frameEnd = now;
+        }
+        for (const std::unique_ptr<ProfileThreadBuffer>& buffer : threads)
+        {
+            if (paused)
+                buffer->frameRead = buffer->written.load(std::memory_order_acquire);
+            else
+                buffer->frameRead = ReadEvents(*buffer, buffer->frameRead, frameEvents);
+        }
+    }
+    nextFrameBegin = now;
+
+    if (!gpuReady)
+        return;
+
+    // GPU: the slot about to be reused was issued GPU_FRAMES frames ago
+    gpuFrame = (gpuFrame + 1) % GPU_FRAMES;
+    GpuFrame& frame = gpuFrames[gpuFrame];
+    if (frame.count > 0)
+    {
+        GLint available = 0;
+        glGetQueryObjectiv(gpuQueries[gpuFrame][frame.count - 1][1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available)
+        {
+            if (!paused)
+                gpuFrameEvents.clear();
+            for (int range = 0; range < frame.count; range++)
+            {
+                GLuint64 begin = 0, end = 0;
+                glGetQueryObjectui64v(gpuQueries[gpuFrame][range][0], GL_QUERY_RESULT, &begin);
+                glGetQueryObjectui64v(gpuQueries[gpuFrame][range][1], GL_QUERY_RESULT, &end);
+                ProfileEvent event;
+                event.name = frame.names[range];
+                event.begin = static_cast<uint64_t>(static_cast<int64_t>(begin) + frame.clockOffset);
+                event.end = static_cast<uint64_t>(static_cast<int64_t>(end) + frame.clockOffset);
+                event.depth = frame.depths[range];
+                event.lane = GPU_LANE;
+                gpuHistory[gpuWritten++ & (THREAD_CAPACITY - 1)] = event;
+                if (!paused)
+                    gpuFrameEvents.push_back(event);
+            }
+        }
+        else
+        {
+            gpuFramesDropped++;
+        }
+    }
+    frame.count = 0;
+    gpuDepth = 0;
+
+    // Ties this frame's GPU timestamps to the CPU clock
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    frame.clockOffset = static_cast<int64_t>(Now()) - static_cast<int64_t>(gpuNow);
+}
+
+// Color of a marker, stable per name
+static ImU32 EventColor(const char* name)
+{
+    uint32_t hash = 2166136261u;
+    for (const char* c = name; *c; c++)
+        hash = (hash ^ static_cast<unsigned char>(*c)) * 16777619u;
+    return ImColor::HSV((hash % 360) / 360.0f, 0.45f, 0.75f);
+}
+
+// One row of the timeline: the events of a lane, nested ones stacked below their parents
+static void DrawLane(const std::string& label, int id, const std::vector<const ProfileEvent*>& events, uint64_t start, double pixelsPerNs)
+{
+    uint32_t maxDepth = 0;
+    for (const ProfileEvent* event : events)
+        maxDepth = std::max(maxDepth, event->depth);
+    const float rowHeight = ImGui::GetTextLineHeight() + 4.0f;
+    const float width = std::max(ImGui::GetContentRegionAvail().x, 1.0f);
+
+    ImGui::TextUnformatted(label.c_str());
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    ImVec2 size(width, rowHeight * (maxDepth + 1));
+    ImGui::PushID(id);
+    ImGui::InvisibleButton("lane", size);
+    ImGui::PopID();
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    drawList->PushClipRect(origin, ImVec2(origin.x + size.x, origin.y + size.y), true);
+    for (const ProfileEvent* event : events)
+    {
+        float x0 = origin.x + static_cast<float>((static_cast<double>(event->begin) - static_cast<double>(start)) * pixelsPerNs);
+        float x1 = origin.x + static_cast<float>((static_cast<double>(event->end) - static_cast<double>(start)) * pixelsPerNs);
+        x1 = std::max(x1, x0 + 1.0f);
+        float y0 = origin.y + event->depth * rowHeight;
+        ImVec2 min(x0, y0), max(x1, y0 + rowHeight - 1.0f);
+        drawList->AddRectFilled(min, max, EventColor(event->name));
+        if (x1 - x0 > ImGui::CalcTextSize(event->name).x + 4.0f)
+            drawList->AddText(ImVec2(x0 + 2.0f, y0 + 2.0f), IM_COL32(0, 0, 0, 255), event->name);
+        if (ImGui::IsMouseHoveringRect(min, max))
+            ImGui::SetTooltip("%s: %.3f ms", event->name, (event->end - event->begin) / 1e6);
+    }
+    drawList->PopClipRect();
+}
+
+void Profiler::DrawWindow()
+{
+    ImGui::Begin("Profiler");
+    if (!Compiled())
+    {
+        ImGui::Text("Markers are compiled out (build without PROFILER_ENABLED)");
+        ImGui::End();
+        return;
+    }
+
+    double frameMs = (frameEnd - frameBegin) / 1e6;
+    ImGui::Text("CPU frame: %.2f ms, %zu markers", frameMs, frameEvents.size());
+    if (gpuReady)
+    {
+        double gpuMs = 0.0;
+        for (const ProfileEvent& event : gpuFrameEvents)
+            gpuMs += event.depth == 0 ? (event.end - event.begin) / 1e6 : 0.0;
+        ImGui::Text("GPU: %.2f ms in %zu ranges, %d frames behind (%zu frames not ready in time)", gpuMs, gpuFrameEvents.size(),
+            GPU_FRAMES - 1, gpuFramesDropped);
+    }
+    else
+    {
+        ImGui::Text("GPU timing: off");
+    }
+    ImGui::Checkbox("Pause", &paused);
+    ImGui::SameLine();
+    if (ImGui::Button("Export Chrome trace"))
+        exportMessage = ExportChromeTrace("profile.json") ? "Wrote profile.json" : "Failed to write profile.json";
+    if (!exportMessage.empty())
+    {
+        ImGui::SameLine();
+        ImGui::TextUnformatted(exportMessage.c_str());
+    }
+    ImGui::Separator();
+
+    // One lane per thread that finished a marker this frame, clipped to the frame
+    std::map<uint32_t, std::vector<const ProfileEvent*>> lanes;
+    for (const ProfileEvent& event : frameEvents)
+    {
+        if (event.end > frameBegin)
+            lanes[event.lane].push_back(&event);
+    }
+    double pixelsPerNs = std::max(ImGui::GetContentRegionAvail().x, 1.0f) / std::max<double>(static_cast<double>(frameEnd - frameBegin), 1.0);
+    for (const auto& lane : lanes)
+    {
+        std::string label;
+        {
+            std::lock_guard<std::mutex> lock(threadsMutex);
+            label = threads[lane.first]->name;
+        }
+        DrawLane(label, static_cast<int>(lane.first), lane.second, frameBegin, pixelsPerNs);
+    }
+    // GPU ranges of an older frame on the same scale, starting at its first range
+    if (!gpuFrameEvents.empty())
+    {
+        std::vector<const ProfileEvent*> events;
+        uint64_t start = gpuFrameEvents[0].begin;
+        for (const ProfileEvent& event : gpuFrameEvents)
+        {
+            events.push_back(&event);
+            start = std::min(start, event.begin);
+        }
+        DrawLane("GPU", -1, events, start, pixelsPerNs);
+    }
+    ImGui::Separator();
+
+    // Time per marker name over all threads, longest first
+    std::map<std::string, std::pair<double, size_t>> totals;
+    for (const ProfileEvent& event : frameEvents)
+    {
+        std::pair<double, size_t>& total = totals[event.name];
+        total.first += (event.end - event.begin) / 1e6;
+        total.second++;
+    }
+    std::vector<std::pair<std::string, std::pair<double, size_t>>> sorted(totals.begin(), totals.end());
+    std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.second.first > b.second.first; });
+    for (const auto& total : sorted)
+        ImGui::Text("%-24s %8.3f ms  x%zu", total.first.c_str(), total.second.first, total.second.second);
+
+    ImGui::End();
+}
+
+bool Profiler::ExportChromeTrace(const std::string& path)
+{
+    std::vector<ProfileEvent> events;
+    json trace;
+    trace["displayTimeUnit"] = "ms";
+    trace["traceEvents"] = json::array();
+    json& traceEvents = trace["traceEvents"];
+    uint32_t gpuTid;
+    {
+        std::lock_guard<std::mutex> lock(threadsMutex);
+        for (const std::unique_ptr<ProfileThreadBuffer>& buffer : threads)
+        {
+            ReadEvents(*buffer, 0, events);
+            traceEvents.push_back({ { "name", "thread_name" }, { "ph", "M" }, { "pid", 1 }, { "tid", buffer->lane },
+                { "args", { { "name", buffer->name } } } });
+        }
+        gpuTid = static_cast<uint32_t>(threads.size());
+    }
+    for (uint64_t i = gpuWritten > gpuHistory.size() ? gpuWritten - gpuHistory.size() : 0; i < gpuWritten; i++)
+        events.push_back(gpuHistory[i & (THREAD_CAPACITY - 1)]);
+    if (gpuWritten > 0)
+    {
+        traceEvents.push_back({ { "name", "thread_name" }, { "ph", "M" }, { "pid", 1 }, { "tid", gpuTid },
+            { "args", { { "name", "GPU" } } } });
+    }
+
+    // Microseconds from the oldest event, which keeps the numbers short
+    uint64_t base = UINT64_MAX;
+    for (const ProfileEvent& event : events)
+        base = std::min(base, event.begin);
+    for (const ProfileEvent& event : events)
+    {
+        bool gpu = event.lane == GPU_LANE;
+        traceEvents.push_back({ { "name", event.name }, { "cat", gpu ? "gpu" : "cpu" }, { "ph", "X" },
+            { "ts", (event.begin - base) / 1000.0 }, { "dur", (event.end - event.begin) / 1000.0 },
+            { "pid", 1 }, { "tid", gpu ? gpuTid : event.lane } });
+    }
+
+    std::ofstream file(path);
+    if (!file.is_open())
+    {
+        std::cout << "ERROR::PROFILER::CANNOT_WRITE_TRACE: " << path << std::endl;
+        return false;
+    }
+    file << trace.dump();
+    return file.good();
+}
+
+void Profiler::Shutdown()
+{
+    if (!gpuReady)
+        return;
+    glDeleteQueries(GPU_FRAMES * GPU_RANGES_PER_FRAME * 2, &gpuQueries[0][0][0]);
+    gpuReady = false;
+}
@@ -0,0 +1,140 @@
+// Profiler.h
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <glad/glad.h> // Holds all OpenGL type declarations
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define PROFILER_USE_TSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILER_USE_TSC
+#endif
+
+// Scoped CPU markers and GPU ranges, shown in the Profiler window and exportable as a Chrome trace.
+// They are compiled in when PROFILER_ENABLED is defined (every configuration but Release); otherwise
+// the macros expand to nothing and the window says so.
+//
+//   PROFILE_SCOPE("Cull");      // CPU time of the enclosing block on the calling thread
+//   PROFILE_GPU_SCOPE("Scene"); // CPU time plus GPU time of the GL commands issued in the block (render thread)
+//
+// Names must be string literals, or otherwise outlive the profiler; only the pointer is stored.
+
+// A finished marker. Times are nanoseconds on Profiler::Now's clock.
+struct ProfileEvent {
+    const char* name;
+    uint64_t begin;
+    uint64_t end;
+    uint32_t depth; // Markers open around it on the same thread (or GPU ranges, for the GPU lane)
+    uint32_t lane;  // Thread it ran on, in registration order; Profiler::GPU_LANE for GPU ranges
+};
+
+class Profiler
+{
+public:
+    static const uint32_t GPU_LANE = 0xFFFFFFFFu;
+
+    // Events kept per thread; older ones are overwritten
+    static const size_t THREAD_CAPACITY = size_t(1) << 14;
+
+    // True when the markers are compiled in
+    static bool Compiled();
+
+    // Nanoseconds on the steady clock, the time base of every event handed out
+    static uint64_t Now()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    // What markers stamp themselves with: the CPU's time stamp counter where there is one (constant
+    // rate on any recent x86, and a fraction of the cost of the OS clock), converted to nanoseconds
+    // only when events are read
+    static uint64_t Ticks()
+    {
+#ifdef PROFILER_USE_TSC
+        return __rdtsc();
+#else
+        return Now();
+#endif
+    }
+
+    // Names the calling thread's lane in the window and the trace
+    static void SetThreadName(const char* name);
+
+    // Creates the timer queries for GPU ranges; the GL context must be current. Without it GPU scopes
+    // only measure the CPU side.
+    static void InitGpu();
+
+    // Ends the frame in progress and starts the next, on the render thread: the ended frame's events
+    // become what the window shows, and GPU ranges from a few frames back are read if they are ready.
+    static void BeginFrame();
+
+    // Draws the Profiler window: a timeline of the last frame per thread with nested markers stacked,
+    // the GPU ranges below it, and the export button
+    static void DrawWindow();
+
+    // Writes every event still held as Chrome trace JSON (chrome://tracing, ui.perfetto.dev)
+    static bool ExportChromeTrace(const std::string& path);
+
+    // Deletes the timer queries while the context is still current
+    static void Shutdown();
+
+    // Used by the scopes below; times are in ticks
+    static void Record(const char* name, uint64_t begin, uint64_t end, uint32_t depth);
+    static int BeginGpuRange(const char* name);
+    static void EndGpuRange(int range);
+};
+
+// Nesting depth of the open CPU scopes on each thread
+extern thread_local uint32_t profileScopeDepth;
+
+class CpuProfileScope
+{
+public:
+    explicit CpuProfileScope(const char* name) : name(name), depth(profileScopeDepth++), begin(Profiler::Ticks()) {}
+    ~CpuProfileScope()
+    {
+        Profiler::Record(name, begin, Profiler::Ticks(), depth);
+        profileScopeDepth--;
+    }
+
+    CpuProfileScope(const CpuProfileScope&) = delete;
+    CpuProfileScope& operator=(const CpuProfileScope&) = delete;
+
+private:
+    const char* name;
+    uint32_t depth;
+    uint64_t begin;
+};
+
+class GpuProfileScope
+{
+public:
+    explicit GpuProfileScope(const char* name) : cpu(name), range(Profiler::BeginGpuRange(name)) {}
+    ~GpuProfileScope() { Profiler::EndGpuRange(range); }
+
+    GpuProfileScope(const GpuProfileScope&) = delete;
+    GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+private:
+    CpuProfileScope cpu;
+    int range; // -1 when GPU timing is off or this frame's ranges ran out
+};
+
+#define PROFILER_CONCAT_INNER(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_INNER(a, b)
+#ifdef PROFILER_ENABLED
+#define PROFILE_SCOPE(name) CpuProfileScope PROFILER_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_GPU_SCOPE(name) GpuProfileScope PROFILER_CONCAT(profileScope, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_GPU_SCOPE(name) ((void)0)
+#endif
+
+#endif // PROFILER_H
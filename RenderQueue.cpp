@@ -0,0 +1,163 @@
+// RenderQueue.cpp
+#include "RenderQueue.h"
+#include "Mesh.h"
+#include "Shader.h"
+#include "GLExtensions.h"
+#include <algorithm>
+
+uint64_t RenderQueue::MakeKey(GLuint program, uint32_t material, uint32_t textures, GLuint vertexArray, float depth)
+{
+    const uint64_t depthMax = (1u << DEPTH_BITS) - 1;
+    uint64_t depthBits = static_cast<uint64_t>(std::min(std::max(depth, 0.0f), 1.0f) * depthMax);
+    uint64_t key = program & ((1u << PROGRAM_BITS) - 1);
+    key = (key << MATERIAL_BITS) | (material & ((1u << MATERIAL_BITS) - 1));
+    key = (key << TEXTURE_BITS) | (textures & ((1u << TEXTURE_BITS) - 1));
+    key = (key << VERTEX_ARRAY_BITS) | (vertexArray & ((1u << VERTEX_ARRAY_BITS) - 1));
+    key = (key << DEPTH_BITS) | depthBits;
+    return key;
+}
+
+void RenderQueue::Sort()
+{
+    size_t count = packets.size();
+    if (count < 2)
+        return;
+    scratch.resize(count);
+
+    // All eight histograms in one pass over the keys
+    size_t histograms[8][256] = {};
+    for (const DrawPacket& packet : packets)
+    {
+        for (int pass = 0; pass < 8; pass++)
+            histograms[pass][(packet.key >> (pass * 8)) & 0xFF]++;
+    }
+
+    for (int pass = 0; pass < 8; pass++)
+    {
+        size_t* histogram = histograms[pass];
+        int shift = pass * 8;
+        if (histogram[(packets[0].key >> shift) & 0xFF] == count)
+            continue; // Every key has the same byte here
+
+        size_t offset = 0;
+        for (int bucket = 0; bucket < 256; bucket++)
+        {
+            size_t bucketCount = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketCount;
+        }
+        for (const DrawPacket& packet : packets)
+            scratch[histogram[(packet.key >> shift) & 0xFF]++] = packet;
+        packets.swap(scratch);
+    }
+}
+
+void RenderQueue::Submit()
+{
+    stats = RenderQueueStats();
+    stats.packets = packets.size();
+
+    bool indirect = multiDrawIndirect && glExtensions.multiDrawIndirect;
+    if (indirect && !packets.empty())
+        uploadCommands();
+
+    const Shader* currentShader = nullptr;
+    uint32_t currentMaterial = 0xFFFFFFFFu;
+    uint32_t currentTextures = 0xFFFFFFFFu;
+    GLuint currentVertexArray = 0;
+    GLuint currentInstanceBuffer = 0;
+    bool first = true;
+    for (size_t i = 0; i < packets.size();)
+    {
+        const DrawPacket& packet = packets[i];
+        const Mesh& mesh = *packet.mesh;
+        // A new program invalidates the uniforms set through the old one
+        if (first || packet.shader != currentShader)
+        {
+            packet.shader->use();
+            currentShader = packet.shader;
+            currentMaterial = currentTextures = 0xFFFFFFFFu;
+            stats.programChanges++;
+        }
+        if (mesh.materialKey != currentMaterial)
+        {
+            mesh.BindMaterial(*packet.shader, *packet.uniforms);
+            currentMaterial = mesh.materialKey;
+            stats.materialChanges++;
+        }
+        if (mesh.textureKey != currentTextures)
+        {
+            mesh.BindTextures(*packet.shader, *packet.uniforms);
+            currentTextures = mesh.textureKey;
+            stats.textureChanges++;
+        }
+        bool vertexArrayChanged = first || mesh.VertexArray() != currentVertexArray;
+        if (vertexArrayChanged)
+        {
+            glBindVertexArray(mesh.VertexArray());
+            currentVertexArray = mesh.VertexArray();
+            stats.vertexArrayChanges++;
+        }
+        if (first || packet.instanceBuffer != currentInstanceBuffer)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, packet.instanceBuffer);
+            currentInstanceBuffer = packet.instanceBuffer;
+            stats.instanceBufferChanges++;
+            vertexArrayChanged = true;
+        }
+        first = false;
+
+        if (!indirect)
+        {
+            mesh.DrawInstances(packet.lod, packet.instanceOffset, packet.instanceCount);
+            stats.drawCalls++;
+            i++;
+            continue;
+        }
+
+        // The instance attributes start at the buffer's beginning; each command's baseInstance picks its slice
+        if (vertexArrayChanged)
+            SetInstanceAttributes(0);
+        size_t last = i + 1;
+        while (last < packets.size()
+            && packets[last].shader == packet.shader
+            && packets[last].mesh->materialKey == mesh.materialKey
+            && packets[last].mesh->textureKey == mesh.textureKey
+            && packets[last].mesh->VertexArray() == currentVertexArray
+            && packets[last].mesh->IndexType() == mesh.IndexType()
+            && packets[last].instanceBuffer == currentInstanceBuffer)
+            last++;
+        glExtensions.MultiDrawElementsIndirect(GL_TRIANGLES, mesh.IndexType(),
+            (void*)(i * sizeof(DrawElementsIndirectCommand)), static_cast<GLsizei>(last - i), 0);
+        stats.drawCalls++;
+        i = last;
+    }
+
+    if (!packets.empty())
+    {
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        if (indirect)
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+}
+
+void RenderQueue::uploadCommands()
+{
+    commands.resize(packets.size());
+    for (size_t i = 0; i < packets.size(); i++)
+    {
+        const DrawPacket& packet = packets[i];
+        GLuint baseInstance = static_cast<GLuint>(packet.instanceOffset / sizeof(InstanceData));
+        commands[i] = packet.mesh->IndirectCommand(packet.lod, baseInstance, static_cast<GLuint>(packet.instanceCount));
+    }
+
+    if (indirectBuffer == 0)
+        indirectBuffer = GLBuffer::Create();
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+    GLsizeiptr size = static_cast<GLsizeiptr>(commands.size() * sizeof(DrawElementsIndirectCommand));
+    if (size > indirectCapacity)
+        indirectCapacity = std::max(size, indirectCapacity * 2);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, indirectCapacity, NULL, GL_STREAM_DRAW); // Grow or orphan
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, size, commands.data());
+}
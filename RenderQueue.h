@@ -0,0 +1,88 @@
+// RenderQueue.h
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glad/glad.h> // Holds all OpenGL type declarations
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "GLResource.h"
+#include "MeshArena.h"
+
+class Mesh;
+class Shader;
+struct MaterialUniforms;
+
+// One instanced draw and the state it needs
+struct DrawPacket {
+    uint64_t key; // See RenderQueue::MakeKey
+    const Mesh* mesh;
+    uint32_t lod;      // Level of detail of mesh to draw
+    Shader* shader;
+    const MaterialUniforms* uniforms;
+    GLuint instanceBuffer;
+    GLintptr instanceOffset;
+    GLsizei instanceCount;
+};
+
+// State changes made by the last Submit, and how many packets reused the previous state instead
+struct RenderQueueStats {
+    size_t packets = 0;
+    size_t programChanges = 0;
+    size_t materialChanges = 0;
+    size_t textureChanges = 0;
+    size_t vertexArrayChanges = 0;
+    size_t instanceBufferChanges = 0;
+    size_t drawCalls = 0; // GL draw calls, fewer than packets when multi-draw indirect merges them
+
+    size_t StateChanges() const { return programChanges + materialChanges + textureChanges + vertexArrayChanges + instanceBufferChanges; }
+    size_t StateChangesAvoided() const { return packets * 5 - StateChanges(); }
+};
+
+// Collects the frame's draws, sorts them by a 64-bit state key and submits them, only touching
+// GL state that differs from the previous packet. With multi-draw indirect available, each run of
+// packets sharing all state goes out as one glMultiDrawElementsIndirect call.
+class RenderQueue
+{
+public:
+    // Key bits, most significant first: program, material, texture set, VAO + index type, depth
+    static const int PROGRAM_BITS = 6;
+    static const int MATERIAL_BITS = 16;
+    static const int TEXTURE_BITS = 16;
+    static const int VERTEX_ARRAY_BITS = 16;
+    static const int DEPTH_BITS = 10;
+
+    RenderQueueStats stats;
+
+    // Merge runs into indirect draws when the driver supports it; off draws one packet at a time
+    bool multiDrawIndirect = true;
+
+    // Packs the state into a sort key; ids are masked to their field width. vertexArray is
+    // Mesh::GeometryKey, so meshes with different index types sort apart.
+    // depth is the view distance over the far plane (0..1) and orders draws front to back within a state.
+    static uint64_t MakeKey(GLuint program, uint32_t material, uint32_t textures, GLuint vertexArray, float depth);
+
+    void Clear() { packets.clear(); }
+    void Push(const DrawPacket& packet) { packets.push_back(packet); }
+
+    // LSD radix sort on the key, 8 bits per pass; passes where every key has the same byte are skipped
+    void Sort();
+
+    // Issues every packet in order and fills in stats
+    void Submit();
+
+    const std::vector<DrawPacket>& Packets() const { return packets; }
+
+private:
+    std::vector<DrawPacket> packets;
+    std::vector<DrawPacket> scratch;
+
+    // Commands for every packet, uploaded once per Submit
+    std::vector<DrawElementsIndirectCommand> commands;
+    GLBuffer indirectBuffer;
+    GLsizeiptr indirectCapacity = 0;
+
+    void uploadCommands();
+};
+
+#endif // RENDER_QUEUE_H
@@ -0,0 +1,94 @@
+// Scene.cpp
+#include "Scene.h"
+
+ModelHandle Scene::Add(Model model, const glm::vec3& position, const glm::vec3& rotation, const glm::vec3& scale)
+{
+    uint32_t slot;
+    if (!freeSlots.empty())
+    {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    else
+    {
+        slot = static_cast<uint32_t>(slotIndices.size());
+        slotIndices.push_back(ModelHandle::NO_SLOT);
+        generations.push_back(0);
+    }
+
+    slotIndices[slot] = static_cast<uint32_t>(models.size());
+    owners.push_back(slot);
+    bounds.push_back(model.bounds);
+    models.push_back(std::move(model));
+    transforms.Add(position, rotation, scale);
+    return ModelHandle{ slot, generations[slot] };
+}
+
+bool Scene::Remove(ModelHandle handle)
+{
+    size_t index = IndexOf(handle);
+    if (index == NO_INDEX)
+        return false;
+
+    size_t last = models.size() - 1;
+    if (index != last)
+    {
+        models[index] = std::move(models[last]);
+        bounds[index] = bounds[last];
+        owners[index] = owners[last];
+        slotIndices[owners[index]] = static_cast<uint32_t>(index);
+    }
+    models.pop_back();
+    bounds.pop_back();
+    owners.pop_back();
+    transforms.Remove(index);
+
+    slotIndices[handle.slot] = ModelHandle::NO_SLOT;
+    generations[handle.slot]++;
+    freeSlots.push_back(handle.slot);
+    return true;
+}
+
+void Scene::Clear()
+{
+    models.clear();
+    bounds.clear();
+    owners.clear();
+    transforms.Resize(0);
+    // Every live slot goes stale
+    freeSlots.clear();
+    for (uint32_t slot = 0; slot < slotIndices.size(); slot++)
+    {
+        if (slotIndices[slot] != ModelHandle::NO_SLOT)
+            generations[slot]++;
+        slotIndices[slot] = ModelHandle::NO_SLOT;
+        freeSlots.push_back(slot);
+    }
+}
+
+size_t Scene::IndexOf(ModelHandle handle) const
+{
+    if (handle.slot >= slotIndices.size() || generations[handle.slot] != handle.generation || slotIndices[handle.slot] == ModelHandle::NO_SLOT)
+        return NO_INDEX;
+    return slotIndices[handle.slot];
+}
+
+const std::vector<uint32_t>& Scene::UpdateTransforms()
+{
+    transforms.Update();
+    for (uint32_t index : transforms.Updated())
+    {
+        models[index].SetTransform(transforms.ModelMatrix(index), transforms.NormalMatrix(index));
+        bounds[index] = models[index].bounds;
+    }
+    return transforms.Updated();
+}
+
+void Scene::RefreshBounds()
+{
+    for (size_t i = 0; i < models.size(); i++)
+    {
+        models[i].RefreshBounds();
+        bounds[i] = models[i].bounds;
+    }
+}
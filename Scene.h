@@ -0,0 +1,73 @@
+// Scene.h
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Bounds.h"
+#include "Model.h"
+#include "TransformCache.h"
+
+// Reference to a model in a Scene. Slots are reused once their model is removed, under a new
+// generation, so a handle to a removed model is caught instead of reaching whichever model took its slot.
+struct ModelHandle {
+    static constexpr uint32_t NO_SLOT = 0xFFFFFFFFu;
+
+    uint32_t slot = NO_SLOT;
+    uint32_t generation = 0;
+
+    bool operator==(const ModelHandle& other) const { return slot == other.slot && generation == other.generation; }
+    bool operator!=(const ModelHandle& other) const { return !(*this == other); }
+};
+
+// The models placed in the scene, kept by component in dense arrays that share one index: transforms
+// and world bounds, which the per-frame passes stream through, and the Model objects with the asset,
+// path and per-mesh state. Removing a model moves the last one into its place, so the arrays stay
+// packed and nothing behind it shifts; handles follow the move, indices do not.
+class Scene
+{
+public:
+    static constexpr size_t NO_INDEX = static_cast<size_t>(-1);
+
+    TransformCache transforms; // Position, rotation and scale of each model and the matrices built from them
+    std::vector<Bounds> bounds; // World-space bounds of each model, copied from the model as they change
+    std::vector<Model> models;
+
+    size_t Size() const { return models.size(); }
+
+    // Places a model with the given transform; its matrices are built by the next UpdateTransforms
+    ModelHandle Add(Model model, const glm::vec3& position = glm::vec3(0.0f), const glm::vec3& rotation = glm::vec3(0.0f),
+        const glm::vec3& scale = glm::vec3(1.0f));
+
+    // Removes a model, moving the last one into its index. Returns false if the handle is stale.
+    bool Remove(ModelHandle handle);
+
+    void Clear();
+
+    // Index of a model in the arrays, or NO_INDEX if the handle is stale
+    size_t IndexOf(ModelHandle handle) const;
+    ModelHandle HandleAt(size_t index) const { return ModelHandle{ owners[index], generations[owners[index]] }; }
+
+    // Stores a new transform for the model at an index
+    void SetTransform(size_t index, const glm::vec3& position, const glm::vec3& rotation, const glm::vec3& scale)
+    {
+        transforms.Set(index, position, rotation, scale);
+    }
+
+    // Rebuilds the matrices of the models whose transform changed and updates their bounds. Returns
+    // the indices of those models.
+    const std::vector<uint32_t>& UpdateTransforms();
+
+    // Picks up the meshes uploaded since the last call into every model's bounds
+    void RefreshBounds();
+
+private:
+    std::vector<uint32_t> slotIndices; // Index of each slot's model, NO_SLOT while free
+    std::vector<uint32_t> generations; // Generation of each slot, bumped when its model is removed
+    std::vector<uint32_t> owners;      // Slot of the model at each index
+    std::vector<uint32_t> freeSlots;
+};
+
+#endif // SCENE_H
@@ -0,0 +1,67 @@
+// SceneGraph.cpp
+#include "SceneGraph.h"
+
+uint32_t SceneGraph::Add(int32_t parent, const glm::mat4& local)
+{
+    parents.push_back(parent);
+    locals.push_back(local);
+    return static_cast<uint32_t>(parents.size() - 1);
+}
+
+void SceneGraph::Propagate(const glm::mat4& root, glm::mat4* worlds) const
+{
+    // Parents come first, so their world transform is always ready
+    for (size_t i = 0; i < parents.size(); i++)
+        worlds[i] = (parents[i] < 0 ? root : worlds[parents[i]]) * locals[i];
+}
+
+SceneGraph SceneGraph::Flatten(const std::vector<unsigned char>& dynamic, std::vector<FlattenedNode>& placement) const
+{
+    SceneGraph flattened;
+    placement.resize(parents.size());
+    for (size_t i = 0; i < parents.size(); i++)
+    {
+        int32_t parent = parents[i];
+        int32_t keptParent = parent < 0 ? -1 : placement[parent].node;
+        glm::mat4 offset = (parent < 0 ? glm::mat4(1.0f) : placement[parent].offset) * locals[i];
+        if (dynamic[i])
+            placement[i] = FlattenedNode{ static_cast<int32_t>(flattened.Add(keptParent, offset)), glm::mat4(1.0f) };
+        else
+            placement[i] = FlattenedNode{ keptParent, offset };
+    }
+    return flattened;
+}
+
+SceneGraph SceneGraph::SortByDepth(const SceneGraph& graph, std::vector<uint32_t>& remap)
+{
+    // Children lists in one array, then breadth first from the nodes below the root
+    size_t count = graph.Size();
+    std::vector<uint32_t> childStart(count + 2, 0), children(count);
+    for (int32_t parent : graph.parents)
+        childStart[parent + 2]++;
+    for (size_t i = 2; i < childStart.size(); i++)
+        childStart[i] += childStart[i - 1];
+    for (size_t i = 0; i < count; i++)
+        children[childStart[graph.parents[i] + 1]++] = static_cast<uint32_t>(i);
+    // childStart[p + 1] now ends the children of p, which start where those of p - 1 end
+
+    std::vector<uint32_t> order;
+    order.reserve(count);
+    for (uint32_t i = 0; i < childStart[0]; i++)
+        order.push_back(children[i]);
+    for (size_t next = 0; next < order.size(); next++)
+    {
+        uint32_t node = order[next];
+        for (uint32_t i = childStart[node]; i < childStart[node + 1]; i++)
+            order.push_back(children[i]);
+    }
+
+    SceneGraph sorted;
+    remap.assign(count, 0);
+    for (uint32_t node : order)
+    {
+        int32_t parent = graph.parents[node];
+        remap[node] = sorted.Add(parent < 0 ? -1 : static_cast<int32_t>(remap[parent]), graph.locals[node]);
+    }
+    return sorted;
+}
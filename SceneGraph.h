@@ -0,0 +1,43 @@
+// SceneGraph.h
+#ifndef SCENE_GRAPH_H
+#define SCENE_GRAPH_H
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Where a node of a flattened graph ended up (see SceneGraph::Flatten)
+struct FlattenedNode {
+    int32_t node;     // Kept node it moves with, -1 for the root
+    glm::mat4 offset; // Transform from that node's space to this node's
+};
+
+// Node hierarchy as flat arrays, parents before children (depth-sorted), so world transforms follow
+// from one pass in order with no recursion or pointer chasing. Nodes below the root have parent -1.
+class SceneGraph
+{
+public:
+    std::vector<int32_t> parents;
+    std::vector<glm::mat4> locals; // Relative to the parent
+
+    size_t Size() const { return parents.size(); }
+
+    // Appends a node; the parent must already be in the graph. Returns its index.
+    uint32_t Add(int32_t parent, const glm::mat4& local);
+
+    // Writes the world transform of every node: root * the locals down to it
+    void Propagate(const glm::mat4& root, glm::mat4* worlds) const;
+
+    // Keeps only the nodes flagged dynamic and folds the static ones into them: each kept node's
+    // local becomes its transform relative to the nearest kept ancestor. Fills placement with, per
+    // node of this graph, the kept node it moves with and its offset from it, which is what geometry
+    // attached to a static node gets baked with.
+    SceneGraph Flatten(const std::vector<unsigned char>& dynamic, std::vector<FlattenedNode>& placement) const;
+
+    // Reorders a graph whose parents may come after their children, breadth first. Fills remap with
+    // the new index of each old node.
+    static SceneGraph SortByDepth(const SceneGraph& graph, std::vector<uint32_t>& remap);
+};
+
+#endif // SCENE_GRAPH_H
@@ -9,6 +9,13 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <unordered_map>
+
+// Pre-resolved location of a uniform of type T; -1 if the program has no such active uniform.
+template <typename T>
+struct Uniform {
+    GLint location = -1;
+};
 
 class Shader
 {
@@ -16,18 +23,47 @@ public:
     // The program ID
     unsigned int ID;
 
-    // Constructor reads and builds the shader
-    Shader(const char* vertexPath, const char* fragmentPath);
+    // Constructor reads and builds the shader. defines (e.g. "#define FOO\n") is inserted after each stage's #version line.
+    Shader(const char* vertexPath, const char* fragmentPath, const std::string& defines = "");
 
     // Use/activate the shader
     void use();
 
+    // Returns the location of an active uniform from the table built at link time (-1 if inactive)
+    GLint getUniformLocation(const std::string& name) const;
+
+    // Resolves a typed handle once, for use in hot paths
+    template <typename T>
+    Uniform<T> getUniform(const std::string& name) const
+    {
+        Uniform<T> uniform;
+        uniform.location = getUniformLocation(name);
+        return uniform;
+    }
+
+    // Uniform updates through pre-resolved handles: no string handling and no driver lookup
+    void set(Uniform<bool> uniform, bool value) const;
+    void set(Uniform<int> uniform, int value) const;
+    void set(Uniform<float> uniform, float value) const;
+    void set(Uniform<glm::vec3> uniform, const glm::vec3& value) const;
+    void set(Uniform<glm::mat4> uniform, const glm::mat4& mat) const;
+
     // Utility uniform functions
     void setBool(const std::string& name, bool value) const;
     void setInt(const std::string& name, int value) const;
     void setFloat(const std::string& name, float value) const;
     void setVec3(const std::string& name, const glm::vec3& value) const;
     void setMat4(const std::string& name, const glm::mat4& mat) const;
+
+private:
+    // Active uniform locations by name, filled once after linking
+    std::unordered_map<std::string, GLint> uniformLocations;
+
+    // Queries every active uniform of the linked program
+    void reflectUniforms();
+
+    // Attaches the program's uniform blocks to the engine's shared binding points
+    void bindUniformBlocks();
 };
 
 #endif // SHADER_H
@@ -2,12 +2,18 @@
 #ifndef TEXTURE_H
 #define TEXTURE_H
 
+#include <cstdint>
 #include <string>
 
+// Texture::streamId of textures whose mips are not streamed
+const uint32_t NO_TEXTURE_STREAM = 0xFFFFFFFFu;
+
 struct Texture {
     unsigned int id;
     std::string type;
     std::string path;
+    size_t bytes = 0; // GPU memory used by the texture when uploaded, including mips
+    uint32_t streamId = NO_TEXTURE_STREAM; // TextureStreaming id
 };
 
 #endif // TEXTURE_H
@@ -0,0 +1,103 @@
+// TextureCache.cpp
+#include "TextureCache.h"
+#include "ModelLoader.h"
+#include "TextureStreaming.h"
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+
+std::unordered_map<std::string, std::weak_ptr<SharedTexture>> TextureCache::textures;
+std::mutex TextureCache::mutex;
+size_t TextureCache::hits = 0;
+size_t TextureCache::misses = 0;
+
+SharedTexture::~SharedTexture()
+{
+    if (streamId != NO_TEXTURE_STREAM)
+        TextureStreaming::Unregister(streamId);
+}
+
+std::string TextureCache::PathKey(const std::string& path)
+{
+    return std::filesystem::path(path).lexically_normal().generic_string();
+}
+
+std::string TextureCache::ContentKey(const void* data, size_t size)
+{
+    uint64_t hash = 14695981039346656037ull;
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    char key[48];
+    std::snprintf(key, sizeof(key), "#%016llx-%zu", static_cast<unsigned long long>(hash), size);
+    return key;
+}
+
+bool TextureCache::IsResident(const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = textures.find(key);
+    return it != textures.end() && !it->second.expired();
+}
+
+TextureHandle TextureCache::Find(const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = textures.find(key);
+    if (it == textures.end())
+        return nullptr;
+    TextureHandle texture = it->second.lock();
+    if (texture)
+        hits++;
+    return texture;
+}
+
+TextureHandle TextureCache::Upload(const ImageData& image)
+{
+    std::shared_ptr<SharedTexture> texture = std::make_shared<SharedTexture>();
+    texture->bytes = 0;
+    texture->object = GLTexture(UploadTexture(image, &texture->bytes));
+    texture->key = image.key;
+    std::string compressedPath = CompressedTexturePath(image.path);
+    if (texture->object != 0 && image.compressed.format != 0 && TextureStreamingEnabled() && std::filesystem::exists(compressedPath))
+        texture->streamId = TextureStreaming::Register(texture->object, compressedPath, image.compressed);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    misses++;
+    if (texture->object != 0 && !image.key.empty())
+        textures[image.key] = texture;
+    return texture;
+}
+
+TextureCacheStats TextureCache::GetStats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    TextureCacheStats stats = {};
+    stats.hits = hits;
+    stats.misses = misses;
+
+    // Drop entries whose texture has been released while counting the live ones
+    for (auto it = textures.begin(); it != textures.end();)
+    {
+        std::shared_ptr<SharedTexture> texture = it->second.lock();
+        if (!texture)
+        {
+            it = textures.erase(it);
+            continue;
+        }
+        stats.texturesResident++;
+        stats.bytesResident += texture->bytes;
+        ++it;
+    }
+    return stats;
+}
+
+void TextureCache::ResetCounters()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    hits = 0;
+    misses = 0;
+}
@@ -0,0 +1,77 @@
+// TextureCache.h
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "GLResource.h"
+#include "Texture.h"
+
+struct ImageData;
+
+// A GL texture shared by every asset that uses the same image; deleted with its last handle
+struct SharedTexture {
+    GLTexture object;
+    size_t bytes; // GPU memory when uploaded, including mips
+    std::string key;
+    uint32_t streamId = NO_TEXTURE_STREAM; // Set if TextureStreaming manages its mips
+
+    ~SharedTexture();
+};
+typedef std::shared_ptr<const SharedTexture> TextureHandle;
+
+// Counters describing how well the cache is doing
+struct TextureCacheStats {
+    size_t hits;             // Textures served from one already uploaded
+    size_t misses;           // Textures that had to be uploaded
+    size_t texturesResident; // Textures currently alive
+    size_t bytesResident;    // GPU bytes of the live textures
+
+    double HitRate() const { return hits + misses > 0 ? static_cast<double>(hits) / (hits + misses) : 0.0; }
+};
+
+// Process-wide registry of uploaded textures, keyed by normalized file path (LoadImageData) or, for
+// image data embedded in a model file, by a hash of its encoded bytes (LoadEmbeddedImageData), so
+// an image embedded in several models is shared too. Like the AssetCache it only holds weak
+// references: assets own handles, and a texture is deleted when the last asset using it is.
+// Lookups and uploads happen on the render thread; IsResident may be called from import workers
+// so they can skip decoding images that are already on the GPU.
+class TextureCache
+{
+public:
+    // Key for an image file: the lexically normalized path with forward slashes
+    static std::string PathKey(const std::string& path);
+
+    // Key for encoded image bytes embedded in a model (64-bit FNV-1a of the content and its size);
+    // set by LoadEmbeddedImageData
+    static std::string ContentKey(const void* data, size_t size);
+
+    // True if a texture with this key is alive; thread-safe
+    static bool IsResident(const std::string& key);
+
+    // Returns the live texture for the key, or null if there is none
+    static TextureHandle Find(const std::string& key);
+
+    // Uploads a decoded image and registers it under its key. An image that fails to upload gets a
+    // handle to texture 0 and is not registered. With texture streaming on, compressed images read
+    // from a .ktx file are handed to TextureStreaming.
+    static TextureHandle Upload(const ImageData& image);
+
+    // Returns the current hit/miss and residency counters
+    static TextureCacheStats GetStats();
+
+    // Resets the hit/miss counters (residency is left untouched)
+    static void ResetCounters();
+
+private:
+    static std::unordered_map<std::string, std::weak_ptr<SharedTexture>> textures;
+    static std::mutex mutex; // Guards textures against IsResident calls from workers
+    static size_t hits;
+    static size_t misses;
+};
+
+#endif // TEXTURE_CACHE_H
@@ -0,0 +1,324 @@
+// TextureCompression.cpp
+#include "TextureCompression.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#define STB_DXT_IMPLEMENTATION
+#include "stb_dxt.h"
+
+// KTX 1.1 file identifier and the value of its endianness field as written by this machine
+static const unsigned char KTX_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+const uint32_t KTX_ENDIANNESS = 0x04030201;
+
+struct KTXHeader {
+    unsigned char identifier[12];
+    uint32_t endianness;
+    uint32_t glType;           // 0 for compressed formats
+    uint32_t glTypeSize;
+    uint32_t glFormat;         // 0 for compressed formats
+    uint32_t glInternalFormat;
+    uint32_t glBaseInternalFormat;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t numberOfArrayElements;
+    uint32_t numberOfFaces;
+    uint32_t numberOfMipmapLevels;
+    uint32_t bytesOfKeyValueData;
+};
+
+static size_t BlockBytes(GLenum format)
+{
+    return format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || format == GL_COMPRESSED_RED_RGTC1 ? 8 : 16;
+}
+
+static GLenum BaseFormat(GLenum format)
+{
+    switch (format)
+    {
+    case GL_COMPRESSED_RED_RGTC1: return GL_RED;
+    case GL_COMPRESSED_RG_RGTC2: return GL_RG;
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT: return GL_RGB;
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: return GL_RGBA;
+    default: return 0;
+    }
+}
+
+static size_t LevelSize(GLenum format, int width, int height)
+{
+    return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * BlockBytes(format);
+}
+
+uint32_t MipLevelCount(int width, int height)
+{
+    uint32_t levels = 1;
+    for (int size = std::max(width, height); size > 1; size /= 2)
+        levels++;
+    return levels;
+}
+
+uint32_t FirstLevelWithin(int width, int height, int maxSize)
+{
+    uint32_t level = 0;
+    for (int size = std::max(width, height); size > maxSize && size > 1; size /= 2)
+        level++;
+    return level;
+}
+
+std::string CompressedTexturePath(const std::string& imagePath)
+{
+    return imagePath + ".ktx";
+}
+
+bool IsCompressedTextureCurrent(const std::string& imagePath, const std::string& compressedPath)
+{
+    std::error_code error;
+    std::filesystem::file_time_type compressedTime = std::filesystem::last_write_time(compressedPath, error);
+    if (error)
+        return false;
+    std::filesystem::file_time_type imageTime = std::filesystem::last_write_time(imagePath, error);
+    if (error)
+        return false;
+    return compressedTime >= imageTime;
+}
+
+const char* CompressedFormatName(GLenum format)
+{
+    switch (format)
+    {
+    case GL_COMPRESSED_RED_RGTC1: return "BC4";
+    case GL_COMPRESSED_RG_RGTC2: return "BC5";
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT: return "BC1";
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: return "BC3";
+    default: return "none";
+    }
+}
+
+bool CompressImage(const unsigned char* pixels, int width, int height, int components, CompressedImage& image)
+{
+    image = CompressedImage();
+    if (!pixels || width <= 0 || height <= 0 || components < 1 || components > 4)
+        return false;
+
+    bool opaque = true;
+    if (components == 4)
+    {
+        size_t count = static_cast<size_t>(width) * height;
+        for (size_t i = 0; i < count && opaque; i++)
+            opaque = pixels[i * 4 + 3] == 255;
+    }
+    static const GLenum formats[4] = { GL_COMPRESSED_RED_RGTC1, GL_COMPRESSED_RG_RGTC2, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT };
+    image.format = components == 4 && opaque ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : formats[components - 1];
+    size_t blockBytes = BlockBytes(image.format);
+
+    std::vector<unsigned char> level(pixels, pixels + static_cast<size_t>(width) * height * components);
+    std::vector<unsigned char> next;
+    unsigned char block[16 * 4];
+    uint32_t levelCount = MipLevelCount(width, height);
+    for (uint32_t mip = 0; mip < levelCount; mip++)
+    {
+        CompressedLevel compressed = { width, height, image.data.size(), LevelSize(image.format, width, height) };
+        image.data.resize(compressed.offset + compressed.size);
+        unsigned char* out = image.data.data() + compressed.offset;
+
+        // 4x4 blocks, repeating the last row and column where the level is not a multiple of 4
+        for (int by = 0; by < height; by += 4)
+        {
+            for (int bx = 0; bx < width; bx += 4)
+            {
+                for (int y = 0; y < 4; y++)
+                {
+                    for (int x = 0; x < 4; x++)
+                    {
+                        const unsigned char* source = &level[(static_cast<size_t>(std::min(by + y, height - 1)) * width + std::min(bx + x, width - 1)) * components];
+                        unsigned char* texel = block + (y * 4 + x) * (components == 3 ? 4 : components);
+                        std::memcpy(texel, source, components);
+                        if (components == 3)
+                            texel[3] = 255;
+                    }
+                }
+                if (image.format == GL_COMPRESSED_RED_RGTC1)
+                    stb_compress_bc4_block(out, block);
+                else if (image.format == GL_COMPRESSED_RG_RGTC2)
+                    stb_compress_bc5_block(out, block);
+                else
+                    stb_compress_dxt_block(out, block, image.format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, STB_DXT_HIGHQUAL);
+                out += blockBytes;
+            }
+        }
+        image.levels.push_back(compressed);
+        image.lastLevel = mip;
+
+        // Box filter to the next level; an odd last row or column is averaged with itself
+        int nextWidth = std::max(width / 2, 1), nextHeight = std::max(height / 2, 1);
+        next.resize(static_cast<size_t>(nextWidth) * nextHeight * components);
+        for (int y = 0; y < nextHeight; y++)
+        {
+            int y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+            for (int x = 0; x < nextWidth; x++)
+            {
+                int x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+                for (int c = 0; c < components; c++)
+                {
+                    int sum = level[(static_cast<size_t>(y0) * width + x0) * components + c] + level[(static_cast<size_t>(y0) * width + x1) * components + c]
+                        + level[(static_cast<size_t>(y1) * width + x0) * components + c] + level[(static_cast<size_t>(y1) * width + x1) * components + c];
+                    next[(static_cast<size_t>(y) * nextWidth + x) * components + c] = static_cast<unsigned char>((sum + 2) / 4);
+                }
+            }
+        }
+        level.swap(next);
+        width = nextWidth;
+        height = nextHeight;
+    }
+    return true;
+}
+
+bool WriteCompressedTexture(const CompressedImage& image, const std::string& path)
+{
+    if (image.format == 0 || image.levels.empty() || image.firstLevel != 0 || image.lastLevel + 1 != image.levels.size())
+        return false;
+
+    KTXHeader header = {};
+    std::memcpy(header.identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER));
+    header.endianness = KTX_ENDIANNESS;
+    header.glTypeSize = 1;
+    header.glInternalFormat = image.format;
+    header.glBaseInternalFormat = BaseFormat(image.format);
+    header.pixelWidth = static_cast<uint32_t>(image.levels[0].width);
+    header.pixelHeight = static_cast<uint32_t>(image.levels[0].height);
+    header.numberOfFaces = 1;
+    header.numberOfMipmapLevels = static_cast<uint32_t>(image.levels.size());
+
+    // Write to a temporary file and move it in place so readers never see a partial file
+    std::string tempPath = path + ".tmp";
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        std::cout << "ERROR::TEXTURE::Failed to open " << tempPath << " for writing" << std::endl;
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const CompressedLevel& level : image.levels)
+    {
+        // Block sizes are multiples of 4, so levels need no padding
+        uint32_t imageSize = static_cast<uint32_t>(level.size);
+        file.write(reinterpret_cast<const char*>(&imageSize), sizeof(imageSize));
+        file.write(reinterpret_cast<const char*>(image.data.data() + level.offset), static_cast<std::streamsize>(level.size));
+    }
+    file.close();
+
+    std::error_code error;
+    if (!file)
+    {
+        std::cout << "ERROR::TEXTURE::Failed to write " << tempPath << std::endl;
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    std::filesystem::rename(tempPath, path, error);
+    if (error)
+    {
+        std::cout << "ERROR::TEXTURE::Failed to replace " << path << ": " << error.message() << std::endl;
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    return true;
+}
+
+bool ReadCompressedTexture(const std::string& path, CompressedImage& image, uint32_t firstLevel, uint32_t lastLevel, int maxSize)
+{
+    image = CompressedImage();
+    std::ifstream file(path, std::ios::binary);
+    KTXHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+        return false;
+    if (std::memcmp(header.identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) != 0 || header.endianness != KTX_ENDIANNESS ||
+        header.glType != 0 || header.glFormat != 0 || BaseFormat(header.glInternalFormat) == 0 ||
+        header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth != 0 || header.numberOfArrayElements != 0 ||
+        header.numberOfFaces != 1 || header.numberOfMipmapLevels != MipLevelCount(header.pixelWidth, header.pixelHeight))
+        return false;
+    file.seekg(header.bytesOfKeyValueData, std::ios::cur);
+
+    image.format = header.glInternalFormat;
+    if (maxSize > 0)
+        firstLevel = std::max(firstLevel, FirstLevelWithin(header.pixelWidth, header.pixelHeight, maxSize));
+    image.lastLevel = std::min(lastLevel, header.numberOfMipmapLevels - 1);
+    image.firstLevel = std::min(firstLevel, image.lastLevel);
+    int width = static_cast<int>(header.pixelWidth), height = static_cast<int>(header.pixelHeight);
+    for (uint32_t mip = 0; mip < header.numberOfMipmapLevels; mip++)
+    {
+        CompressedLevel level = { width, height, image.data.size(), LevelSize(image.format, width, height) };
+        image.levels.push_back(level);
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+        if (mip > image.lastLevel)
+            continue;
+
+        uint32_t imageSize = 0;
+        bool valid = file.read(reinterpret_cast<char*>(&imageSize), sizeof(imageSize)) && imageSize == level.size;
+        if (valid && mip < image.firstLevel)
+        {
+            valid = static_cast<bool>(file.seekg(level.size, std::ios::cur));
+        }
+        else if (valid)
+        {
+            image.data.resize(level.offset + level.size);
+            valid = static_cast<bool>(file.read(reinterpret_cast<char*>(image.data.data() + level.offset), static_cast<std::streamsize>(level.size)));
+        }
+        if (!valid)
+        {
+            image = CompressedImage();
+            return false;
+        }
+    }
+    return true;
+}
+
+unsigned int UploadCompressedTexture(const CompressedImage& image, size_t* bytes)
+{
+    return UploadCompressedTexture(image, bytes, image.data.data());
+}
+
+unsigned int UploadCompressedTexture(const CompressedImage& image, size_t* bytes, const unsigned char* source)
+{
+    if (image.format == 0 || image.levels.empty())
+        return 0;
+
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    UploadCompressedLevels(textureID, image, source);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(image.levels.size() - 1));
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    if (bytes)
+    {
+        *bytes = 0;
+        for (uint32_t mip = image.firstLevel; mip <= image.lastLevel; mip++)
+            *bytes += image.levels[mip].size;
+    }
+    return textureID;
+}
+
+void UploadCompressedLevels(GLuint texture, const CompressedImage& image)
+{
+    UploadCompressedLevels(texture, image, image.data.data());
+}
+
+void UploadCompressedLevels(GLuint texture, const CompressedImage& image, const unsigned char* source)
+{
+    glBindTexture(GL_TEXTURE_2D, texture);
+    for (uint32_t mip = image.firstLevel; mip <= image.lastLevel && mip < image.levels.size(); mip++)
+    {
+        const CompressedLevel& level = image.levels[mip];
+        glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(mip), image.format, level.width, level.height, 0,
+            static_cast<GLsizei>(level.size), source + level.offset);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(image.firstLevel));
+}
@@ -0,0 +1,78 @@
+// TextureCompression.h
+#ifndef TEXTURE_COMPRESSION_H
+#define TEXTURE_COMPRESSION_H
+
+#include <glad/glad.h> // Holds all OpenGL type declarations
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// EXT_texture_compression_s3tc formats; glad is generated for 3.3 core, which only has RGTC
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// One mip level of a CompressedImage
+struct CompressedLevel {
+    int width;
+    int height;
+    size_t offset; // Into CompressedImage::data
+    size_t size;
+};
+
+// A block-compressed texture with its whole mip chain, down to 1x1. The format follows the source:
+// BC4 (RGTC1) for 1 component, BC5 (RGTC2) for 2, BC1 (DXT1) for 3 and for 4 when fully opaque,
+// BC3 (DXT5) otherwise.
+struct CompressedImage {
+    GLenum format = 0; // 0 when empty
+    std::vector<CompressedLevel> levels; // Every level of the chain, loaded or not
+    std::vector<unsigned char> data;
+    // Levels held in data and uploaded; the offsets of the others are meaningless
+    uint32_t firstLevel = 0;
+    uint32_t lastLevel = 0;
+};
+
+// Compressed copies are cached next to the source image with this extension appended
+std::string CompressedTexturePath(const std::string& imagePath);
+
+// True if the cached copy exists and is not older than the source image
+bool IsCompressedTextureCurrent(const std::string& imagePath, const std::string& compressedPath);
+
+// Builds the mip chain with a box filter and compresses every level with stb_dxt.
+// Returns false for component counts it has no format for.
+bool CompressImage(const unsigned char* pixels, int width, int height, int components, CompressedImage& image);
+
+// Writes / reads a KTX 1.1 file holding a compressed image. Reading fails on files with other
+// formats, array layers, faces or a truncated mip chain. Only levels firstLevel to lastLevel are
+// read (clamped to the chain), and with a maxSize only those no larger than it; the others are
+// skipped over.
+bool WriteCompressedTexture(const CompressedImage& image, const std::string& path);
+bool ReadCompressedTexture(const std::string& path, CompressedImage& image, uint32_t firstLevel = 0, uint32_t lastLevel = UINT32_MAX, int maxSize = 0);
+
+// Number of levels in a full mip chain down to 1x1
+uint32_t MipLevelCount(int width, int height);
+
+// First level of a mip chain whose width and height are no larger than maxSize
+uint32_t FirstLevelWithin(int width, int height, int maxSize);
+
+// Name of a compressed format for logs ("BC1", ...)
+const char* CompressedFormatName(GLenum format);
+
+// Creates a 2D texture from the loaded levels of a compressed image without generating mips on the
+// GPU, returns 0 on failure. The texture's base level is the first loaded one. bytes receives the
+// exact GPU size of the uploaded levels. The overload taking a source reads the level data from
+// there instead of image.data (an offset into a bound pixel unpack buffer holding a copy of it,
+// which may well be 0).
+unsigned int UploadCompressedTexture(const CompressedImage& image, size_t* bytes = nullptr);
+unsigned int UploadCompressedTexture(const CompressedImage& image, size_t* bytes, const unsigned char* source);
+
+// Adds the loaded levels of a compressed image to a texture made by UploadCompressedTexture and
+// moves its base level to the first of them; source as above
+void UploadCompressedLevels(GLuint texture, const CompressedImage& image);
+void UploadCompressedLevels(GLuint texture, const CompressedImage& image, const unsigned char* source);
+
+#endif // TEXTURE_COMPRESSION_H
@@ -0,0 +1,319 @@
+// TextureStreaming.cpp
+#include "TextureStreaming.h"
+#include "Model.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+uint32_t StreamingWantedLevel(int width, int height, float projectedPixels)
+{
+    float size = static_cast<float>(std::max(width, height));
+    if (projectedPixels >= size)
+        return 0;
+    uint32_t level = static_cast<uint32_t>(std::floor(std::log2(size / std::max(projectedPixels, 1.0f))));
+    return std::min(level, MipLevelCount(width, height) - 1);
+}
+
+size_t TextureResidency::BytesFrom(const StreamedTexture& texture, uint32_t level)
+{
+    size_t bytes = 0;
+    for (size_t i = level; i < texture.levelBytes.size(); i++)
+        bytes += texture.levelBytes[i];
+    return bytes;
+}
+
+uint32_t TextureResidency::Add(const std::vector<size_t>& levelBytes, uint32_t tailLevel, uint32_t residentLevel)
+{
+    StreamedTexture texture;
+    texture.levelBytes = levelBytes;
+    texture.tailLevel = std::min(tailLevel, static_cast<uint32_t>(levelBytes.size() - 1));
+    texture.residentLevel = std::min(residentLevel, texture.tailLevel);
+    texture.loadingLevel = texture.residentLevel;
+    texture.wantedLevel = texture.tailLevel;
+    texture.lastUsedFrame = 0;
+    texture.streamable = true;
+    committedBytes += BytesFrom(texture, texture.residentLevel);
+
+    uint32_t id = nextId++;
+    textures.emplace(id, std::move(texture));
+    return id;
+}
+
+void TextureResidency::Remove(uint32_t texture)
+{
+    auto it = textures.find(texture);
+    if (it == textures.end())
+        return;
+    const StreamedTexture& removed = it->second;
+    committedBytes -= BytesFrom(removed, std::min(removed.residentLevel, removed.loadingLevel));
+    if (removed.loadingLevel != removed.residentLevel)
+        loadsInFlight--;
+    textures.erase(it);
+}
+
+void TextureResidency::Request(uint32_t texture, uint32_t level, uint64_t frame)
+{
+    auto it = textures.find(texture);
+    if (it == textures.end())
+        return;
+    StreamedTexture& requested = it->second;
+    level = std::min(level, static_cast<uint32_t>(requested.levelBytes.size() - 1));
+    if (requested.lastUsedFrame != frame)
+        requested.wantedLevel = level;
+    else
+        requested.wantedLevel = std::min(requested.wantedLevel, level);
+    requested.lastUsedFrame = frame;
+}
+
+void TextureResidency::Update(uint64_t frame, size_t maxLoadsInFlight, std::vector<Change>& evictions, std::vector<Change>& loads)
+{
+    evictions.clear();
+    loads.clear();
+
+    // Idle textures only: one that is loading keeps its levels until the load lands
+    std::vector<uint32_t> victims, wanting;
+    for (const auto& entry : textures)
+    {
+        const StreamedTexture& texture = entry.second;
+        if (texture.loadingLevel != texture.residentLevel)
+            continue;
+        bool used = texture.lastUsedFrame == frame;
+        if (texture.residentLevel < texture.tailLevel && (!used || texture.residentLevel < texture.wantedLevel))
+            victims.push_back(entry.first);
+        if (used && texture.streamable && texture.wantedLevel < texture.residentLevel)
+            wanting.push_back(entry.first);
+    }
+    std::sort(victims.begin(), victims.end(), [&](uint32_t a, uint32_t b)
+    {
+        const StreamedTexture& ta = textures[a];
+        const StreamedTexture& tb = textures[b];
+        bool usedA = ta.lastUsedFrame == frame, usedB = tb.lastUsedFrame == frame;
+        if (usedA != usedB)
+            return usedB;
+        if (ta.lastUsedFrame != tb.lastUsedFrame)
+            return ta.lastUsedFrame < tb.lastUsedFrame;
+        return a < b;
+    });
+    std::sort(wanting.begin(), wanting.end(), [&](uint32_t a, uint32_t b)
+    {
+        uint32_t missingA = textures[a].residentLevel - textures[a].wantedLevel;
+        uint32_t missingB = textures[b].residentLevel - textures[b].wantedLevel;
+        return missingA != missingB ? missingA > missingB : a < b;
+    });
+
+    // Evicts levels, in victim order, until 'bytes' more fit in the budget
+    size_t victim = 0;
+    auto makeRoom = [&](size_t bytes)
+    {
+        while (committedBytes + bytes > budget && victim < victims.size())
+        {
+            uint32_t id = victims[victim];
+            StreamedTexture& texture = textures[id];
+            uint32_t floor = texture.lastUsedFrame == frame ? texture.wantedLevel : texture.tailLevel;
+            if (texture.residentLevel >= floor)
+            {
+                victim++;
+                continue;
+            }
+            committedBytes -= texture.levelBytes[texture.residentLevel];
+            texture.residentLevel++;
+            texture.loadingLevel = texture.residentLevel;
+            evictionCount++;
+            if (!evictions.empty() && evictions.back().texture == id)
+                evictions.back().level = texture.residentLevel;
+            else
+                evictions.push_back(Change{ id, texture.residentLevel });
+        }
+        return committedBytes + bytes <= budget;
+    };
+
+    // The budget may have shrunk since the last frame
+    makeRoom(0);
+    for (uint32_t id : wanting)
+    {
+        if (loadsInFlight >= maxLoadsInFlight)
+            break;
+        StreamedTexture& texture = textures[id];
+        uint32_t level = texture.residentLevel - 1;
+        // Lower priority loads wait too, so the blurriest textures are not starved by small ones
+        if (!makeRoom(texture.levelBytes[level]))
+            break;
+        committedBytes += texture.levelBytes[level];
+        texture.loadingLevel = level;
+        loadsInFlight++;
+        loads.push_back(Change{ id, level });
+    }
+}
+
+void TextureResidency::Loaded(uint32_t texture, bool success)
+{
+    auto it = textures.find(texture);
+    if (it == textures.end() || it->second.loadingLevel == it->second.residentLevel)
+        return;
+    StreamedTexture& loaded = it->second;
+    loadsInFlight--;
+    if (success)
+    {
+        loaded.residentLevel = loaded.loadingLevel;
+        loadCount++;
+        return;
+    }
+    committedBytes -= loaded.levelBytes[loaded.loadingLevel];
+    loaded.loadingLevel = loaded.residentLevel;
+    loaded.streamable = false;
+}
+
+const TextureResidency::StreamedTexture* TextureResidency::Find(uint32_t texture) const
+{
+    auto it = textures.find(texture);
+    return it != textures.end() ? &it->second : nullptr;
+}
+
+TextureResidency::Stats TextureResidency::GetStats(uint64_t frame) const
+{
+    Stats stats = {};
+    stats.textures = textures.size();
+    stats.committedBytes = committedBytes;
+    stats.loadsInFlight = loadsInFlight;
+    stats.loads = loadCount;
+    stats.evictions = evictionCount;
+    for (const auto& entry : textures)
+    {
+        const StreamedTexture& texture = entry.second;
+        stats.residentBytes += BytesFrom(texture, texture.residentLevel);
+        if (texture.lastUsedFrame == frame)
+            stats.wantedBytes += BytesFrom(texture, texture.wantedLevel);
+    }
+    return stats;
+}
+
+TextureResidency TextureStreaming::residency;
+std::unordered_map<uint32_t, TextureStreaming::Stream> TextureStreaming::streams;
+std::vector<TextureStreaming::LoadedLevels> TextureStreaming::finished;
+std::mutex TextureStreaming::mutex;
+uint64_t TextureStreaming::frame = 1; // Textures start out unused, at frame 0
+
+void TextureStreaming::SetBudget(size_t bytes)
+{
+    residency.budget = bytes;
+}
+
+size_t TextureStreaming::Budget()
+{
+    return residency.budget;
+}
+
+uint32_t TextureStreaming::Register(GLuint texture, const std::string& compressedPath, const CompressedImage& image)
+{
+    std::vector<size_t> levelBytes;
+    for (const CompressedLevel& level : image.levels)
+        levelBytes.push_back(level.size);
+    const CompressedLevel& base = image.levels[0];
+    uint32_t id = residency.Add(levelBytes, FirstLevelWithin(base.width, base.height, STREAMING_TAIL_SIZE), image.firstLevel);
+    streams[id] = Stream{ texture, compressedPath, base.width, base.height };
+    return id;
+}
+
+void TextureStreaming::Unregister(uint32_t stream)
+{
+    residency.Remove(stream);
+    streams.erase(stream);
+}
+
+void TextureStreaming::Request(const Model& model, const LodSelection& selection)
+{
+    if (!model.asset)
+        return;
+    const std::vector<unsigned char>& visible = model.MeshVisibility();
+    for (size_t i = 0; i < visible.size() && i < model.meshBounds.size(); i++)
+    {
+        if (!visible[i])
+            continue;
+        const Bounds& bounds = model.meshBounds[i];
+        float distance = std::max(glm::length(bounds.center - selection.viewPosition) - bounds.radius, 1e-3f);
+        float projectedPixels = 2.0f * bounds.radius * selection.pixelsPerUnit / distance;
+        for (const Texture& texture : model.asset->meshes[i].textures)
+        {
+            auto it = streams.find(texture.streamId);
+            if (it != streams.end())
+                residency.Request(it->first, StreamingWantedLevel(it->second.width, it->second.height, projectedPixels), frame);
+        }
+    }
+}
+
+void TextureStreaming::Update()
+{
+    std::vector<LoadedLevels> loaded;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        loaded.swap(finished);
+    }
+    for (LoadedLevels& load : loaded)
+    {
+        auto it = streams.find(load.stream);
+        if (it == streams.end())
+            continue; // Released while loading
+        if (load.success)
+        {
+            const unsigned char* source = PixelBufferRing::BeginUpload(load.image.data.data(), load.image.data.size(), &load.staged);
+            UploadCompressedLevels(it->second.texture, load.image, source);
+            PixelBufferRing::EndUpload();
+        }
+        else
+            std::cout << "ERROR::TEXTURE_STREAMING::LEVEL_READ_FAILED: " << it->second.path << std::endl;
+        residency.Loaded(load.stream, load.success);
+    }
+
+    std::vector<TextureResidency::Change> evictions, loads;
+    residency.Update(frame, STREAMING_MAX_LOADS, evictions, loads);
+
+    // Evicted levels are respecified empty, which frees them; the base level keeps the texture complete
+    for (const TextureResidency::Change& eviction : evictions)
+    {
+        const Stream& stream = streams[eviction.texture];
+        glBindTexture(GL_TEXTURE_2D, stream.texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(eviction.level));
+        for (uint32_t level = 0; level < eviction.level; level++)
+            glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), GL_RGBA8, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+    for (const TextureResidency::Change& load : loads)
+    {
+        uint32_t id = load.texture, level = load.level;
+        std::string path = streams[id].path;
+        ThreadPool::Shared().Submit([id, level, path]()
+        {
+            PROFILE_SCOPE("Stream texture level");
+            LoadedLevels result;
+            result.stream = id;
+            result.success = ReadCompressedTexture(path, result.image, level, level) && result.image.firstLevel == level;
+            if (result.success)
+                result.staged = PixelBufferRing::Stage(result.image.data.data(), result.image.data.size());
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.push_back(std::move(result));
+        });
+    }
+    frame++;
+}
+
+TextureStreamingStats TextureStreaming::GetStats()
+{
+    // Requests made this frame are tagged with the frame Update has not closed yet
+    TextureResidency::Stats residencyStats = residency.GetStats(frame - 1);
+    TextureStreamingStats stats = {};
+    stats.textures = residencyStats.textures;
+    stats.residentBytes = residencyStats.residentBytes;
+    stats.wantedBytes = residencyStats.wantedBytes;
+    stats.budget = residency.budget;
+    stats.loadsInFlight = residencyStats.loadsInFlight;
+    stats.loads = residencyStats.loads;
+    stats.evictions = residencyStats.evictions;
+    return stats;
+}
+
+void TextureStreaming::Shutdown()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    finished.clear();
+}
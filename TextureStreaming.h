@@ -0,0 +1,163 @@
+// TextureStreaming.h
+#ifndef TEXTURE_STREAMING_H
+#define TEXTURE_STREAMING_H
+
+#include <glad/glad.h> // Holds all OpenGL type declarations
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "TextureCompression.h"
+#include "PixelBufferRing.h"
+
+class Model;
+struct LodSelection;
+
+// Streamed textures always keep the levels no larger than this resident; imports upload only those
+const int STREAMING_TAIL_SIZE = 64;
+// Default GPU memory budget for streamed textures, tails included
+const size_t DEFAULT_STREAMING_BUDGET = size_t(256) << 20;
+// Most level loads in flight at once
+const size_t STREAMING_MAX_LOADS = 4;
+
+// Finest mip level worth having for a texture whose surface covers projectedPixels on screen,
+// taking the texture to span the surface once
+uint32_t StreamingWantedLevel(int width, int height, float projectedPixels);
+
+// Decides which mip levels of streamed textures are resident. It only does the bookkeeping, no GL
+// or file I/O, so the same decisions drive TextureStreaming and the headless --sim-streaming tool.
+// Each texture holds a contiguous run of levels from its finest resident one down to 1x1, never
+// less than its tail. Every frame, textures in use whose wanted level is finer than what they hold
+// load one level at a time, blurriest first. When a load would pass the budget, levels are
+// evicted one at a time from textures unused this frame, least recently used first, then from
+// textures in use that hold more detail than they want.
+class TextureResidency
+{
+public:
+    // A texture's new finest resident level (evictions) or the level to load (loads)
+    struct Change {
+        uint32_t texture;
+        uint32_t level;
+    };
+
+    struct StreamedTexture {
+        std::vector<size_t> levelBytes; // GPU size of each level of the full chain
+        uint32_t tailLevel;             // Never evicted past
+        uint32_t residentLevel;         // Finest level on the GPU
+        uint32_t loadingLevel;          // Level being loaded, residentLevel when idle
+        uint32_t wantedLevel;           // Finest level wanted when last used
+        uint64_t lastUsedFrame;
+        bool streamable;                // Cleared when a load fails
+    };
+
+    struct Stats {
+        size_t textures;
+        size_t residentBytes;  // Levels on the GPU
+        size_t committedBytes; // Plus the levels being loaded
+        size_t wantedBytes;    // What the textures used last frame would hold at their wanted levels
+        size_t loadsInFlight;
+        size_t loads;          // Since creation
+        size_t evictions;      // Levels evicted since creation
+    };
+
+    size_t budget = DEFAULT_STREAMING_BUDGET;
+
+    // Adds a texture holding levels residentLevel and coarser; returns its id
+    uint32_t Add(const std::vector<size_t>& levelBytes, uint32_t tailLevel, uint32_t residentLevel);
+
+    // Forgets a texture, including a load in flight for it
+    void Remove(uint32_t texture);
+
+    // Marks the texture as used this frame; the finest level asked for during the frame wins
+    void Request(uint32_t texture, uint32_t level, uint64_t frame);
+
+    // Decides this frame's evictions and which loads to start (keeping at most maxLoadsInFlight);
+    // the loads count as resident for the budget from now on
+    void Update(uint64_t frame, size_t maxLoadsInFlight, std::vector<Change>& evictions, std::vector<Change>& loads);
+
+    // Reports the end of the texture's load. A failed load leaves it as it was and stops streaming it.
+    void Loaded(uint32_t texture, bool success);
+
+    // Returns the texture's state, or null for unknown ids
+    const StreamedTexture* Find(uint32_t texture) const;
+
+    Stats GetStats(uint64_t frame) const;
+
+private:
+    std::unordered_map<uint32_t, StreamedTexture> textures;
+    uint32_t nextId = 0;
+    size_t committedBytes = 0;
+    size_t loadsInFlight = 0;
+    size_t loadCount = 0;
+    size_t evictionCount = 0;
+
+    static size_t BytesFrom(const StreamedTexture& texture, uint32_t level);
+};
+
+// Counters shown in the Scene window
+struct TextureStreamingStats {
+    size_t textures;
+    size_t residentBytes;
+    size_t wantedBytes;
+    size_t budget;
+    size_t loadsInFlight;
+    size_t loads;
+    size_t evictions;
+};
+
+// Streams the mip levels of compressed textures under a GPU memory budget. Imports upload only the
+// tail of each chain; the render loop reports which textures the visible meshes use and how large
+// they appear, and Update moves levels in and out following TextureResidency. Levels are read from
+// the .ktx files and staged in the PixelBufferRing on the shared thread pool, then uploaded on the
+// render thread. Everything else runs on the render thread.
+class TextureStreaming
+{
+public:
+    static void SetBudget(size_t bytes);
+    static size_t Budget();
+
+    // Starts streaming a texture created by UploadCompressedTexture from the loaded levels of the
+    // image, reading the others from compressedPath. Returns the stream id.
+    static uint32_t Register(GLuint texture, const std::string& compressedPath, const CompressedImage& image);
+
+    // Stops streaming a texture (before it is deleted)
+    static void Unregister(uint32_t stream);
+
+    // Asks for the levels the textures of the model's visible meshes need, from each mesh's
+    // projected size; call after Cull
+    static void Request(const Model& model, const LodSelection& selection);
+
+    // Once per frame: uploads finished loads, then evicts and starts loads for the requests made
+    // since the last call
+    static void Update();
+
+    static TextureStreamingStats GetStats();
+
+    // Drops loads that finished after the last Update; call once the thread pool is idle
+    static void Shutdown();
+
+private:
+    struct Stream {
+        GLuint texture;
+        std::string path;
+        int width;
+        int height;
+    };
+    // Levels read by a worker, waiting for their upload
+    struct LoadedLevels {
+        uint32_t stream;
+        bool success;
+        CompressedImage image;
+        StagedPixels staged;
+    };
+
+    static TextureResidency residency;
+    static std::unordered_map<uint32_t, Stream> streams;
+    static std::vector<LoadedLevels> finished;
+    static std::mutex mutex; // Guards finished
+    static uint64_t frame;
+};
+
+#endif // TEXTURE_STREAMING_H
@@ -0,0 +1,138 @@
+// ThreadPool.cpp
+#include "ThreadPool.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <memory>
+
+// Shared between the caller of ParallelFor and the helper jobs it submits
+struct ParallelForState {
+    std::atomic<size_t> nextChunk;
+    std::atomic<size_t> chunksDone;
+    size_t chunkCount;
+    size_t count;
+    size_t grain;
+    const std::function<void(size_t, size_t)>* fn;
+    std::mutex mutex;
+    std::condition_variable finished;
+
+    // Claims and runs chunks until none are left
+    void Run()
+    {
+        for (;;)
+        {
+            size_t chunk = nextChunk.fetch_add(1);
+            if (chunk >= chunkCount)
+                return;
+            size_t begin = chunk * grain;
+            (*fn)(begin, std::min(begin + grain, count));
+            if (chunksDone.fetch_add(1) + 1 == chunkCount)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                finished.notify_all();
+            }
+        }
+    }
+};
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+    : activeJobs(0), stopping(false)
+{
+    if (threadCount == 0)
+    {
+        unsigned int hardwareThreads = std::thread::hardware_concurrency();
+        threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+
+    for (unsigned int i = 0; i < threadCount; i++)
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    jobAvailable.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+void ThreadPool::Submit(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    jobAvailable.notify_one();
+}
+
+void ThreadPool::Wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return jobs.empty() && activeJobs == 0; });
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn)
+{
+    if (count == 0)
+        return;
+    grain = std::max<size_t>(grain, 1);
+
+    std::shared_ptr<ParallelForState> state = std::make_shared<ParallelForState>();
+    state->nextChunk = 0;
+    state->chunksDone = 0;
+    state->chunkCount = (count + grain - 1) / grain;
+    state->count = count;
+    state->grain = grain;
+    state->fn = &fn;
+
+    // Helpers that only get to run after every chunk is claimed return without touching fn
+    size_t helpers = std::min<size_t>(workers.size(), state->chunkCount - 1);
+    for (size_t i = 0; i < helpers; i++)
+        Submit([state]() { state->Run(); });
+
+    state->Run();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&state] { return state->chunksDone.load() == state->chunkCount; });
+}
+
+unsigned int ThreadPool::Size() const
+{
+    return static_cast<unsigned int>(workers.size());
+}
+
+ThreadPool& ThreadPool::Shared()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::workerLoop()
+{
+    Profiler::SetThreadName("Worker");
+    for (;;)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            jobAvailable.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty())
+                return; // Stopping and nothing left to do
+
+            job = std::move(jobs.front());
+            jobs.pop_front();
+            activeJobs++;
+        }
+
+        job();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            activeJobs--;
+            if (jobs.empty() && activeJobs == 0)
+                idle.notify_all();
+        }
+    }
+}
@@ -0,0 +1,56 @@
+// ThreadPool.h
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads consuming jobs from a shared FIFO queue.
+class ThreadPool
+{
+public:
+    // Starts the given number of workers (0 = one per hardware thread, minus the main thread)
+    explicit ThreadPool(unsigned int threadCount = 0);
+
+    // Finishes queued jobs and joins the workers
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queues a job to run on one of the workers
+    void Submit(std::function<void()> job);
+
+    // Blocks until the queue is empty and every worker is idle
+    void Wait();
+
+    // Calls fn(begin, end) over [0, count) in chunks of at most 'grain' items and returns when all are done.
+    // The calling thread works through the chunks too, so this never stalls behind long jobs queued
+    // on the pool (idle workers just help out).
+    void ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn);
+
+    // Number of worker threads
+    unsigned int Size() const;
+
+    // Pool shared by the engine's background work (asset loading etc.)
+    static ThreadPool& Shared();
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable jobAvailable;
+    std::condition_variable idle;
+    unsigned int activeJobs;
+    bool stopping;
+
+    // Worker thread main loop
+    void workerLoop();
+};
+
+#endif // THREAD_POOL_H
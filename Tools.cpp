@@ -0,0 +1,2348 @@
+// Tools.cpp
+#include "Tools.h"
+#include "BakedModel.h"
+#include "Model.h"
+#include "ModelLoader.h"
+#include "UniformBuffer.h"
+#include "LightClusters.h"
+#include "ThreadPool.h"
+#include "BVH.h"
+#include "RenderQueue.h"
+#include "MeshArena.h"
+#include "GLExtensions.h"
+#include "VertexPacking.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "TextureCompression.h"
+#include "TextureStreaming.h"
+#include "TransformCache.h"
+#include "SceneGraph.h"
+#include "Scene.h"
+#include "Profiler.h"
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <random>
+#include <glm/gtc/matrix_transform.hpp>
+#include <stb_image.h>
+#include "nlohmann/json.hpp"
+using json = nlohmann::json;
+
+typedef std::chrono::steady_clock Clock;
+
+static double ElapsedMs(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static bool IsModelFile(const std::string& path)
+{
+    for (const auto& ext : supportedExtensions)
+    {
+        if (path.size() >= ext.size() &&
+            path.compare(path.size() - ext.size(), ext.size(), ext) == 0)
+            return true;
+    }
+    return false;
+}
+
+std::vector<std::string> CollectModelFiles(const std::vector<std::string>& args)
+{
+    std::vector<std::string> inputs = args;
+    if (inputs.empty())
+        inputs.push_back("resources/projectModels");
+
+    std::vector<std::string> files;
+    for (const std::string& input : inputs)
+    {
+        std::error_code error;
+        if (std::filesystem::is_directory(input, error))
+        {
+            std::vector<std::string> found;
+            for (const auto& entry : std::filesystem::directory_iterator(input, error))
+            {
+                std::string path = entry.path().generic_string();
+                if (entry.is_regular_file() && IsModelFile(path))
+                    found.push_back(path);
+            }
+            std::sort(found.begin(), found.end());
+            files.insert(files.end(), found.begin(), found.end());
+        }
+        else if (IsModelFile(input))
+        {
+            files.push_back(ResolveModelPath(input));
+        }
+        else
+        {
+            std::cout << "Skipping unsupported file: " << input << std::endl;
+        }
+    }
+    return files;
+}
+
+int RunBakeTool(const std::vector<std::string>& args)
+{
+    std::vector<std::string> files = CollectModelFiles(args);
+    int failures = 0;
+
+    for (const std::string& path : files)
+    {
+        Clock::time_point start = Clock::now();
+        std::unique_ptr<ModelData> model = ImportModel(path);
+        if (model->meshes.empty() || !WriteBakedModel(*model, BakedModelPath(path)))
+        {
+            std::cout << "FAILED " << path << std::endl;
+            failures++;
+            continue;
+        }
+        std::cout << "Baked " << path << " -> " << BakedModelPath(path) << " (" << model->meshes.size()
+            << " meshes, " << ElapsedMs(start) << " ms)" << std::endl;
+    }
+
+    std::cout << files.size() - failures << " of " << files.size() << " models baked" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
+
+int RunLoadBenchmark(const std::vector<std::string>& args)
+{
+    const int runs = 3;
+    std::vector<std::string> files = CollectModelFiles(args);
+    double totalImport = 0.0;
+    double totalBaked = 0.0;
+
+    std::printf("%-45s %12s %12s %8s\n", "model", "assimp ms", "baked ms", "speedup");
+    for (const std::string& path : files)
+    {
+        std::string bakedPath = BakedModelPath(path);
+        if (!IsBakedModelCurrent(path, bakedPath))
+        {
+            std::unique_ptr<ModelData> model = ImportModel(path);
+            WriteBakedModel(*model, bakedPath);
+        }
+
+        // Best of several runs for each path, so file system caching affects both equally
+        double importMs = 1e30;
+        double bakedMs = 1e30;
+        for (int run = 0; run < runs; run++)
+        {
+            Clock::time_point start = Clock::now();
+            std::unique_ptr<ModelData> imported = ImportModel(path);
+            importMs = std::min(importMs, ElapsedMs(start));
+
+            start = Clock::now();
+            std::unique_ptr<ModelData> baked = ReadBakedModel(bakedPath, path);
+            bakedMs = std::min(bakedMs, ElapsedMs(start));
+            if (!baked)
+            {
+                std::cout << "Failed to read baked file " << bakedPath << std::endl;
+                return 1;
+            }
+        }
+
+        totalImport += importMs;
+        totalBaked += bakedMs;
+        std::printf("%-45s %12.2f %12.2f %7.1fx\n", path.c_str(), importMs, bakedMs, importMs / std::max(bakedMs, 1e-6));
+    }
+    std::printf("%-45s %12.2f %12.2f %7.1fx\n", "total", totalImport, totalBaked, totalImport / std::max(totalBaked, 1e-6));
+    return 0;
+}
+
+// Creates an invisible window whose 3.3 core context is made current, for tools that need GL
+static GLFWwindow* CreateHiddenContext()
+{
+    if (!glfwInit())
+    {
+        std::cout << "Failed to initialize GLFW\n";
+        return nullptr;
+    }
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    GLFWwindow* window = glfwCreateWindow(64, 64, "Mini Engine", NULL, NULL);
+    if (window == NULL)
+    {
+        std::cout << "Failed to create GLFW window\n";
+        glfwTerminate();
+        return nullptr;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD\n";
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return nullptr;
+    }
+    LoadGLExtensions((GLADloadproc)glfwGetProcAddress);
+    return window;
+}
+
+int RunUniformBenchmark(const std::vector<std::string>& args)
+{
+    const int frames = 1000;
+    const int lightCount = 10;
+    const int meshCount = args.empty() ? 200 : std::max(1, std::atoi(args[0].c_str()));
+
+    GLFWwindow* window = CreateHiddenContext();
+    if (!window)
+        return 1;
+
+    double legacyMs = 0.0;
+    double handleMs = 0.0;
+    {
+        Shader shader("shaders/vertex_shader.glsl", "shaders/fragment_shader.glsl");
+        shader.use();
+        glm::mat4 matrix(1.0f);
+        glm::vec3 vector(0.5f);
+
+        // One frame's worth of updates: camera, every light, then material + model matrix per mesh.
+        // The legacy path rebuilds names and asks the driver for each location, as the render loop used to.
+        Clock::time_point start = Clock::now();
+        for (int frame = 0; frame < frames; frame++)
+        {
+            glUniformMatrix4fv(glGetUniformLocation(shader.ID, std::string("projection").c_str()), 1, GL_FALSE, &matrix[0][0]);
+            glUniformMatrix4fv(glGetUniformLocation(shader.ID, std::string("view").c_str()), 1, GL_FALSE, &matrix[0][0]);
+            glUniform3fv(glGetUniformLocation(shader.ID, std::string("viewPos").c_str()), 1, &vector[0]);
+            glUniform1i(glGetUniformLocation(shader.ID, std::string("numLights").c_str()), lightCount);
+            for (int i = 0; i < lightCount; i++)
+            {
+                std::string base = "lights[" + std::to_string(i) + "].";
+                glUniform3fv(glGetUniformLocation(shader.ID, (base + "position").c_str()), 1, &vector[0]);
+                glUniform3fv(glGetUniformLocation(shader.ID, (base + "rotation").c_str()), 1, &vector[0]);
+                glUniform3fv(glGetUniformLocation(shader.ID, (base + "scale").c_str()), 1, &vector[0]);
+                glUniform3fv(glGetUniformLocation(shader.ID, (base + "color").c_str()), 1, &vector[0]);
+                glUniform1f(glGetUniformLocation(shader.ID, (base + "intensity").c_str()), 1.0f);
+            }
+            for (int mesh = 0; mesh < meshCount; mesh++)
+            {
+                glUniformMatrix4fv(glGetUniformLocation(shader.ID, std::string("model").c_str()), 1, GL_FALSE, &matrix[0][0]);
+                glUniform1i(glGetUniformLocation(shader.ID, std::string("useTextures").c_str()), 0);
+                glUniform3fv(glGetUniformLocation(shader.ID, std::string("materialColor").c_str()), 1, &vector[0]);
+                glUniform3fv(glGetUniformLocation(shader.ID, std::string("materialSpecular").c_str()), 1, &vector[0]);
+                glUniform1f(glGetUniformLocation(shader.ID, std::string("materialShininess").c_str()), 32.0f);
+            }
+        }
+        glFinish();
+        legacyMs = ElapsedMs(start) / frames;
+
+        Uniform<glm::mat4> model = shader.getUniform<glm::mat4>("model");
+        MaterialUniforms material(shader);
+        UniformBuffer frameBuffer(FRAME_BLOCK_BINDING, sizeof(FrameBlock));
+        ClusteredLightBuffers lightBuffers;
+        std::vector<Light> lights(lightCount);
+        for (Light& light : lights)
+        {
+            light.position = vector;
+            light.color = vector;
+            light.intensity = 1.0f;
+            light.radius = DEFAULT_LIGHT_RADIUS;
+        }
+        LightClusterGrid grid;
+        ClusterCamera camera = { matrix, glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f), 0.1f, 100.0f };
+        grid.Build(lights, camera, nullptr);
+
+        start = Clock::now();
+        for (int frame = 0; frame < frames; frame++)
+        {
+            FrameBlock frameBlock;
+            frameBlock.projection = matrix;
+            frameBlock.view = matrix;
+            frameBlock.viewPos = glm::vec4(vector, 1.0f);
+            frameBuffer.Update(&frameBlock, sizeof(frameBlock));
+
+            lightBuffers.Upload(lights, grid);
+
+            for (int mesh = 0; mesh < meshCount; mesh++)
+            {
+                shader.set(model, matrix);
+                shader.set(material.useTextures, false);
+                shader.set(material.materialColor, vector);
+                shader.set(material.materialSpecular, vector);
+                shader.set(material.materialShininess, 32.0f);
+            }
+        }
+        glFinish();
+        handleMs = ElapsedMs(start) / frames;
+
+        glDeleteProgram(shader.ID);
+    }
+
+    std::printf("%d lights, %d meshes, %d frames\n", lightCount, meshCount, frames);
+    std::printf("name lookup, %4d glUniform calls: %8.3f ms/frame\n", 4 + lightCount * 5 + meshCount * 5, legacyMs);
+    std::printf("handles + buffers, %4d calls:     %8.3f ms/frame (%.1fx)\n", 12 + meshCount * 5, handleMs, legacyMs / std::max(handleMs, 1e-9));
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return 0;
+}
+
+// Lights scattered through a box, with ranges typical of small local lights
+static std::vector<Light> RandomLights(size_t count, const glm::vec3& boxMin, const glm::vec3& boxMax, unsigned int seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<Light> lights(count);
+    for (Light& light : lights)
+    {
+        light.position = boxMin + (boxMax - boxMin) * glm::vec3(unit(rng), unit(rng), unit(rng));
+        light.rotation = glm::vec3(0.0f);
+        light.scale = glm::vec3(1.0f);
+        light.color = glm::vec3(0.2f) + 0.8f * glm::vec3(unit(rng), unit(rng), unit(rng));
+        light.intensity = 0.5f + unit(rng);
+        light.radius = 2.0f + 4.0f * unit(rng);
+    }
+    return lights;
+}
+
+int RunClusterBenchmark(const std::vector<std::string>& args)
+{
+    const int runs = 20;
+    const size_t lightCount = args.empty() ? 4096 : static_cast<size_t>(std::max(1, std::atoi(args[0].c_str())));
+
+    // Camera at the origin looking down -Z into a field of lights
+    ClusterCamera camera;
+    camera.zNear = 0.1f;
+    camera.zFar = 100.0f;
+    camera.view = glm::lookAt(glm::vec3(0.0f, 2.0f, 0.0f), glm::vec3(0.0f, 2.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    camera.projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, camera.zNear, camera.zFar);
+    std::vector<Light> lights = RandomLights(lightCount, glm::vec3(-60.0f, 0.0f, -110.0f), glm::vec3(60.0f, 10.0f, 10.0f), 1234);
+    // One light as loaded from a scene saved before lights had a radius: listed once, in no cluster
+    lights[0].radius = UNBOUNDED_LIGHT_RADIUS;
+
+    LightClusterGrid serialGrid, parallelGrid;
+    double serialMs = 1e30, parallelMs = 1e30;
+    for (int run = 0; run < runs; run++)
+    {
+        Clock::time_point start = Clock::now();
+        serialGrid.Build(lights, camera, nullptr);
+        serialMs = std::min(serialMs, ElapsedMs(start));
+
+        start = Clock::now();
+        parallelGrid.Build(lights, camera, &ThreadPool::Shared());
+        parallelMs = std::min(parallelMs, ElapsedMs(start));
+    }
+
+    // Check both against testing every light against every cluster box
+    size_t mismatches = 0;
+    size_t totalEntries = 0;
+    std::vector<uint32_t> expected;
+    for (unsigned int cluster = 0; cluster < CLUSTER_COUNT; cluster++)
+    {
+        glm::vec3 boxMin, boxMax;
+        serialGrid.ClusterBounds(cluster, boxMin, boxMax);
+        expected.clear();
+        for (size_t i = 0; i < lights.size(); i++)
+        {
+            glm::vec3 center = glm::vec3(camera.view * glm::vec4(lights[i].position, 1.0f));
+            if (std::isfinite(lights[i].radius) && LightClusterGrid::SphereIntersectsBox(center, lights[i].radius, boxMin, boxMax))
+                expected.push_back(static_cast<uint32_t>(i));
+        }
+        totalEntries += expected.size();
+
+        for (const LightClusterGrid* grid : { &serialGrid, &parallelGrid })
+        {
+            glm::uvec2 list = grid->clusters[cluster];
+            if (list.y != expected.size() ||
+                !std::equal(expected.begin(), expected.end(), grid->lightIndices.begin() + list.x))
+                mismatches++;
+        }
+    }
+    // The unbounded light is listed once, outside the clusters
+    for (const LightClusterGrid* grid : { &serialGrid, &parallelGrid })
+    {
+        glm::uvec2 unbounded = grid->clusters[CLUSTER_COUNT];
+        if (unbounded.y != 1 || grid->lightIndices[unbounded.x] != 0)
+            mismatches++;
+    }
+
+    std::printf("%zu lights, %u clusters, %zu entries (%.2f lights per cluster on average, max %zu)\n",
+        lightCount, CLUSTER_COUNT, totalEntries, double(totalEntries) / CLUSTER_COUNT, serialGrid.maxLightsPerCluster);
+    std::printf("build, 1 thread:          %8.3f ms\n", serialMs);
+    std::printf("build, %2u threads + main: %8.3f ms\n", ThreadPool::Shared().Size(), parallelMs);
+    if (mismatches > 0)
+    {
+        std::printf("ERROR: %zu cluster lists differ from the brute force assignment\n", mismatches);
+        return 1;
+    }
+    std::printf("cluster lists match the brute force assignment\n");
+    return 0;
+}
+
+int RunLightSceneGenerator(const std::vector<std::string>& args)
+{
+    const size_t lightCount = args.size() > 0 ? static_cast<size_t>(std::max(1, std::atoi(args[0].c_str()))) : 2000;
+    const std::string outputName = args.size() > 1 ? args[1] : "lights" + std::to_string(lightCount) + ".json";
+    const std::string baseName = args.size() > 2 ? args[2] : "finalscene.json";
+
+    // Keep the base scene's models and scatter the lights over the area they cover
+    json scene;
+    std::ifstream baseFile("saves/" + baseName);
+    if (baseFile.is_open())
+    {
+        try
+        {
+            baseFile >> scene;
+        }
+        catch (json::parse_error& e)
+        {
+            std::cout << "ERROR::LIGHT_SCENE::PARSE_FAILED " << baseName << ": " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    else
+    {
+        std::cout << "Base scene saves/" << baseName << " not found, writing lights only" << std::endl;
+    }
+
+    glm::vec3 boxMin(-20.0f, 0.5f, -20.0f), boxMax(20.0f, 8.0f, 20.0f);
+    if (scene.contains("models") && !scene["models"].empty())
+    {
+        boxMin = glm::vec3(1e30f);
+        boxMax = glm::vec3(-1e30f);
+        for (const auto& modelJson : scene["models"])
+        {
+            glm::vec3 position(modelJson["position"][0], modelJson["position"][1], modelJson["position"][2]);
+            boxMin = glm::min(boxMin, position);
+            boxMax = glm::max(boxMax, position);
+        }
+        boxMin = glm::vec3(boxMin.x - 10.0f, 0.5f, boxMin.z - 10.0f);
+        boxMax = glm::vec3(boxMax.x + 10.0f, std::max(boxMax.y, 0.0f) + 8.0f, boxMax.z + 10.0f);
+    }
+
+    scene["lights"] = json::array();
+    for (const Light& light : RandomLights(lightCount, boxMin, boxMax, 42))
+    {
+        json lightJson;
+        lightJson["position"] = { light.position.x, light.position.y, light.position.z };
+        lightJson["rotation"] = { light.rotation.x, light.rotation.y, light.rotation.z };
+        lightJson["scale"] = { light.scale.x, light.scale.y, light.scale.z };
+        lightJson["color"] = { light.color.x, light.color.y, light.color.z };
+        lightJson["intensity"] = light.intensity;
+        lightJson["radius"] = light.radius;
+        scene["lights"].push_back(lightJson);
+    }
+
+    std::ofstream file("saves/" + outputName);
+    if (!file.is_open())
+    {
+        std::cout << "ERROR::LIGHT_SCENE::WRITE_FAILED saves/" << outputName << std::endl;
+        return 1;
+    }
+    file << scene.dump(4);
+    std::cout << "Wrote " << lightCount << " lights to saves/" << outputName << std::endl;
+    return 0;
+}
+
+// Random boxes of mixed sizes, like instances scattered over a large level
+static std::vector<Bounds> RandomBounds(size_t count, float worldSize, std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> position(-worldSize, worldSize);
+    std::uniform_real_distribution<float> size(0.2f, 4.0f);
+    std::vector<Bounds> result(count);
+    for (Bounds& bounds : result)
+    {
+        glm::vec3 corners[2];
+        corners[0] = glm::vec3(position(rng), position(rng) * 0.05f, position(rng));
+        corners[1] = corners[0] + glm::vec3(size(rng), size(rng), size(rng));
+        bounds = ComputeBounds(corners, 2, sizeof(glm::vec3));
+    }
+    return result;
+}
+
+int RunBVHBenchmark(const std::vector<std::string>& args)
+{
+    const size_t itemCount = args.empty() ? 100000 : static_cast<size_t>(std::max(1, std::atoi(args[0].c_str())));
+    const int queries = 1000;
+    const float worldSize = 500.0f;
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::vector<Bounds> items = RandomBounds(itemCount, worldSize, rng);
+    size_t mismatches = 0;
+
+    BVH bvh;
+    Clock::time_point start = Clock::now();
+    bvh.Build(items);
+    double buildMs = ElapsedMs(start);
+
+    // Move a slice of the items the way editing a transform does, one at a time, then all at once
+    const size_t moved = std::min<size_t>(itemCount, 1000);
+    start = Clock::now();
+    for (size_t i = 0; i < moved; i++)
+    {
+        size_t item = (i * 7919) % itemCount;
+        glm::vec3 offset(unit(rng) * 5.0f, 0.0f, unit(rng) * 5.0f);
+        items[item].min += offset;
+        items[item].max += offset;
+        items[item].center += offset;
+        bvh.UpdateItem(static_cast<uint32_t>(item), items[item]);
+    }
+    double updateUs = ElapsedMs(start) * 1000.0 / moved;
+    start = Clock::now();
+    bvh.Refit(items);
+    double refitMs = ElapsedMs(start);
+
+    // Frustum queries from random cameras
+    double bvhFrustumMs = 0.0, bruteFrustumMs = 0.0;
+    size_t visibleTotal = 0;
+    std::vector<uint32_t> found, expected;
+    for (int q = 0; q < queries / 10; q++)
+    {
+        glm::vec3 eye(unit(rng) * worldSize, 20.0f, unit(rng) * worldSize);
+        glm::vec3 target = eye + glm::vec3(unit(rng), -0.3f, unit(rng));
+        Frustum frustum(glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 300.0f) *
+                        glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f)));
+
+        found.clear();
+        start = Clock::now();
+        bvh.QueryFrustum(frustum, found);
+        bvhFrustumMs += ElapsedMs(start);
+
+        expected.clear();
+        start = Clock::now();
+        for (size_t i = 0; i < itemCount; i++)
+        {
+            if (frustum.Intersects(items[i]))
+                expected.push_back(static_cast<uint32_t>(i));
+        }
+        bruteFrustumMs += ElapsedMs(start);
+
+        std::sort(found.begin(), found.end());
+        if (found != expected)
+            mismatches++;
+        visibleTotal += found.size();
+    }
+
+    // Ray queries against the boxes
+    double bvhRayMs = 0.0, bruteRayMs = 0.0;
+    size_t rayHits = 0;
+    for (int q = 0; q < queries; q++)
+    {
+        glm::vec3 origin(unit(rng) * worldSize, 30.0f, unit(rng) * worldSize);
+        glm::vec3 direction = glm::normalize(glm::vec3(unit(rng), -0.2f - std::fabs(unit(rng)), unit(rng)));
+
+        float bvhDistance;
+        start = Clock::now();
+        uint32_t hit = bvh.Raycast(origin, direction, 1e30f, bvhDistance);
+        bvhRayMs += ElapsedMs(start);
+
+        start = Clock::now();
+        uint32_t bruteHit = BVH::NO_ITEM;
+        float bruteDistance = 1e30f;
+        glm::vec3 inverseDirection = 1.0f / direction;
+        for (size_t i = 0; i < itemCount; i++)
+        {
+            float enter;
+            if (RayIntersectsBox(origin, inverseDirection, items[i].min, items[i].max, bruteDistance, enter) && enter < bruteDistance)
+            {
+                bruteDistance = enter;
+                bruteHit = static_cast<uint32_t>(i);
+            }
+        }
+        bruteRayMs += ElapsedMs(start);
+
+        // Ties between overlapping boxes may pick either item, so compare distances
+        if ((hit == BVH::NO_ITEM) != (bruteHit == BVH::NO_ITEM) ||
+            (hit != BVH::NO_ITEM && std::fabs(bvhDistance - bruteDistance) > 1e-4f * std::max(1.0f, bruteDistance)))
+            mismatches++;
+        rayHits += hit != BVH::NO_ITEM;
+    }
+
+    // Nearest queries over point items, as used for lights
+    std::vector<Bounds> points(itemCount);
+    for (size_t i = 0; i < itemCount; i++)
+    {
+        glm::vec3 point(unit(rng) * worldSize, unit(rng) * 10.0f, unit(rng) * worldSize);
+        points[i] = ComputeBounds(&point, 1, sizeof(glm::vec3));
+    }
+    BVH pointBvh;
+    pointBvh.Build(points);
+    double bvhNearestMs = 0.0, bruteNearestMs = 0.0;
+    for (int q = 0; q < queries; q++)
+    {
+        glm::vec3 query(unit(rng) * worldSize, 5.0f, unit(rng) * worldSize);
+        float distance;
+        start = Clock::now();
+        pointBvh.Nearest(query, 1e30f, distance);
+        bvhNearestMs += ElapsedMs(start);
+
+        start = Clock::now();
+        float bruteDistance = 1e30f;
+        for (const Bounds& point : points)
+            bruteDistance = std::min(bruteDistance, glm::length(point.center - query));
+        bruteNearestMs += ElapsedMs(start);
+
+        if (std::fabs(distance - bruteDistance) > 1e-3f)
+            mismatches++;
+    }
+
+    std::printf("%zu items, %zu nodes\n", itemCount, bvh.NodeCount());
+    std::printf("build:                  %9.3f ms\n", buildMs);
+    std::printf("update one item:        %9.3f us\n", updateUs);
+    std::printf("refit all:              %9.3f ms\n", refitMs);
+    std::printf("frustum query:          %9.4f ms  (brute force %9.4f ms, %zu visible on average)\n",
+        bvhFrustumMs / (queries / 10), bruteFrustumMs / (queries / 10), visibleTotal / (queries / 10));
+    std::printf("ray query:              %9.4f ms  (brute force %9.4f ms, %zu of %d hit)\n",
+        bvhRayMs / queries, bruteRayMs / queries, rayHits, queries);
+    std::printf("nearest point query:    %9.4f ms  (brute force %9.4f ms)\n", bvhNearestMs / queries, bruteNearestMs / queries);
+    if (mismatches > 0)
+    {
+        std::printf("ERROR: %zu queries differ from brute force\n", mismatches);
+        return 1;
+    }
+    std::printf("all queries match brute force\n");
+    return 0;
+}
+
+// State switches needed to issue packets in their current order: program, material, textures and VAO fields of the key
+static size_t CountKeyStateChanges(const std::vector<DrawPacket>& packets)
+{
+    const uint64_t stateMask = ~((uint64_t(1) << RenderQueue::DEPTH_BITS) - 1);
+    const int fieldShifts[4] = {
+        RenderQueue::DEPTH_BITS,
+        RenderQueue::DEPTH_BITS + RenderQueue::VERTEX_ARRAY_BITS,
+        RenderQueue::DEPTH_BITS + RenderQueue::VERTEX_ARRAY_BITS + RenderQueue::TEXTURE_BITS,
+        RenderQueue::DEPTH_BITS + RenderQueue::VERTEX_ARRAY_BITS + RenderQueue::TEXTURE_BITS + RenderQueue::MATERIAL_BITS };
+    const int fieldBits[4] = { RenderQueue::VERTEX_ARRAY_BITS, RenderQueue::TEXTURE_BITS, RenderQueue::MATERIAL_BITS, RenderQueue::PROGRAM_BITS };
+
+    size_t changes = 0;
+    for (size_t i = 0; i < packets.size(); i++)
+    {
+        uint64_t key = packets[i].key & stateMask;
+        uint64_t previous = i > 0 ? packets[i - 1].key & stateMask : ~key;
+        for (int field = 0; field < 4; field++)
+        {
+            uint64_t mask = ((uint64_t(1) << fieldBits[field]) - 1) << fieldShifts[field];
+            if ((key & mask) != (previous & mask))
+                changes++;
+        }
+    }
+    return changes;
+}
+
+int RunQueueBenchmark(const std::vector<std::string>& args)
+{
+    const size_t packetCount = args.empty() ? 100000 : static_cast<size_t>(std::max(1, std::atoi(args[0].c_str())));
+    const int runs = 10;
+
+    // A scene-like mix: few programs, a few thousand meshes sharing a few hundred materials and texture sets
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<uint32_t> program(1, 4);
+    std::uniform_int_distribution<uint32_t> meshIndex(0, 3999);
+    std::uniform_real_distribution<float> depth(0.0f, 1.0f);
+    struct Source {
+        GLuint program;
+        uint32_t material;
+        uint32_t textures;
+        GLuint vertexArray;
+        float depth;
+    };
+    std::vector<Source> sources(packetCount);
+    for (Source& source : sources)
+    {
+        uint32_t mesh = meshIndex(rng);
+        source.program = program(rng);
+        source.material = mesh % 300;
+        source.textures = mesh % 500;
+        source.vertexArray = mesh + 1;
+        source.depth = depth(rng);
+    }
+
+    RenderQueue queue;
+    double buildMs = 1e30, sortMs = 1e30, stdSortMs = 1e30;
+    std::vector<DrawPacket> unsorted, reference;
+    for (int run = 0; run < runs; run++)
+    {
+        queue.Clear();
+        Clock::time_point start = Clock::now();
+        for (const Source& source : sources)
+        {
+            DrawPacket packet = {};
+            packet.key = RenderQueue::MakeKey(source.program, source.material, source.textures, source.vertexArray, source.depth);
+            packet.instanceCount = 1;
+            queue.Push(packet);
+        }
+        buildMs = std::min(buildMs, ElapsedMs(start));
+        unsorted = queue.Packets();
+
+        start = Clock::now();
+        queue.Sort();
+        sortMs = std::min(sortMs, ElapsedMs(start));
+
+        reference = unsorted;
+        start = Clock::now();
+        std::stable_sort(reference.begin(), reference.end(), [](const DrawPacket& a, const DrawPacket& b) { return a.key < b.key; });
+        stdSortMs = std::min(stdSortMs, ElapsedMs(start));
+    }
+
+    bool sorted = queue.Packets().size() == reference.size();
+    for (size_t i = 0; sorted && i < reference.size(); i++)
+        sorted = queue.Packets()[i].key == reference[i].key;
+
+    size_t unsortedChanges = CountKeyStateChanges(unsorted);
+    size_t sortedChanges = CountKeyStateChanges(queue.Packets());
+    std::printf("%zu packets\n", packetCount);
+    std::printf("build:            %8.3f ms\n", buildMs);
+    std::printf("radix sort:       %8.3f ms (std::stable_sort %8.3f ms)\n", sortMs, stdSortMs);
+    std::printf("state changes:    %zu unsorted, %zu sorted (%zu avoided)\n", unsortedChanges, sortedChanges, unsortedChanges - sortedChanges);
+    if (!sorted)
+    {
+        std::printf("ERROR: radix sort order differs from std::stable_sort\n");
+        return 1;
+    }
+    std::printf("radix sort order matches std::stable_sort\n");
+    return 0;
+}
+
+int RunArenaBenchmark(const std::vector<std::string>& args)
+{
+    const size_t operations = args.empty() ? 200000 : static_cast<size_t>(std::max(1, std::atoi(args[0].c_str())));
+    const size_t capacity = 1 << 24;
+
+    // Mesh-like sizes (mostly small, some large) churned like scenes being loaded and cleared
+    std::mt19937 rng(12);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    RangeAllocator allocator;
+    allocator.Reset(capacity, 0);
+    std::vector<unsigned char> owner(capacity, 0); // Brute-force occupancy
+    struct Block { size_t offset, count; };
+    std::vector<Block> live;
+    size_t failed = 0;
+    bool valid = true;
+
+    Clock::time_point start = Clock::now();
+    double allocatorMs = 0.0;
+    for (size_t op = 0; op < operations && valid; op++)
+    {
+        bool allocate = live.empty() || unit(rng) < (live.size() < 2000 ? 0.6f : 0.4f);
+        if (allocate)
+        {
+            size_t count = 1 + static_cast<size_t>(std::pow(unit(rng), 4.0f) * 20000.0f);
+            Clock::time_point opStart = Clock::now();
+            size_t offset = allocator.Allocate(count);
+            allocatorMs += ElapsedMs(opStart);
+            if (offset == RangeAllocator::NO_SPACE)
+            {
+                failed++;
+                continue;
+            }
+            for (size_t i = offset; i < offset + count && valid; i++)
+            {
+                if (offset + count > capacity || owner[i])
+                    valid = false;
+                owner[i] = 1;
+            }
+            live.push_back(Block{ offset, count });
+        }
+        else
+        {
+            size_t index = std::uniform_int_distribution<size_t>(0, live.size() - 1)(rng);
+            Block block = live[index];
+            live[index] = live.back();
+            live.pop_back();
+            Clock::time_point opStart = Clock::now();
+            allocator.Free(block.offset, block.count);
+            allocatorMs += ElapsedMs(opStart);
+            std::fill(owner.begin() + block.offset, owner.begin() + block.offset + block.count, 0);
+        }
+    }
+    double totalMs = ElapsedMs(start);
+
+    // The free list must describe exactly the unowned runs
+    size_t used = 0, freeRuns = 0, largestRun = 0, run = 0;
+    for (size_t i = 0; i <= capacity; i++)
+    {
+        if (i < capacity && !owner[i])
+        {
+            run++;
+            continue;
+        }
+        if (run > 0)
+        {
+            freeRuns++;
+            largestRun = std::max(largestRun, run);
+        }
+        run = 0;
+        if (i < capacity)
+            used++;
+    }
+    valid = valid && used == allocator.Used() && freeRuns == allocator.FreeBlocks() && largestRun == allocator.LargestFree();
+
+    ArenaStats stats = {};
+    stats.vertexCapacity = stats.indexCapacity = capacity;
+    stats.vertexUsed = stats.indexUsed = allocator.Used();
+    stats.vertexFreeBlocks = stats.indexFreeBlocks = allocator.FreeBlocks();
+    stats.vertexLargestFree = stats.indexLargestFree = allocator.LargestFree();
+    std::printf("%zu operations, %zu live blocks, %zu allocations failed\n", operations, live.size(), failed);
+    std::printf("allocator:        %8.3f ms (%.0f ns/op), %8.3f ms with checks\n", allocatorMs, allocatorMs * 1e6 / operations, totalMs);
+    std::printf("used:             %zu / %zu elements\n", allocator.Used(), capacity);
+    std::printf("free blocks:      %zu, largest %zu, fragmentation %.1f%%\n", allocator.FreeBlocks(), allocator.LargestFree(), stats.Fragmentation() * 100.0f);
+
+    // Compaction packs the live blocks at the front, leaving one hole
+    allocator.Reset(capacity, allocator.Used());
+    std::printf("after compaction: %zu free block, largest %zu\n", allocator.FreeBlocks(), allocator.LargestFree());
+
+    if (!valid)
+    {
+        std::printf("ERROR: allocator state differs from brute-force occupancy\n");
+        return 1;
+    }
+    std::printf("allocator matches brute-force occupancy\n");
+    return 0;
+}
+
+// Worst-case decode errors of a packed vertex set against the float originals
+struct PackingErrors {
+    double position = 0.0;   // Largest position error over the bounds' largest extent
+    double normalDeg = 0.0;
+    double tangentDeg = 0.0;
+    double texCoord = 0.0;
+    size_t handednessFlips = 0;
+
+    void Add(const Vertex& original, const Vertex& decoded, const Bounds& bounds)
+    {
+        glm::vec3 extent = bounds.max - bounds.min;
+        float size = std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-20f));
+        position = std::max(position, static_cast<double>(glm::length(decoded.Position - original.Position) / size));
+        if (glm::dot(original.Normal, original.Normal) > 0.0f) // Files without normals have zero ones
+            normalDeg = std::max(normalDeg, AngleDeg(glm::normalize(original.Normal), decoded.Normal));
+        texCoord = std::max(texCoord, static_cast<double>(glm::length(decoded.TexCoords - original.TexCoords)));
+    }
+
+    void AddTangent(const glm::vec4& original, const glm::vec4& decoded, const glm::vec3& decodedNormal)
+    {
+        // The tangent is stored orthogonalized against the decoded normal, so compare with that projection
+        glm::vec3 tangent = glm::vec3(original) - decodedNormal * glm::dot(decodedNormal, glm::vec3(original));
+        tangentDeg = std::max(tangentDeg, AngleDeg(glm::normalize(tangent), glm::vec3(decoded)));
+        if ((original.w < 0.0f) != (decoded.w < 0.0f))
+            handednessFlips++;
+    }
+
+    static double AngleDeg(const glm::vec3& a, const glm::vec3& b)
+    {
+        // atan2 stays accurate for tiny angles where acos of the dot product does not
+        return glm::degrees(std::atan2(static_cast<double>(glm::length(glm::cross(a, b))), static_cast<double>(glm::dot(a, b))));
+    }
+};
+
+int RunPackingBenchmark(const std::vector<std::string>& args)
+{
+    // Bounds the packed format has to stay within; position is relative to the mesh size
+    const double maxPositionError = 1.0 / 65535.0;
+    const double maxNormalDeg = 0.01;
+    const double maxTangentDeg = 0.02;
+    const double maxTexCoordError = PACKED_TEXCOORD_TOLERANCE;
+    const size_t vertexCount = 1000000;
+
+    // Random vertices: unit normals with tangents orthogonal to them, UVs in [0, 1]
+    std::mt19937 rng(13);
+    std::normal_distribution<float> gaussian(0.0f, 1.0f);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<Vertex> vertices(vertexCount);
+    std::vector<glm::vec4> tangents(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++)
+    {
+        Vertex& vertex = vertices[i];
+        vertex.Position = glm::vec3(gaussian(rng), gaussian(rng), gaussian(rng)) * 50.0f;
+        glm::vec3 normal;
+        do
+            normal = glm::vec3(gaussian(rng), gaussian(rng), gaussian(rng));
+        while (glm::dot(normal, normal) < 1e-6f);
+        vertex.Normal = glm::normalize(normal);
+        glm::vec3 tangent = glm::cross(vertex.Normal, glm::vec3(gaussian(rng), gaussian(rng), gaussian(rng)));
+        tangents[i] = glm::vec4(glm::normalize(tangent), unit(rng) < 0.5f ? -1.0f : 1.0f);
+        vertex.TexCoords = glm::vec2(unit(rng), unit(rng));
+    }
+    Bounds bounds = ComputeBounds(&vertices[0].Position, vertices.size(), sizeof(Vertex));
+
+    std::vector<PackedVertex> packed;
+    Clock::time_point start = Clock::now();
+    bool packable = PackVertices(vertices.data(), tangents.data(), vertices.size(), bounds, packed);
+    double encodeMs = ElapsedMs(start);
+    if (!packable)
+    {
+        std::printf("ERROR: vertices with UVs in [0, 1] were rejected\n");
+        return 1;
+    }
+
+    PackingErrors errors;
+    std::vector<Vertex> decoded(vertexCount);
+    std::vector<glm::vec4> decodedTangents(vertexCount);
+    start = Clock::now();
+    for (size_t i = 0; i < vertexCount; i++)
+        UnpackVertex(packed[i], bounds, decoded[i], decodedTangents[i]);
+    double decodeMs = ElapsedMs(start);
+    for (size_t i = 0; i < vertexCount; i++)
+    {
+        errors.Add(vertices[i], decoded[i], bounds);
+        errors.AddTangent(tangents[i], decodedTangents[i], decoded[i].Normal);
+    }
+
+    std::printf("%zu random vertices, %zu -> %zu bytes each (%.0f%%)\n", vertexCount, sizeof(Vertex), sizeof(PackedVertex),
+        100.0 * sizeof(PackedVertex) / sizeof(Vertex));
+    std::printf("encode %8.2f ms, decode %8.2f ms\n", encodeMs, decodeMs);
+    std::printf("max error: position %.3g of extent (bound %.3g), normal %.5f deg (bound %.3f), tangent %.5f deg (bound %.3f), uv %.3g (bound %.3g), %zu handedness flips\n",
+        errors.position, maxPositionError, errors.normalDeg, maxNormalDeg, errors.tangentDeg, maxTangentDeg, errors.texCoord, maxTexCoordError, errors.handednessFlips);
+    bool valid = errors.position <= maxPositionError && errors.normalDeg <= maxNormalDeg && errors.tangentDeg <= maxTangentDeg &&
+        errors.texCoord <= maxTexCoordError && errors.handednessFlips == 0;
+
+    // Tiled UVs beyond half precision have to keep the float layout
+    vertices[0].TexCoords = glm::vec2(100.3f, 0.0f);
+    if (PackVertices(vertices.data(), tangents.data(), 1, bounds, packed))
+    {
+        std::printf("ERROR: UV 100.3 was accepted by the packed format\n");
+        valid = false;
+    }
+
+    // Optionally, the meshes of real models
+    for (const std::string& path : CollectModelFiles(args))
+    {
+        SetVertexPacking(false);
+        std::unique_ptr<ModelData> model = ImportModel(path);
+        SetVertexPacking(true);
+        size_t floatBytes = 0, packedBytes = 0, packedMeshes = 0;
+        PackingErrors modelErrors;
+        for (const MeshData& mesh : model->meshes)
+        {
+            floatBytes += mesh.vertices.size() * sizeof(Vertex);
+            if (!PackVertices(mesh.vertices.data(), nullptr, mesh.vertices.size(), mesh.bounds, packed))
+            {
+                packedBytes += mesh.vertices.size() * sizeof(Vertex);
+                continue;
+            }
+            packedMeshes++;
+            packedBytes += packed.size() * sizeof(PackedVertex);
+            for (size_t i = 0; i < packed.size(); i++)
+            {
+                Vertex vertex;
+                glm::vec4 tangent;
+                UnpackVertex(packed[i], mesh.bounds, vertex, tangent);
+                modelErrors.Add(mesh.vertices[i], vertex, mesh.bounds);
+            }
+        }
+        std::printf("%s: %zu/%zu meshes packed, %zu -> %zu vertex bytes, max error position %.3g, normal %.5f deg, uv %.3g\n",
+            path.c_str(), packedMeshes, model->meshes.size(), floatBytes, packedBytes, modelErrors.position, modelErrors.normalDeg, modelErrors.texCoord);
+        valid = valid && modelErrors.position <= maxPositionError && modelErrors.normalDeg <= maxNormalDeg && modelErrors.texCoord <= maxTexCoordError;
+    }
+
+    if (!valid)
+    {
+        std::printf("ERROR: packed vertex errors exceed their bounds\n");
+        return 1;
+    }
+    std::printf("packed vertex errors within bounds\n");
+    return 0;
+}
+
+// A mesh's triangles as sorted vertex contents, each rotated to start at its smallest vertex so
+// reordering keeps the key but flipping the winding does not. Degenerate triangles are left out.
+static std::vector<std::string> TriangleSet(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
+{
+    std::vector<std::string> triangles;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        std::string corners[3];
+        for (int corner = 0; corner < 3; corner++)
+            corners[corner].assign(reinterpret_cast<const char*>(&vertices[indices[i + corner]]), sizeof(Vertex));
+        if (corners[0] == corners[1] || corners[1] == corners[2] || corners[2] == corners[0])
+            continue;
+        int first = static_cast<int>(std::min_element(corners, corners + 3) - corners);
+        triangles.push_back(corners[first] + corners[(first + 1) % 3] + corners[(first + 2) % 3]);
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+int RunMeshOptimizerBenchmark(const std::vector<std::string>& args)
+{
+    bool valid = true;
+
+    // A grid split into unindexed triangles in random order: the worst case the importer sees
+    const int gridSize = 200;
+    const float maxGridACMR = 0.8f;
+    std::vector<Vertex> grid;
+    std::vector<unsigned int> order;
+    for (int y = 0; y < gridSize; y++)
+    {
+        for (int x = 0; x < gridSize; x++)
+        {
+            order.push_back(static_cast<unsigned int>(order.size()));
+            glm::vec2 corners[6] = { {x, y}, {x + 1, y}, {x + 1, y + 1}, {x, y}, {x + 1, y + 1}, {x, y + 1} };
+            for (const glm::vec2& corner : corners)
+            {
+                Vertex vertex;
+                vertex.Position = glm::vec3(corner.x, 0.0f, corner.y);
+                vertex.Normal = glm::vec3(0.0f, 1.0f, 0.0f);
+                vertex.TexCoords = corner / static_cast<float>(gridSize);
+                grid.push_back(vertex);
+            }
+        }
+    }
+    std::shuffle(order.begin(), order.end(), std::mt19937(14));
+    std::vector<Vertex> gridVertices;
+    for (unsigned int quad : order)
+        gridVertices.insert(gridVertices.end(), grid.begin() + quad * 6, grid.begin() + quad * 6 + 6);
+    std::vector<unsigned int> gridIndices(gridVertices.size());
+    for (size_t i = 0; i < gridIndices.size(); i++)
+        gridIndices[i] = static_cast<unsigned int>(i);
+
+    std::vector<std::string> gridTriangles = TriangleSet(gridVertices, gridIndices);
+    VertexCacheStats gridBefore = AnalyzeVertexCache(gridIndices.data(), gridIndices.size(), gridVertices.size());
+    std::vector<glm::vec4> noTangents;
+    Clock::time_point start = Clock::now();
+    OptimizeMesh(gridVertices, noTangents, gridIndices);
+    double gridMs = ElapsedMs(start);
+    VertexCacheStats gridAfter = AnalyzeVertexCache(gridIndices.data(), gridIndices.size(), gridVertices.size());
+    std::printf("%dx%d grid: %zu -> %zu vertices, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, %.2f ms\n", gridSize, gridSize,
+        gridBefore.vertices, gridVertices.size(), gridBefore.ACMR(), gridAfter.ACMR(), gridBefore.ATVR(), gridAfter.ATVR(), gridMs);
+    if (TriangleSet(gridVertices, gridIndices) != gridTriangles)
+    {
+        std::printf("ERROR: grid triangles changed\n");
+        valid = false;
+    }
+    if (gridVertices.size() != (gridSize + 1) * (gridSize + 1) || gridAfter.ACMR() > maxGridACMR)
+    {
+        std::printf("ERROR: grid not welded to %d vertices or ACMR above %.2f\n", (gridSize + 1) * (gridSize + 1), maxGridACMR);
+        valid = false;
+    }
+
+    // The meshes of real models, as Assimp hands them over
+    bool packing = VertexPackingEnabled(), optimization = MeshOptimizationEnabled();
+    SetVertexPacking(false);
+    SetMeshOptimization(false);
+    for (const std::string& path : CollectModelFiles(args))
+    {
+        std::unique_ptr<ModelData> model = ImportModel(path);
+        std::printf("%s\n", path.c_str());
+        VertexCacheStats modelBefore, modelAfter;
+        size_t indexBytesBefore = 0, indexBytesAfter = 0;
+        double modelMs = 0.0;
+        for (size_t m = 0; m < model->meshes.size(); m++)
+        {
+            MeshData& mesh = model->meshes[m];
+            std::vector<std::string> triangles = TriangleSet(mesh.vertices, mesh.indices);
+            VertexCacheStats before = AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+            size_t verticesBefore = mesh.vertices.size();
+
+            std::vector<glm::vec4> tangents;
+            start = Clock::now();
+            OptimizeMesh(mesh.vertices, tangents, mesh.indices);
+            double ms = ElapsedMs(start);
+            VertexCacheStats after = AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+            bool same = TriangleSet(mesh.vertices, mesh.indices) == triangles;
+            valid = valid && same;
+
+            std::printf("  mesh %zu: %zu tris, %zu -> %zu vertices, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, %s indices, %.2f ms%s\n",
+                m, after.triangles, verticesBefore, mesh.vertices.size(), before.ACMR(), after.ACMR(), before.ATVR(), after.ATVR(),
+                mesh.vertices.size() <= MAX_SHORT_INDEX_VERTICES ? "16-bit" : "32-bit", ms, same ? "" : "  ERROR: triangles changed");
+
+            modelBefore.triangles += before.triangles;
+            modelBefore.vertices += before.vertices;
+            modelBefore.transformed += before.transformed;
+            modelAfter.triangles += after.triangles;
+            modelAfter.vertices += after.vertices;
+            modelAfter.transformed += after.transformed;
+            indexBytesBefore += before.triangles * 3 * sizeof(unsigned int);
+            indexBytesAfter += after.triangles * 3 * (mesh.vertices.size() <= MAX_SHORT_INDEX_VERTICES ? sizeof(GLushort) : sizeof(unsigned int));
+            modelMs += ms;
+        }
+        std::printf("  total: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, index bytes %zu -> %zu, %.2f ms\n", modelBefore.ACMR(), modelAfter.ACMR(),
+            modelBefore.ATVR(), modelAfter.ATVR(), indexBytesBefore, indexBytesAfter, modelMs);
+    }
+    SetVertexPacking(packing);
+    SetMeshOptimization(optimization);
+
+    if (!valid)
+    {
+        std::printf("ERROR: mesh optimization failed its checks\n");
+        return 1;
+    }
+    std::printf("mesh optimization keeps every triangle\n");
+    return 0;
+}
+
+// Uniform grid over a triangle list for nearest-surface queries within a fixed distance
+struct TriangleGrid {
+    const std::vector<Vertex>* vertices;
+    const unsigned int* indices;
+    glm::vec3 origin;
+    float cellSize;
+    glm::ivec3 dims;
+    std::vector<std::vector<unsigned int>> cells;
+
+    TriangleGrid(const std::vector<Vertex>& vertices, const unsigned int* indices, size_t indexCount, const Bounds& bounds)
+        : vertices(&vertices), indices(indices)
+    {
+        glm::vec3 size = glm::max(bounds.max - bounds.min, glm::vec3(1e-6f));
+        size_t triangleCount = std::max<size_t>(indexCount / 3, 1);
+        cellSize = std::max(std::cbrt(size.x * size.y * size.z / triangleCount) * 2.0f, std::max(size.x, std::max(size.y, size.z)) / 256.0f);
+        origin = bounds.min;
+        dims = glm::clamp(glm::ivec3(size / cellSize) + 1, glm::ivec3(1), glm::ivec3(256));
+        cells.resize(static_cast<size_t>(dims.x) * dims.y * dims.z);
+        for (size_t i = 0; i + 2 < indexCount; i += 3)
+        {
+            glm::vec3 p0 = vertices[indices[i]].Position, p1 = vertices[indices[i + 1]].Position, p2 = vertices[indices[i + 2]].Position;
+            glm::ivec3 lo = Cell(glm::min(p0, glm::min(p1, p2))), hi = Cell(glm::max(p0, glm::max(p1, p2)));
+            for (int z = lo.z; z <= hi.z; z++)
+                for (int y = lo.y; y <= hi.y; y++)
+                    for (int x = lo.x; x <= hi.x; x++)
+                        cells[(static_cast<size_t>(z) * dims.y + y) * dims.x + x].push_back(static_cast<unsigned int>(i));
+        }
+    }
+
+    glm::ivec3 Cell(const glm::vec3& point) const
+    {
+        return glm::clamp(glm::ivec3(glm::floor((point - origin) / cellSize)), glm::ivec3(0), dims - 1);
+    }
+
+    // Distance from point to the nearest triangle, or a value above maxDistance if none is that close
+    float Distance(const glm::vec3& point, float maxDistance) const
+    {
+        float best = std::numeric_limits<float>::max();
+        glm::ivec3 lo = Cell(point - maxDistance), hi = Cell(point + maxDistance);
+        for (int z = lo.z; z <= hi.z; z++)
+        {
+            for (int y = lo.y; y <= hi.y; y++)
+            {
+                for (int x = lo.x; x <= hi.x; x++)
+                {
+                    for (unsigned int i : cells[(static_cast<size_t>(z) * dims.y + y) * dims.x + x])
+                    {
+                        best = std::min(best, PointTriangleDistance(point, (*vertices)[indices[i]].Position,
+                            (*vertices)[indices[i + 1]].Position, (*vertices)[indices[i + 2]].Position));
+                    }
+                }
+            }
+        }
+        return best;
+    }
+
+    // Ericson, Real-Time Collision Detection 5.1.5
+    static float PointTriangleDistance(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+    {
+        glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+        float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+        if (d1 <= 0.0f && d2 <= 0.0f) return glm::length(p - a);
+        glm::vec3 bp = p - b;
+        float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+        if (d3 >= 0.0f && d4 <= d3) return glm::length(p - b);
+        float vc = d1 * d4 - d3 * d2;
+        if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return glm::length(p - (a + ab * (d1 / (d1 - d3))));
+        glm::vec3 cp = p - c;
+        float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+        if (d6 >= 0.0f && d5 <= d6) return glm::length(p - c);
+        float vb = d5 * d2 - d1 * d6;
+        if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return glm::length(p - (a + ac * (d2 / (d2 - d6))));
+        float va = d3 * d6 - d5 * d4;
+        if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) return glm::length(p - (b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)))));
+        float denominator = 1.0f / (va + vb + vc);
+        return glm::length(p - (a + ab * (vb * denominator) + ac * (vc * denominator)));
+    }
+};
+
+// Checks a mesh's LOD chain: every level within its triangle budget and below its predecessor, and
+// every full-detail vertex within the level's reported error of its surface. Prints one line per level.
+static bool CheckLodChain(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, const std::vector<MeshLod>& lods,
+                          const Bounds& bounds, const char* indent)
+{
+    // Collapse errors are plane distances, which can understate the distance to the surface a little
+    const float errorSlack = 1.5f;
+    const float minTolerance = 1e-4f * bounds.radius;
+    bool valid = true;
+    std::vector<unsigned char> used(vertices.size(), 0);
+    for (size_t i = 0; i < lods[0].indexCount; i++)
+        used[indices[i]] = 1;
+    for (size_t level = 0; level < lods.size(); level++)
+    {
+        const MeshLod& lod = lods[level];
+        size_t triangles = lod.indexCount / 3;
+        bool budget = true;
+        if (level > 0)
+        {
+            size_t previous = lods[level - 1].indexCount / 3;
+            budget = triangles <= previous * (1.0f - LOD_MIN_REDUCTION) && lod.error >= lods[level - 1].error
+                && lod.error <= LOD_MAX_ERROR * bounds.radius * 1.0001f;
+        }
+
+        float tolerance = std::max(lod.error * errorSlack, minTolerance);
+        float measured = 0.0f;
+        TriangleGrid grid(vertices, indices.data() + lod.firstIndex, lod.indexCount, bounds);
+        for (size_t v = 0; v < vertices.size(); v++)
+        {
+            if (used[v])
+                measured = std::max(measured, grid.Distance(vertices[v].Position, tolerance));
+        }
+        bool bounded = measured <= tolerance;
+        std::printf("%slod %zu: %zu tris, error %.4g (%.3g%% of radius), measured %s%.4g%s\n", indent, level, triangles, lod.error,
+            100.0f * lod.error / bounds.radius, bounded ? "" : "> ", bounded ? measured : tolerance,
+            budget ? (bounded ? "" : "  ERROR: error bound") : "  ERROR: triangle budget");
+        valid = valid && budget && bounded;
+    }
+    return valid;
+}
+
+int RunLodBenchmark(const std::vector<std::string>& args)
+{
+    bool valid = true;
+
+    // A closed sphere with no seams: every level should reach its triangle target
+    const int subdivisions = 5;
+    std::vector<Vertex> sphere;
+    std::vector<unsigned int> sphereIndices;
+    {
+        const float t = (1.0f + std::sqrt(5.0f)) / 2.0f;
+        glm::vec3 corners[12] = { {-1, t, 0}, {1, t, 0}, {-1, -t, 0}, {1, -t, 0}, {0, -1, t}, {0, 1, t},
+                                  {0, -1, -t}, {0, 1, -t}, {t, 0, -1}, {t, 0, 1}, {-t, 0, -1}, {-t, 0, 1} };
+        unsigned int faces[60] = { 0, 11, 5, 0, 5, 1, 0, 1, 7, 0, 7, 10, 0, 10, 11, 1, 5, 9, 5, 11, 4, 11, 10, 2, 10, 7, 6, 7, 1, 8,
+                                   3, 9, 4, 3, 4, 2, 3, 2, 6, 3, 6, 8, 3, 8, 9, 4, 9, 5, 2, 4, 11, 6, 2, 10, 8, 6, 7, 9, 8, 1 };
+        std::vector<glm::vec3> positions;
+        for (const glm::vec3& corner : corners)
+            positions.push_back(glm::normalize(corner));
+        sphereIndices.assign(faces, faces + 60);
+        for (int s = 0; s < subdivisions; s++)
+        {
+            std::map<std::pair<unsigned int, unsigned int>, unsigned int> midpoints;
+            auto midpoint = [&](unsigned int a, unsigned int b)
+            {
+                auto key = std::make_pair(std::min(a, b), std::max(a, b));
+                auto it = midpoints.find(key);
+                if (it != midpoints.end())
+                    return it->second;
+                positions.push_back(glm::normalize(positions[a] + positions[b]));
+                unsigned int index = static_cast<unsigned int>(positions.size() - 1);
+                midpoints.emplace(key, index);
+                return index;
+            };
+            std::vector<unsigned int> next;
+            for (size_t i = 0; i < sphereIndices.size(); i += 3)
+            {
+                unsigned int a = sphereIndices[i], b = sphereIndices[i + 1], c = sphereIndices[i + 2];
+                unsigned int ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+                unsigned int split[12] = { a, ab, ca, b, bc, ab, c, ca, bc, ab, bc, ca };
+                next.insert(next.end(), split, split + 12);
+            }
+            sphereIndices.swap(next);
+        }
+        for (const glm::vec3& position : positions)
+        {
+            Vertex vertex;
+            vertex.Position = position;
+            vertex.Normal = position;
+            vertex.TexCoords = glm::vec2(0.0f);
+            sphere.push_back(vertex);
+        }
+    }
+    Bounds sphereBounds = ComputeBounds(&sphere[0].Position, sphere.size(), sizeof(Vertex));
+    std::vector<MeshLod> sphereLods;
+    Clock::time_point start = Clock::now();
+    GenerateLods(sphere, sphereIndices, sphereBounds.radius, sphereLods);
+    std::printf("sphere: %zu levels, %.2f ms\n", sphereLods.size(), ElapsedMs(start));
+    valid = CheckLodChain(sphere, sphereIndices, sphereLods, sphereBounds, "  ") && valid;
+    bool reachedTargets = sphereLods.size() == MAX_MESH_LODS;
+    for (size_t level = 1; level < sphereLods.size(); level++)
+    {
+        size_t target = std::max(static_cast<size_t>(sphereLods[level - 1].indexCount / 3 * LOD_TRIANGLE_RATIO), LOD_MIN_TRIANGLES);
+        reachedTargets = reachedTargets && sphereLods[level].indexCount / 3 <= target;
+    }
+    if (!reachedTargets)
+    {
+        std::printf("ERROR: sphere levels did not reach %zu levels of %.0f%% each\n", MAX_MESH_LODS, 100.0f * LOD_TRIANGLE_RATIO);
+        valid = false;
+    }
+
+    // The meshes of real models, chains generated on import
+    for (const std::string& path : CollectModelFiles(args))
+    {
+        bool packing = VertexPackingEnabled();
+        SetVertexPacking(false);
+        start = Clock::now();
+        std::unique_ptr<ModelData> model = ImportModel(path);
+        double importMs = ElapsedMs(start);
+        SetVertexPacking(packing);
+        size_t fullTriangles = 0, lastTriangles = 0;
+        std::printf("%s: %.2f ms import\n", path.c_str(), importMs);
+        for (size_t m = 0; m < model->meshes.size(); m++)
+        {
+            const MeshData& mesh = model->meshes[m];
+            std::printf("  mesh %zu:\n", m);
+            valid = CheckLodChain(mesh.vertices, mesh.indices, mesh.lods, mesh.bounds, "    ") && valid;
+            fullTriangles += mesh.lods.front().indexCount / 3;
+            lastTriangles += mesh.lods.back().indexCount / 3;
+        }
+        std::printf("  total: %zu tris at full detail, %zu at the coarsest levels\n", fullTriangles, lastTriangles);
+    }
+
+    if (!valid)
+    {
+        std::printf("ERROR: LOD chains failed their checks\n");
+        return 1;
+    }
+    std::printf("LOD chains within their triangle budgets and error bounds\n");
+    return 0;
+}
+
+int RunLodGenerator(const std::vector<std::string>& args)
+{
+    std::vector<std::string> files = CollectModelFiles(args);
+    int failures = 0;
+    bool generation = LodGenerationEnabled();
+    SetLodGeneration(true);
+
+    for (const std::string& path : files)
+    {
+        Clock::time_point start = Clock::now();
+        std::unique_ptr<ModelData> model = ImportModel(path);
+        if (model->meshes.empty() || !WriteBakedModel(*model, BakedModelPath(path)))
+        {
+            std::cout << "FAILED " << path << std::endl;
+            failures++;
+            continue;
+        }
+        std::printf("%s -> %s (%.2f ms)\n", path.c_str(), BakedModelPath(path).c_str(), ElapsedMs(start));
+        for (size_t m = 0; m < model->meshes.size(); m++)
+        {
+            const MeshData& mesh = model->meshes[m];
+            std::printf("  mesh %zu:", m);
+            if (mesh.lods.empty())
+                std::printf(" %zu tris", mesh.IndexCount() / 3);
+            for (const MeshLod& lod : mesh.lods)
+                std::printf(" %u tris (%.3g%%)", lod.indexCount / 3, 100.0f * lod.error / std::max(mesh.bounds.radius, 1e-6f));
+            std::printf("\n");
+        }
+    }
+    SetLodGeneration(generation);
+
+    std::cout << files.size() - failures << " of " << files.size() << " models baked with LODs" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
+
+static bool IsImageFile(const std::string& path)
+{
+    static const char* const extensions[] = { ".png", ".jpg", ".jpeg", ".tga", ".bmp" };
+    for (const char* ext : extensions)
+    {
+        size_t length = std::strlen(ext);
+        if (path.size() >= length && path.compare(path.size() - length, length, ext) == 0)
+            return true;
+    }
+    return false;
+}
+
+// Expands files and directories (searched recursively) into the image files they contain; resources by default
+static std::vector<std::string> CollectImageFiles(const std::vector<std::string>& args)
+{
+    std::vector<std::string> inputs = args;
+    if (inputs.empty())
+        inputs.push_back("resources");
+
+    std::vector<std::string> files;
+    for (const std::string& input : inputs)
+    {
+        std::error_code error;
+        if (std::filesystem::is_directory(input, error))
+        {
+            std::vector<std::string> found;
+            for (const auto& entry : std::filesystem::recursive_directory_iterator(input, error))
+            {
+                std::string path = entry.path().generic_string();
+                if (entry.is_regular_file() && IsImageFile(path))
+                    found.push_back(path);
+            }
+            std::sort(found.begin(), found.end());
+            files.insert(files.end(), found.begin(), found.end());
+        }
+        else if (IsImageFile(input))
+        {
+            files.push_back(input);
+        }
+        else
+        {
+            std::cout << "Skipping unsupported file: " << input << std::endl;
+        }
+    }
+    return files;
+}
+
+int RunTextureCompressor(const std::vector<std::string>& args)
+{
+    std::vector<std::string> files = CollectImageFiles(args);
+    int failures = 0;
+    size_t rawTotal = 0, compressedTotal = 0;
+
+    for (const std::string& path : files)
+    {
+        Clock::time_point start = Clock::now();
+        int width, height, components;
+        std::unique_ptr<unsigned char, ImageDeleter> pixels(stbi_load(path.c_str(), &width, &height, &components, 0));
+        double decodeMs = ElapsedMs(start);
+        CompressedImage image;
+        start = Clock::now();
+        bool compressed = pixels && CompressImage(pixels.get(), width, height, components, image);
+        double compressMs = ElapsedMs(start);
+        if (!compressed || !WriteCompressedTexture(image, CompressedTexturePath(path)))
+        {
+            std::cout << "FAILED " << path << std::endl;
+            failures++;
+            continue;
+        }
+
+        size_t rawBytes = static_cast<size_t>(width) * height * components * 4 / 3; // As UploadTexture counts it
+        rawTotal += rawBytes;
+        compressedTotal += image.data.size();
+        std::printf("%s: %dx%d, %d components -> %s, %zu mips, %.2f -> %.2f MB, decode %.2f ms, compress %.2f ms\n", path.c_str(),
+            width, height, components, CompressedFormatName(image.format), image.levels.size(), rawBytes / (1024.0 * 1024.0),
+            image.data.size() / (1024.0 * 1024.0), decodeMs, compressMs);
+    }
+
+    std::printf("%zu of %zu textures compressed, %.2f -> %.2f MB\n", files.size() - failures, files.size(),
+        rawTotal / (1024.0 * 1024.0), compressedTotal / (1024.0 * 1024.0));
+    return failures == 0 ? 0 : 1;
+}
+
+int RunTextureBenchmark(const std::vector<std::string>& args)
+{
+    // Block compression of photos and sky gradients stays well above this
+    const double minPSNR = 30.0;
+
+    GLFWwindow* window = CreateHiddenContext();
+    if (!window)
+        return 1;
+    if (!glExtensions.textureCompressionS3TC)
+    {
+        std::printf("ERROR: the driver has no EXT_texture_compression_s3tc\n");
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return 1;
+    }
+
+    bool valid = true;
+    double decodeTotal = 0.0, compressedTotal = 0.0;
+    size_t decodeBytes = 0, compressedBytes = 0;
+    for (const std::string& path : CollectImageFiles(args))
+    {
+        // Current path: decode, upload and let the driver build the mips
+        ImageData image;
+        SetTextureCompression(false);
+        Clock::time_point start = Clock::now();
+        if (!DecodeImage(path, image))
+        {
+            valid = false;
+            continue;
+        }
+        size_t rawBytes = 0;
+        GLTexture raw(UploadTexture(image, &rawBytes));
+        glFinish();
+        double rawMs = ElapsedMs(start);
+
+        // Compressed path, from a cached copy made beforehand if there is none yet
+        std::string compressedPath = CompressedTexturePath(path);
+        CompressedImage cached;
+        if (!IsCompressedTextureCurrent(path, compressedPath) &&
+            !(CompressImage(image.pixels.get(), image.width, image.height, image.components, cached) && WriteCompressedTexture(cached, compressedPath)))
+        {
+            std::printf("%s: ERROR: could not compress\n", path.c_str());
+            valid = false;
+            continue;
+        }
+        ImageData compressedImage;
+        SetTextureCompression(true);
+        start = Clock::now();
+        bool loaded = DecodeImage(path, compressedImage) && compressedImage.compressed.format != 0;
+        size_t bytes = 0;
+        GLTexture compressed(loaded ? UploadTexture(compressedImage, &bytes) : 0);
+        glFinish();
+        double compressedMs = ElapsedMs(start);
+
+        // The driver must take every level at its expected size, and level 0 must decode close to the source
+        bool levelsOk = loaded && compressed != 0;
+        glBindTexture(GL_TEXTURE_2D, compressed);
+        for (size_t mip = 0; levelsOk && mip < compressedImage.compressed.levels.size(); mip++)
+        {
+            GLint size = 0;
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, static_cast<GLint>(mip), GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+            levelsOk = static_cast<size_t>(size) == compressedImage.compressed.levels[mip].size;
+        }
+        double psnr = 0.0;
+        if (levelsOk)
+        {
+            int components = image.components;
+            GLenum formats[4] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+            std::vector<unsigned char> decoded(static_cast<size_t>(image.width) * image.height * components);
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            glGetTexImage(GL_TEXTURE_2D, 0, formats[components - 1], GL_UNSIGNED_BYTE, decoded.data());
+            glPixelStorei(GL_PACK_ALIGNMENT, 4);
+            double squaredError = 0.0;
+            for (size_t i = 0; i < decoded.size(); i++)
+            {
+                double difference = static_cast<double>(decoded[i]) - image.pixels.get()[i];
+                squaredError += difference * difference;
+            }
+            double meanSquaredError = squaredError / decoded.size();
+            psnr = meanSquaredError > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / meanSquaredError) : 99.0;
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        bool ok = levelsOk && psnr >= minPSNR;
+        valid = valid && ok;
+
+        std::printf("%s: %dx%d %s, %zu mips: stb_image + glGenerateMipmap %.2f ms, %.2f MB; compressed %.2f ms, %.2f MB; PSNR %.1f dB%s\n",
+            path.c_str(), image.width, image.height, CompressedFormatName(compressedImage.compressed.format), compressedImage.compressed.levels.size(),
+            rawMs, rawBytes / (1024.0 * 1024.0), compressedMs, bytes / (1024.0 * 1024.0), psnr, ok ? "" : "  ERROR");
+        decodeTotal += rawMs;
+        compressedTotal += compressedMs;
+        decodeBytes += rawBytes;
+        compressedBytes += bytes;
+    }
+    SetTextureCompression(glExtensions.textureCompressionS3TC);
+    std::printf("total: %.2f -> %.2f ms, %.2f -> %.2f MB\n", decodeTotal, compressedTotal, decodeBytes / (1024.0 * 1024.0), compressedBytes / (1024.0 * 1024.0));
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    if (!valid)
+    {
+        std::printf("ERROR: compressed textures failed their checks\n");
+        return 1;
+    }
+    std::printf("compressed textures load and match their sources\n");
+    return 0;
+}
+
+int RunStreamingSimulation(const std::vector<std::string>& args)
+{
+    const size_t textureCount = args.size() > 0 ? static_cast<size_t>(std::max(1, std::atoi(args[0].c_str()))) : 400;
+    const size_t budget = static_cast<size_t>(args.size() > 1 ? std::max(1, std::atoi(args[1].c_str())) : 32) << 20;
+    const uint64_t flightFrames = args.size() > 2 ? static_cast<uint64_t>(std::max(1, std::atoi(args[2].c_str()))) : 2000;
+    const uint64_t settleFrames = 600;     // The camera holds still at the end
+    const uint64_t thrashFrames = 30;      // A level loaded again this soon after its eviction counts as thrashing
+    const float fieldSize = 400.0f;
+    const float pixelsPerUnit = 1080.0f / (2.0f * std::tan(glm::radians(30.0f)));
+    const float viewDistance = 300.0f;
+
+    // One BC1 texture of 256 to 2048 texels per object, spread over a flat field
+    std::mt19937 rng(18);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    struct SimObject {
+        glm::vec3 center;
+        float radius;
+        int size;
+        uint32_t texture;
+    };
+    TextureResidency residency;
+    residency.budget = budget;
+    std::vector<SimObject> objects(textureCount);
+    size_t tailBytes = 0, totalBytes = 0;
+    for (SimObject& object : objects)
+    {
+        object.center = glm::vec3((unit(rng) - 0.5f) * fieldSize, 0.0f, (unit(rng) - 0.5f) * fieldSize);
+        object.radius = 2.0f + unit(rng) * 10.0f;
+        object.size = 256 << std::min(static_cast<int>(unit(rng) * 4.0f), 3);
+        std::vector<size_t> levelBytes;
+        for (int size = object.size; ; size /= 2)
+        {
+            levelBytes.push_back(static_cast<size_t>((size + 3) / 4) * ((size + 3) / 4) * 8);
+            if (size == 1)
+                break;
+        }
+        uint32_t tail = FirstLevelWithin(object.size, object.size, STREAMING_TAIL_SIZE);
+        object.texture = residency.Add(levelBytes, tail, tail);
+        for (size_t level = 0; level < levelBytes.size(); level++)
+        {
+            totalBytes += levelBytes[level];
+            if (level >= tail)
+                tailBytes += levelBytes[level];
+        }
+    }
+    std::printf("%zu textures, %.2f MB full chains, %.2f MB tails, %.2f MB budget\n", textureCount,
+        totalBytes / (1024.0 * 1024.0), tailBytes / (1024.0 * 1024.0), budget / (1024.0 * 1024.0));
+    if (tailBytes > budget)
+    {
+        std::printf("ERROR: the mip tails alone exceed the budget\n");
+        return 1;
+    }
+
+    // Loads land 1 to 4 frames after they start, like reads on a busy pool
+    std::multimap<uint64_t, uint32_t> pendingLoads;
+    std::vector<TextureResidency::Change> evictions, loads;
+    std::map<uint32_t, uint64_t> lastEviction;
+    std::vector<uint32_t> visible;
+    size_t thrashLoads = 0, peakBytes = 0, errors = 0;
+    double missingLevels = 0.0, visibleSamples = 0.0;
+    Clock::time_point start = Clock::now();
+    for (uint64_t frame = 1; frame <= flightFrames + settleFrames; frame++)
+    {
+        for (auto it = pendingLoads.begin(); it != pendingLoads.end() && it->first <= frame; it = pendingLoads.erase(it))
+            residency.Loaded(it->second, true);
+
+        // A lap around the field facing along the path, with a 90 degree field of view
+        float angle = 6.2831853f * std::min(frame, flightFrames) / flightFrames;
+        glm::vec3 camera(std::cos(angle) * fieldSize * 0.3f, 10.0f, std::sin(angle) * fieldSize * 0.3f);
+        glm::vec3 forward(-std::sin(angle), 0.0f, std::cos(angle));
+        visible.clear();
+        for (const SimObject& object : objects)
+        {
+            glm::vec3 toObject = object.center - camera;
+            float distance = glm::length(toObject);
+            if (distance > viewDistance || glm::dot(toObject, forward) < distance * 0.7071f - object.radius)
+                continue;
+            float projectedPixels = 2.0f * object.radius * pixelsPerUnit / std::max(distance - object.radius, 1e-3f);
+            residency.Request(object.texture, StreamingWantedLevel(object.size, object.size, projectedPixels), frame);
+            visible.push_back(object.texture);
+        }
+
+        residency.Update(frame, STREAMING_MAX_LOADS, evictions, loads);
+        for (const TextureResidency::Change& eviction : evictions)
+        {
+            const TextureResidency::StreamedTexture* texture = residency.Find(eviction.texture);
+            if (eviction.level > texture->tailLevel || (texture->lastUsedFrame == frame && eviction.level > texture->wantedLevel))
+            {
+                if (errors++ < 10)
+                    std::printf("ERROR: frame %llu evicted texture %u to level %u (tail %u, wanted %u, last used %llu)\n",
+                        static_cast<unsigned long long>(frame), eviction.texture, eviction.level, texture->tailLevel, texture->wantedLevel,
+                        static_cast<unsigned long long>(texture->lastUsedFrame));
+            }
+            lastEviction[eviction.texture] = frame;
+        }
+        for (const TextureResidency::Change& load : loads)
+        {
+            auto evicted = lastEviction.find(load.texture);
+            if (evicted != lastEviction.end() && frame - evicted->second <= thrashFrames)
+                thrashLoads++;
+            pendingLoads.emplace(frame + 1 + rng() % 4, load.texture);
+        }
+
+        TextureResidency::Stats stats = residency.GetStats(frame);
+        peakBytes = std::max(peakBytes, stats.committedBytes);
+        if (stats.committedBytes > budget && errors++ < 10)
+            std::printf("ERROR: frame %llu commits %zu bytes over a %zu byte budget\n", static_cast<unsigned long long>(frame), stats.committedBytes, budget);
+        for (uint32_t id : visible)
+        {
+            const TextureResidency::StreamedTexture* texture = residency.Find(id);
+            missingLevels += texture->residentLevel - std::min(texture->wantedLevel, texture->residentLevel);
+        }
+        visibleSamples += visible.size();
+    }
+    double simulateMs = ElapsedMs(start);
+
+    // Once the camera has held still, the view should be fully streamed in if it fits the budget
+    // (textures may keep more detail than they want while nothing needs the room)
+    uint64_t lastFrame = flightFrames + settleFrames;
+    size_t neededBytes = 0, settled = 0;
+    for (const SimObject& object : objects)
+    {
+        const TextureResidency::StreamedTexture* texture = residency.Find(object.texture);
+        uint32_t level = texture->lastUsedFrame == lastFrame ? texture->wantedLevel : texture->tailLevel;
+        for (size_t i = level; i < texture->levelBytes.size(); i++)
+            neededBytes += texture->levelBytes[i];
+    }
+    for (uint32_t id : visible)
+    {
+        const TextureResidency::StreamedTexture* texture = residency.Find(id);
+        settled += texture->residentLevel <= texture->wantedLevel ? 1 : 0;
+    }
+    bool fits = neededBytes <= budget;
+    if (fits && settled != visible.size())
+    {
+        std::printf("ERROR: %zu of %zu textures in view did not reach their wanted level\n", visible.size() - settled, visible.size());
+        errors++;
+    }
+
+    TextureResidency::Stats stats = residency.GetStats(lastFrame);
+    std::printf("%llu frames in %.2f ms: %zu loads, %zu evictions, %zu loads within %llu frames of an eviction, peak %.2f MB\n",
+        static_cast<unsigned long long>(lastFrame), simulateMs, stats.loads, stats.evictions, thrashLoads,
+        static_cast<unsigned long long>(thrashFrames), peakBytes / (1024.0 * 1024.0));
+    std::printf("in view: %.2f levels short of wanted on average; at rest %zu of %zu settled, %.2f MB needed (%s the budget)\n",
+        visibleSamples > 0.0 ? missingLevels / visibleSamples : 0.0, settled, visible.size(), neededBytes / (1024.0 * 1024.0),
+        fits ? "within" : "over");
+    if (errors > 0)
+    {
+        std::printf("ERROR: %zu residency checks failed\n", errors);
+        return 1;
+    }
+    std::printf("residency stayed within budget%s\n", fits ? " and settled" : "");
+    return 0;
+}
+
+// Model matrix the way Model::UpdateTransform built it before TransformCache: three glm::rotate calls and a 3x3 inverse
+static void ReferenceTransform(const glm::vec3& position, const glm::vec3& rotation, const glm::vec3& scale, glm::mat4& modelMatrix, glm::mat3& normalMatrix)
+{
+    modelMatrix = glm::translate(glm::mat4(1.0f), position);
+    modelMatrix = glm::rotate(modelMatrix, glm::radians(rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
+    modelMatrix = glm::rotate(modelMatrix, glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
+    modelMatrix = glm::rotate(modelMatrix, glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
+    modelMatrix = glm::scale(modelMatrix, scale);
+    normalMatrix = glm::transpose(glm::inverse(glm::mat3(modelMatrix)));
+}
+
+int RunTransformBenchmark(const std::vector<std::string>& args)
+{
+    const size_t instanceCount = args.size() > 0 ? static_cast<size_t>(std::max(1, std::atoi(args[0].c_str()))) : 100000;
+    const double dirtyPercent = args.size() > 1 ? std::max(0.0, std::min(100.0, std::atof(args[1].c_str()))) : 1.0;
+    const int frames = args.size() > 2 ? std::max(1, std::atoi(args[2].c_str())) : 200;
+    const size_t dirtyCount = std::max<size_t>(1, static_cast<size_t>(instanceCount * dirtyPercent / 100.0));
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+    std::uniform_real_distribution<float> angle(-720.0f, 720.0f);
+    std::uniform_real_distribution<float> scale(0.1f, 10.0f);
+    std::uniform_int_distribution<size_t> pick(0, instanceCount - 1);
+
+    // Every eighth rotation sits on quarter turns, as editor values often do
+    auto randomRotation = [&](size_t i)
+    {
+        glm::vec3 rotation(angle(rng), angle(rng), angle(rng));
+        return i % 8 == 0 ? glm::round(rotation / 90.0f) * 90.0f : rotation;
+    };
+    std::vector<glm::vec3> positions(instanceCount), rotations(instanceCount), scales(instanceCount);
+    for (size_t i = 0; i < instanceCount; i++)
+    {
+        positions[i] = glm::vec3(position(rng), position(rng), position(rng));
+        rotations[i] = randomRotation(i);
+        scales[i] = glm::vec3(scale(rng), scale(rng), scale(rng));
+    }
+    std::vector<glm::mat4> referenceModels(instanceCount);
+    std::vector<glm::mat3> referenceNormals(instanceCount);
+
+    // Rebuilding every matrix each frame, as the renderer once did
+    const int fullFrames = std::min(frames, 10);
+    Clock::time_point start = Clock::now();
+    for (int frame = 0; frame < fullFrames; frame++)
+    {
+        for (size_t i = 0; i < instanceCount; i++)
+            ReferenceTransform(positions[i], rotations[i], scales[i], referenceModels[i], referenceNormals[i]);
+    }
+    double fullMs = ElapsedMs(start) / fullFrames;
+
+    TransformCache cache;
+    cache.Resize(instanceCount);
+    for (size_t i = 0; i < instanceCount; i++)
+        cache.Set(i, positions[i], rotations[i], scales[i]);
+    start = Clock::now();
+    cache.Update();
+    double cacheFullMs = ElapsedMs(start);
+
+    // The same moves for each method: a fresh random slice of the instances per frame
+    std::vector<std::vector<size_t>> moves(frames);
+    for (std::vector<size_t>& move : moves)
+    {
+        for (size_t i = 0; i < dirtyCount; i++)
+            move.push_back(pick(rng));
+    }
+
+    double glmMs = 0.0, composeMs = 0.0, cacheMs = 0.0;
+    double maxModelError = 0.0, maxNormalError = 0.0;
+    std::vector<glm::mat4> composedModels(instanceCount);
+    std::vector<glm::mat3> composedNormals(instanceCount);
+    for (int frame = 0; frame < frames; frame++)
+    {
+        const std::vector<size_t>& move = moves[frame];
+        for (size_t i : move)
+        {
+            positions[i].y += 0.5f;
+            rotations[i] = randomRotation(i);
+        }
+
+        start = Clock::now();
+        for (size_t i : move)
+            ReferenceTransform(positions[i], rotations[i], scales[i], referenceModels[i], referenceNormals[i]);
+        glmMs += ElapsedMs(start);
+
+        start = Clock::now();
+        for (size_t i : move)
+            ComposeTransform(positions[i], rotations[i], scales[i], composedModels[i], composedNormals[i]);
+        composeMs += ElapsedMs(start);
+
+        start = Clock::now();
+        for (size_t i : move)
+            cache.Set(i, positions[i], rotations[i], scales[i]);
+        cache.Update();
+        cacheMs += ElapsedMs(start);
+
+        // Errors relative to each column's length, so large scales and positions do not hide small ones
+        for (uint32_t i : cache.Updated())
+        {
+            for (int column = 0; column < 4; column++)
+            {
+                glm::vec4 expected = referenceModels[i][column];
+                float length = column < 3 ? glm::length(glm::vec3(expected)) : 1.0f + glm::length(glm::vec3(expected));
+                maxModelError = std::max(maxModelError, static_cast<double>(glm::length(cache.ModelMatrix(i)[column] - expected) / length));
+            }
+            for (int column = 0; column < 3; column++)
+            {
+                glm::vec3 expected = referenceNormals[i][column];
+                maxNormalError = std::max(maxNormalError, static_cast<double>(glm::length(cache.NormalMatrix(i)[column] - expected) / glm::length(expected)));
+            }
+        }
+    }
+
+    // Every entry, not just the last frame's, must agree with the reference
+    size_t stale = 0;
+    for (size_t i = 0; i < instanceCount; i++)
+    {
+        if (cache.IsDirty(i) || glm::length(glm::vec3(cache.ModelMatrix(i)[3]) - positions[i]) > 1e-3f)
+            stale++;
+    }
+
+    std::printf("%zu instances, %zu (%.2f%%) moved per frame over %d frames\n", instanceCount, dirtyCount, dirtyPercent, frames);
+    std::printf("%-40s %10.3f ms/frame\n", "rebuild all, glm::rotate + inverse", fullMs);
+    std::printf("%-40s %10.3f ms\n", "rebuild all, TransformCache", cacheFullMs);
+    std::printf("%-40s %10.3f ms/frame\n", "moved only, glm::rotate + inverse", glmMs / frames);
+    std::printf("%-40s %10.3f ms/frame\n", "moved only, ComposeTransform", composeMs / frames);
+    std::printf("%-40s %10.3f ms/frame (%.1fx vs rebuild all)\n", "moved only, TransformCache", cacheMs / frames,
+        cacheMs > 0.0 ? fullMs * frames / cacheMs : 0.0);
+    std::printf("largest relative error against glm: model %.2e, normal %.2e\n", maxModelError, maxNormalError);
+
+    const double tolerance = 1e-5;
+    if (maxModelError > tolerance || maxNormalError > tolerance || stale > 0)
+    {
+        std::printf("ERROR: matrices differ from glm beyond %.0e or %zu entries are stale\n", tolerance, stale);
+        return 1;
+    }
+    std::printf("matrices match glm\n");
+    return 0;
+}
+
+// A node of the pointer-based hierarchy the scene graph benchmark compares against
+struct PointerNode {
+    glm::mat4 local;
+    glm::mat4 world;
+    std::vector<PointerNode*> children;
+};
+
+int RunSceneGraphBenchmark(const std::vector<std::string>& args)
+{
+    const size_t nodeCount = args.size() > 0 ? static_cast<size_t>(std::max(2, std::atoi(args[0].c_str()))) : 100000;
+    const int passes = args.size() > 1 ? std::max(1, std::atoi(args[1].c_str())) : 100;
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    auto randomLocal = [&]()
+    {
+        glm::mat4 local = glm::translate(glm::mat4(1.0f), glm::vec3(unit(rng), unit(rng), unit(rng)));
+        return glm::rotate(local, unit(rng) * 0.5f, glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)) + glm::vec3(0.0f, 2.0f, 0.0f)));
+    };
+    const glm::mat4 root = glm::translate(glm::mat4(1.0f), glm::vec3(10.0f, 0.0f, -5.0f));
+
+    struct Shape {
+        const char* name;
+        std::vector<int32_t> parents; // In creation order, parents not necessarily first
+    };
+    std::vector<Shape> shapes(4);
+    shapes[0].name = "deep (chain)";
+    shapes[1].name = "wide (all under the root)";
+    shapes[2].name = "bushy (4 children each)";
+    shapes[3].name = "random, shuffled";
+    for (size_t i = 0; i < nodeCount; i++)
+    {
+        shapes[0].parents.push_back(static_cast<int32_t>(i) - 1);
+        shapes[1].parents.push_back(-1);
+        shapes[2].parents.push_back(i == 0 ? -1 : static_cast<int32_t>((i - 1) / 4));
+        shapes[3].parents.push_back(i == 0 ? -1 : static_cast<int32_t>(rng() % i));
+    }
+    // Shuffle the random tree so it needs sorting by depth
+    std::vector<uint32_t> shuffle(nodeCount);
+    for (size_t i = 0; i < nodeCount; i++)
+        shuffle[i] = static_cast<uint32_t>(i);
+    std::shuffle(shuffle.begin(), shuffle.end(), rng);
+    std::vector<int32_t> shuffled(nodeCount);
+    for (size_t i = 0; i < nodeCount; i++)
+        shuffled[shuffle[i]] = shapes[3].parents[i] < 0 ? -1 : static_cast<int32_t>(shuffle[shapes[3].parents[i]]);
+    shapes[3].parents = shuffled;
+
+    std::printf("%zu nodes, %d passes each\n", nodeCount, passes);
+    std::printf("%-28s %10s %14s %14s %10s\n", "hierarchy", "sort ms", "linear ns/node", "pointer ns/node", "speedup");
+    size_t errors = 0;
+    for (const Shape& shape : shapes)
+    {
+        SceneGraph unsorted;
+        for (size_t i = 0; i < nodeCount; i++)
+        {
+            unsorted.parents.push_back(shape.parents[i]);
+            unsorted.locals.push_back(randomLocal());
+        }
+        std::vector<uint32_t> remap;
+        Clock::time_point start = Clock::now();
+        SceneGraph graph = SceneGraph::SortByDepth(unsorted, remap);
+        double sortMs = ElapsedMs(start);
+        for (size_t i = 0; i < graph.Size(); i++)
+        {
+            if (graph.parents[i] >= static_cast<int32_t>(i))
+                errors++;
+        }
+
+        std::vector<glm::mat4> worlds(graph.Size());
+        start = Clock::now();
+        for (int pass = 0; pass < passes; pass++)
+            graph.Propagate(root, worlds.data());
+        double linearMs = ElapsedMs(start);
+
+        // The same tree as individually allocated nodes with child lists, walked depth first
+        std::vector<std::unique_ptr<PointerNode>> pointerNodes(nodeCount);
+        std::vector<PointerNode*> roots;
+        for (size_t i = 0; i < nodeCount; i++)
+        {
+            pointerNodes[i].reset(new PointerNode());
+            pointerNodes[i]->local = unsorted.locals[i];
+        }
+        for (size_t i = 0; i < nodeCount; i++)
+        {
+            if (shape.parents[i] < 0)
+                roots.push_back(pointerNodes[i].get());
+            else
+                pointerNodes[shape.parents[i]]->children.push_back(pointerNodes[i].get());
+        }
+        std::vector<std::pair<PointerNode*, const glm::mat4*>> stack;
+        start = Clock::now();
+        for (int pass = 0; pass < passes; pass++)
+        {
+            for (PointerNode* node : roots)
+                stack.emplace_back(node, &root);
+            while (!stack.empty())
+            {
+                PointerNode* node = stack.back().first;
+                node->world = *stack.back().second * node->local;
+                stack.pop_back();
+                for (PointerNode* child : node->children)
+                    stack.emplace_back(child, &node->world);
+            }
+        }
+        double pointerMs = ElapsedMs(start);
+
+        // Both compute each world from the same operands in the same order, so they agree exactly
+        for (size_t i = 0; i < nodeCount; i++)
+        {
+            if (worlds[remap[i]] != pointerNodes[i]->world)
+                errors++;
+        }
+        double perNode = 1e6 / (static_cast<double>(nodeCount) * passes);
+        std::printf("%-28s %10.3f %14.2f %14.2f %9.2fx\n", shape.name, sortMs, linearMs * perNode, pointerMs * perNode, pointerMs / linearMs);
+
+        // Static flattening: with 1% of the nodes animated, only those are left to propagate
+        if (&shape == &shapes[0])
+            continue; // A chain of static nodes folds into one offset with rounding that grows down the chain
+        std::vector<unsigned char> dynamic(graph.Size());
+        for (size_t i = 0; i < dynamic.size(); i++)
+            dynamic[i] = rng() % 100 == 0 ? 1 : 0;
+        std::vector<FlattenedNode> placement;
+        start = Clock::now();
+        SceneGraph flattened = graph.Flatten(dynamic, placement);
+        double flattenMs = ElapsedMs(start);
+        std::vector<glm::mat4> flattenedWorlds(flattened.Size());
+        start = Clock::now();
+        for (int pass = 0; pass < passes; pass++)
+            flattened.Propagate(root, flattenedWorlds.data());
+        double flattenedMs = ElapsedMs(start);
+
+        double maxError = 0.0;
+        for (size_t i = 0; i < graph.Size(); i++)
+        {
+            const FlattenedNode& place = placement[i];
+            glm::mat4 world = (place.node < 0 ? root : flattenedWorlds[place.node]) * place.offset;
+            for (int column = 0; column < 4; column++)
+            {
+                float scale = 1.0f + glm::length(worlds[i][column]);
+                maxError = std::max(maxError, static_cast<double>(glm::length(world[column] - worlds[i][column]) / scale));
+            }
+        }
+        if (maxError > 1e-4)
+            errors++;
+        std::printf("%-28s flattened in %.3f ms to %zu nodes: %.3f ms per pass against %.3f, largest error %.1e\n", "",
+            flattenMs, flattened.Size(), flattenedMs / passes, linearMs / passes, maxError);
+    }
+
+    if (errors > 0)
+    {
+        std::printf("ERROR: %zu scene graph checks failed\n", errors);
+        return 1;
+    }
+    std::printf("world transforms match\n");
+    return 0;
+}
+
+// A model the way it was stored before Scene: transform inputs, cold path and per-mesh state in one
+// object, kept in a std::vector that deleting erased from
+struct LegacyModel {
+    std::shared_ptr<const ModelAsset> asset;
+    glm::vec3 position;
+    glm::vec3 rotation;
+    glm::vec3 scaleFactor;
+    std::string path;
+    glm::mat4 modelMatrix;
+    glm::mat3 normalMatrix;
+    std::vector<glm::mat4> nodeMatrices;
+    std::vector<glm::mat3> nodeNormalMatrices;
+    std::vector<Bounds> meshBounds;
+    Bounds bounds;
+    bool transformDirty;
+    std::vector<unsigned char> meshVisible;
+    std::vector<unsigned char> meshLods;
+};
+
+static bool PositionLess(const glm::vec3& a, const glm::vec3& b)
+{
+    return a.x != b.x ? a.x < b.x : a.y != b.y ? a.y < b.y : a.z < b.z;
+}
+
+int RunSceneBenchmark(const std::vector<std::string>& args)
+{
+    const size_t instanceCount = args.size() > 0 ? static_cast<size_t>(std::max(16, std::atoi(args[0].c_str()))) : 100000;
+    const double dirtyPercent = args.size() > 1 ? std::max(0.0, std::min(100.0, std::atof(args[1].c_str()))) : 1.0;
+    const int frames = args.size() > 2 ? std::max(1, std::atoi(args[2].c_str())) : 200;
+    const size_t dirtyCount = std::max<size_t>(1, static_cast<size_t>(instanceCount * dirtyPercent / 100.0));
+    std::mt19937 rng(17);
+    std::uniform_real_distribution<float> coordinate(-500.0f, 500.0f);
+    std::uniform_real_distribution<float> angle(-180.0f, 180.0f);
+    std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+
+    // Every instance uses one asset that is never loaded, standing in for a one-mesh model around the origin
+    std::shared_ptr<const ModelAsset> asset = std::make_shared<ModelAsset>("resources/bench/instance.glb");
+    const glm::vec3 corners[2] = { glm::vec3(-1.0f), glm::vec3(1.0f) };
+    const Bounds localBounds = ComputeBounds(corners, 2, sizeof(glm::vec3));
+
+    std::vector<LegacyModel> legacy(instanceCount);
+    TransformCache legacyTransforms; // Batches the dirty models found by scanning, as updateModelTransforms did
+    legacyTransforms.Resize(instanceCount);
+    Scene scene;
+    for (size_t i = 0; i < instanceCount; i++)
+    {
+        LegacyModel& model = legacy[i];
+        model.asset = asset;
+        model.position = glm::vec3(coordinate(rng), coordinate(rng) * 0.1f, coordinate(rng));
+        model.rotation = glm::vec3(angle(rng), angle(rng), angle(rng));
+        model.scaleFactor = glm::vec3(scale(rng));
+        model.path = asset->path;
+        model.meshBounds.resize(1);
+        model.meshVisible.resize(1, 0);
+        model.meshLods.resize(1, 0);
+        model.transformDirty = true;
+        scene.Add(Model(asset), model.position, model.rotation, model.scaleFactor);
+    }
+
+    // Legacy passes: scan every object for edits, gather the bounds the BVH needs, read matrices per visible object
+    auto legacyTransformPass = [&]()
+    {
+        for (size_t i = 0; i < legacy.size(); i++)
+        {
+            if (legacy[i].transformDirty)
+                legacyTransforms.Set(i, legacy[i].position, legacy[i].rotation, legacy[i].scaleFactor);
+        }
+        legacyTransforms.Update();
+        for (uint32_t i : legacyTransforms.Updated())
+        {
+            LegacyModel& model = legacy[i];
+            model.modelMatrix = legacyTransforms.ModelMatrix(i);
+            model.normalMatrix = legacyTransforms.NormalMatrix(i);
+            model.meshBounds[0] = TransformBounds(localBounds, model.modelMatrix);
+            model.bounds = model.meshBounds[0];
+            model.transformDirty = false;
+        }
+    };
+    std::vector<Bounds> gathered;
+    auto legacyCullPass = [&](const Frustum& frustum, std::vector<uint32_t>& visible)
+    {
+        gathered.resize(legacy.size());
+        for (size_t i = 0; i < legacy.size(); i++)
+            gathered[i] = legacy[i].bounds;
+        for (size_t i = 0; i < gathered.size(); i++)
+        {
+            if (frustum.Intersects(gathered[i]))
+                visible.push_back(static_cast<uint32_t>(i));
+        }
+    };
+    // Scene passes: edits are already listed, bounds are already dense, matrices come from their own arrays
+    auto sceneTransformPass = [&]()
+    {
+        scene.transforms.Update();
+        for (uint32_t i : scene.transforms.Updated())
+            scene.bounds[i] = TransformBounds(localBounds, scene.transforms.ModelMatrix(i));
+    };
+    auto sceneCullPass = [&](const Frustum& frustum, std::vector<uint32_t>& visible)
+    {
+        for (size_t i = 0; i < scene.bounds.size(); i++)
+        {
+            if (frustum.Intersects(scene.bounds[i]))
+                visible.push_back(static_cast<uint32_t>(i));
+        }
+    };
+    auto writeInstance = [](InstanceData& instance, const glm::mat4& model, const glm::mat3& normal)
+    {
+        instance.model = model;
+        for (int column = 0; column < 3; column++)
+            instance.normalMatrix[column] = glm::vec4(normal[column], 1.0f);
+    };
+
+    legacyTransformPass();
+    sceneTransformPass();
+
+    double legacyMs[3] = { 0.0, 0.0, 0.0 }, sceneMs[3] = { 0.0, 0.0, 0.0 };
+    size_t errors = 0, visibleTotal = 0;
+    std::vector<uint32_t> legacyVisible, sceneVisible;
+    std::vector<InstanceData> legacyInstances, sceneInstances;
+    const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+    for (int frame = 0; frame < frames; frame++)
+    {
+        // The same edits for both, made the way the editor makes them
+        for (size_t move = 0; move < dirtyCount; move++)
+        {
+            size_t i = rng() % instanceCount;
+            glm::vec3 position = legacy[i].position + glm::vec3(0.0f, 0.5f, 0.0f);
+            legacy[i].position = position;
+            legacy[i].transformDirty = true;
+            scene.SetTransform(i, position, scene.transforms.Rotation(i), scene.transforms.Scale(i));
+        }
+        float yaw = glm::radians(360.0f * frame / frames);
+        Frustum frustum(projection * glm::lookAt(glm::vec3(0.0f, 20.0f, 0.0f), glm::vec3(std::cos(yaw), 20.0f, std::sin(yaw)), glm::vec3(0.0f, 1.0f, 0.0f)));
+
+        Clock::time_point start = Clock::now();
+        legacyTransformPass();
+        legacyMs[0] += ElapsedMs(start);
+        start = Clock::now();
+        sceneTransformPass();
+        sceneMs[0] += ElapsedMs(start);
+
+        legacyVisible.clear();
+        sceneVisible.clear();
+        start = Clock::now();
+        legacyCullPass(frustum, legacyVisible);
+        legacyMs[1] += ElapsedMs(start);
+        start = Clock::now();
+        sceneCullPass(frustum, sceneVisible);
+        sceneMs[1] += ElapsedMs(start);
+
+        legacyInstances.resize(legacyVisible.size());
+        sceneInstances.resize(sceneVisible.size());
+        start = Clock::now();
+        for (size_t i = 0; i < legacyVisible.size(); i++)
+            writeInstance(legacyInstances[i], legacy[legacyVisible[i]].modelMatrix, legacy[legacyVisible[i]].normalMatrix);
+        legacyMs[2] += ElapsedMs(start);
+        start = Clock::now();
+        for (size_t i = 0; i < sceneVisible.size(); i++)
+            writeInstance(sceneInstances[i], scene.transforms.ModelMatrix(sceneVisible[i]), scene.transforms.NormalMatrix(sceneVisible[i]));
+        sceneMs[2] += ElapsedMs(start);
+
+        // Same math on the same inputs, so the results agree exactly
+        visibleTotal += sceneVisible.size();
+        if (legacyVisible != sceneVisible ||
+            (!sceneInstances.empty() && std::memcmp(legacyInstances.data(), sceneInstances.data(), sceneInstances.size() * sizeof(InstanceData)) != 0))
+            errors++;
+    }
+
+    // Deleting: erasing shifts every later object, removing swaps the last model in
+    const size_t deleteCount = std::min<size_t>(instanceCount / 10, 2000);
+    std::vector<ModelHandle> handles(instanceCount);
+    std::vector<glm::vec3> handlePositions(instanceCount);
+    for (size_t i = 0; i < instanceCount; i++)
+    {
+        handles[i] = scene.HandleAt(i);
+        handlePositions[i] = scene.transforms.Position(i);
+    }
+    // The same models go from both: the vector erases by index, which shifts as earlier ones go
+    std::vector<size_t> deletes(instanceCount);
+    for (size_t i = 0; i < instanceCount; i++)
+        deletes[i] = i;
+    std::shuffle(deletes.begin(), deletes.end(), rng);
+    deletes.resize(deleteCount);
+    std::vector<size_t> legacyDeletes(deleteCount);
+    for (size_t i = 0; i < deleteCount; i++)
+    {
+        legacyDeletes[i] = deletes[i];
+        for (size_t j = 0; j < i; j++)
+            legacyDeletes[i] -= deletes[j] < deletes[i] ? 1 : 0;
+    }
+    Clock::time_point start = Clock::now();
+    for (size_t index : legacyDeletes)
+        legacy.erase(legacy.begin() + index);
+    double legacyDeleteMs = ElapsedMs(start);
+    start = Clock::now();
+    for (size_t index : deletes)
+        scene.Remove(handles[index]);
+    double sceneDeleteMs = ElapsedMs(start);
+
+    // Both keep the same models, in different orders; handles still find theirs and removed ones are stale
+    std::vector<glm::vec3> legacyPositions, scenePositions;
+    for (const LegacyModel& model : legacy)
+        legacyPositions.push_back(model.position);
+    for (size_t i = 0; i < scene.Size(); i++)
+        scenePositions.push_back(scene.transforms.Position(i));
+    std::sort(legacyPositions.begin(), legacyPositions.end(), PositionLess);
+    std::sort(scenePositions.begin(), scenePositions.end(), PositionLess);
+    if (legacyPositions != scenePositions)
+        errors++;
+    size_t live = 0;
+    for (size_t i = 0; i < instanceCount; i++)
+    {
+        size_t index = scene.IndexOf(handles[i]);
+        if (index == Scene::NO_INDEX)
+            continue;
+        live++;
+        if (scene.transforms.Position(index) != handlePositions[i] || scene.HandleAt(index) != handles[i])
+            errors++;
+    }
+    if (live != scene.Size())
+        errors++;
+    ModelHandle reused = scene.Add(Model(asset));
+    for (size_t i = 0; i < instanceCount; i++)
+    {
+        if (handles[i].slot == reused.slot && (handles[i] == reused || scene.IndexOf(handles[i]) != Scene::NO_INDEX))
+            errors++;
+    }
+
+    // Bytes each pass walks through, a stand-in for cache misses: whole objects for the old layout
+    // (one edit flag, one box or two matrices per object), only the arrays a pass reads for the Scene
+    const double frameCount = static_cast<double>(frames), mb = 1024.0 * 1024.0;
+    const double visibleAverage = visibleTotal / frameCount;
+    const double legacyBytes[3] = { static_cast<double>(instanceCount) * sizeof(LegacyModel),
+        static_cast<double>(instanceCount) * (sizeof(LegacyModel) + sizeof(Bounds)), visibleAverage * sizeof(LegacyModel) };
+    const double sceneBytes[3] = { dirtyCount * (9.0 * sizeof(float) + sizeof(glm::mat4) + sizeof(glm::mat3) + sizeof(Bounds)),
+        static_cast<double>(instanceCount) * sizeof(Bounds), visibleAverage * (sizeof(glm::mat4) + sizeof(glm::mat3)) };
+    const char* passNames[3] = { "transforms", "bounds + cull", "draw packets" };
+
+    std::printf("%zu instances, %zu (%.2f%%) moved per frame over %d frames, %.0f visible on average\n",
+        instanceCount, dirtyCount, dirtyPercent, frames, visibleAverage);
+    std::printf("%zu bytes per model object before, %zu bytes of hot arrays per model in the Scene\n", sizeof(LegacyModel),
+        9 * sizeof(float) + sizeof(glm::mat4) + sizeof(glm::mat3) + sizeof(Bounds) + 1);
+    std::printf("%-16s %14s %10s %9s %18s\n", "pass", "vector ms/frm", "Scene", "speedup", "MB walked old/new");
+    for (int pass = 0; pass < 3; pass++)
+    {
+        std::printf("%-16s %14.3f %10.3f %8.2fx %8.2f / %7.2f\n", passNames[pass], legacyMs[pass] / frameCount, sceneMs[pass] / frameCount,
+            sceneMs[pass] > 0.0 ? legacyMs[pass] / sceneMs[pass] : 0.0, legacyBytes[pass] / mb, sceneBytes[pass] / mb);
+    }
+    std::printf("%-16s %14.3f %10.3f %8.2fx   (%zu deletes, ms total)\n", "delete", legacyDeleteMs, sceneDeleteMs,
+        sceneDeleteMs > 0.0 ? legacyDeleteMs / sceneDeleteMs : 0.0, deleteCount);
+
+    if (errors > 0)
+    {
+        std::printf("ERROR: %zu scene checks failed\n", errors);
+        return 1;
+    }
+    std::printf("both layouts agree and handles follow their models\n");
+    return 0;
+}
+
+int RunProfilerBenchmark(const std::vector<std::string>& args)
+{
+    if (!Profiler::Compiled())
+    {
+        std::printf("profiler markers are compiled out of this build (PROFILER_ENABLED is not defined)\n");
+        return 0;
+    }
+    const size_t markerCount = args.size() > 0 ? static_cast<size_t>(std::max(1000, std::atoi(args[0].c_str()))) : 1000000;
+    const std::string tracePath = args.size() > 1 ? args[1] : "profile_bench.json";
+    const double maxMarkerNs = 50.0;
+    Profiler::SetThreadName("Main");
+
+    // The same loop without and with a marker around its body
+    volatile size_t sink = 0;
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < markerCount; i++)
+        sink = sink + i;
+    double baseMs = ElapsedMs(start);
+    start = Clock::now();
+    for (size_t i = 0; i < markerCount; i++)
+    {
+        PROFILE_SCOPE("Marker");
+        sink = sink + i;
+    }
+    double markerMs = ElapsedMs(start);
+    double markerNs = std::max(0.0, markerMs - baseMs) * 1e6 / markerCount;
+
+    // Nested markers on every pool thread at once, few enough that they fill at most half of a ring
+    ThreadPool& pool = ThreadPool::Shared();
+    const size_t jobs = (pool.Size() + 1) * 4;
+    const size_t perJob = std::max<size_t>(1, Profiler::THREAD_CAPACITY / 2 / jobs - 1);
+    start = Clock::now();
+    pool.ParallelFor(jobs, 1, [&](size_t begin, size_t end)
+    {
+        for (size_t job = begin; job < end; job++)
+        {
+            PROFILE_SCOPE("Job");
+            for (size_t i = 0; i < perJob; i++)
+            {
+                PROFILE_SCOPE("Inner");
+                sink = sink + i;
+            }
+        }
+    });
+    double threadedMs = ElapsedMs(start);
+
+    start = Clock::now();
+    bool written = Profiler::ExportChromeTrace(tracePath);
+    double exportMs = ElapsedMs(start);
+
+    // Read the trace back: every job and inner marker is there, each inner one inside a job on its thread
+    size_t errors = written ? 0 : 1;
+    std::ifstream file(tracePath);
+    json trace = json::parse(file, nullptr, false);
+    std::map<int, std::vector<std::pair<double, double>>> jobRanges;
+    std::vector<std::pair<int, std::pair<double, double>>> innerRanges;
+    size_t namedThreads = 0, markers = 0;
+    if (trace.is_discarded() || !trace.contains("traceEvents") || !trace["traceEvents"].is_array())
+    {
+        std::printf("ERROR: %s is not a Chrome trace\n", tracePath.c_str());
+        return 1;
+    }
+    for (const json& event : trace["traceEvents"])
+    {
+        std::string phase = event.value("ph", "");
+        if (phase == "M")
+        {
+            namedThreads++;
+            continue;
+        }
+        std::string name = event.value("name", "");
+        int tid = event.value("tid", -1);
+        double ts = event.value("ts", -1.0), dur = event.value("dur", -1.0);
+        if (phase != "X" || tid < 0 || ts < 0.0 || dur < 0.0)
+            errors++;
+        if (name == "Job")
+            jobRanges[tid].emplace_back(ts, ts + dur);
+        else if (name == "Inner")
+            innerRanges.emplace_back(tid, std::make_pair(ts, ts + dur));
+        else if (name == "Marker")
+            markers++;
+    }
+    size_t jobCount = 0;
+    for (auto& ranges : jobRanges)
+    {
+        std::sort(ranges.second.begin(), ranges.second.end());
+        jobCount += ranges.second.size();
+    }
+    const double slack = 1e-3; // Microseconds of rounding
+    size_t orphans = 0;
+    for (const auto& inner : innerRanges)
+    {
+        const std::vector<std::pair<double, double>>& ranges = jobRanges[inner.first];
+        auto it = std::upper_bound(ranges.begin(), ranges.end(), std::make_pair(inner.second.first + slack, 1e300));
+        if (it == ranges.begin() || std::prev(it)->second + slack < inner.second.second)
+            orphans++;
+    }
+    if (jobCount != jobs || innerRanges.size() != jobs * perJob || orphans > 0 || markers == 0 || namedThreads < jobRanges.size())
+        errors++;
+
+    std::printf("%zu markers on one thread: %.1f ns each (limit %.0f)\n", markerCount, markerNs, maxMarkerNs);
+    std::printf("%zu nested markers on %zu threads in %.3f ms (%.1f M markers/s)\n", jobs * (perJob + 1), jobRanges.size(), threadedMs,
+        jobs * (perJob + 1) / (threadedMs * 1e3));
+    std::printf("exported %s in %.1f ms: %zu threads, %zu jobs, %zu inner markers (%zu outside a job), %zu of the single-thread markers kept\n",
+        tracePath.c_str(), exportMs, namedThreads, jobCount, innerRanges.size(), orphans, markers);
+    if (markerNs > maxMarkerNs)
+    {
+        std::printf("ERROR: markers cost %.1f ns, over the %.0f ns budget\n", markerNs, maxMarkerNs);
+        errors++;
+    }
+    if (errors > 0)
+    {
+        std::printf("ERROR: %zu profiler checks failed\n", errors);
+        return 1;
+    }
+    std::printf("trace is complete and well nested\n");
+    return 0;
+}
@@ -0,0 +1,84 @@
+// Tools.h
+#ifndef TOOLS_H
+#define TOOLS_H
+
+#include <string>
+#include <vector>
+
+// Command line tools that run without opening a window.
+// Each takes the arguments following its switch and returns the process exit code.
+
+// --bake [paths...]: bakes the given models (or every model in the given directories)
+int RunBakeTool(const std::vector<std::string>& args);
+
+// --bench-load [paths...]: compares Assimp import and baked file load times per model
+int RunLoadBenchmark(const std::vector<std::string>& args);
+
+// --bench-uniforms [meshes]: per-frame cost of name-based uniform updates vs handles and uniform buffers (needs a GL driver)
+int RunUniformBenchmark(const std::vector<std::string>& args);
+
+// --bench-clusters [lights]: times light cluster assignment and checks it against brute force
+int RunClusterBenchmark(const std::vector<std::string>& args);
+
+// --bench-bvh [items]: BVH build, update and query times, checked against brute force
+int RunBVHBenchmark(const std::vector<std::string>& args);
+
+// --bench-queue [packets]: render queue build and sort times, and the state changes sorting saves
+int RunQueueBenchmark(const std::vector<std::string>& args);
+
+// --bench-arena [operations]: mesh arena allocator churn, checked against brute-force occupancy
+int RunArenaBenchmark(const std::vector<std::string>& args);
+
+// --bench-packing [paths...]: PackedVertex encode/decode error bounds on random vertices and, optionally, models
+int RunPackingBenchmark(const std::vector<std::string>& args);
+
+// --bench-meshopt [paths...]: ACMR/ATVR of each mesh before and after the import optimizations, checked to keep every triangle
+int RunMeshOptimizerBenchmark(const std::vector<std::string>& args);
+
+// --bench-lod [paths...]: LOD chains of a test sphere and of each model's meshes, checked against their
+// triangle budgets and, by measuring the distance from the full-detail vertices to each level, their error bounds
+int RunLodBenchmark(const std::vector<std::string>& args);
+
+// --gen-lods [paths...]: imports and bakes the given models with LOD chains and prints each mesh's chain
+// (triangles and error as a share of the bounding radius per level)
+int RunLodGenerator(const std::vector<std::string>& args);
+
+// --compress-textures [paths...]: block-compresses the given images (or every image under the given
+// directories, resources by default) with their mips into the .ktx files the loader uses
+int RunTextureCompressor(const std::vector<std::string>& args);
+
+// --bench-textures [paths...]: per image, load time and GPU memory of the stb_image path against the
+// compressed one, checking every level uploads and the base level stays close to the source (needs a GL driver)
+int RunTextureBenchmark(const std::vector<std::string>& args);
+
+// --sim-streaming [textures] [budget MB] [frames]: drives TextureResidency with a camera flying over
+// a field of textured objects, loads landing a few frames late, and checks the budget, the mip tails,
+// that nothing in use is evicted below what it wants, and that every texture in view settles at its
+// wanted level once the camera stops (no GPU needed)
+int RunStreamingSimulation(const std::vector<std::string>& args);
+
+// --bench-transforms [instances] [moved %] [frames]: model and normal matrix rebuilds per frame, all of them
+// with glm against only the moved ones through TransformCache, checked against glm
+int RunTransformBenchmark(const std::vector<std::string>& args);
+
+// --bench-scenegraph [nodes] [passes]: world transform propagation over deep, wide, bushy and shuffled
+// hierarchies, linear pass against a pointer-based walk, and what flattening the static nodes leaves
+int RunSceneGraphBenchmark(const std::vector<std::string>& args);
+
+// --bench-scene [instances] [moved %] [frames]: per-frame passes (transform update, culling, draw
+// packets) and deletes over the Scene's component arrays against the old std::vector<Model> layout
+int RunSceneBenchmark(const std::vector<std::string>& args);
+
+// --bench-profiler [markers] [trace output]: cost of a CPU marker, nested markers on every pool
+// thread, and a Chrome trace export that is read back and checked
+int RunProfilerBenchmark(const std::vector<std::string>& args);
+
+// --gen-light-scene [count] [output] [base]: writes saves/<output> with the models of saves/<base>
+// and 'count' random point lights spread over them
+int RunLightSceneGenerator(const std::vector<std::string>& args);
+
+// Expands files and directories into the list of model files they contain.
+// With no arguments, resources/projectModels is used.
+std::vector<std::string> CollectModelFiles(const std::vector<std::string>& args);
+
+#endif // TOOLS_H
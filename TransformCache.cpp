@@ -0,0 +1,214 @@
+// TransformCache.cpp
+#include "TransformCache.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRANSFORM_USE_SSE
+#include <emmintrin.h>
+#endif
+
+// Rotation part of the model matrix from the sines and cosines of the X, Y and Z angles, row by row:
+//   [ cy cz                 -cy sz                  sy    ]
+//   [ cx sz + sx sy cz       cx cz - sx sy sz      -sx cy ]
+//   [ sx sz - cx sy cz       sx cz + cx sy sz       cx cy ]
+void ComposeTransform(const glm::vec3& position, const glm::vec3& rotation, const glm::vec3& scale, glm::mat4& modelMatrix, glm::mat3& normalMatrix)
+{
+    glm::vec3 radians = glm::radians(rotation);
+    float sx = std::sin(radians.x), cx = std::cos(radians.x);
+    float sy = std::sin(radians.y), cy = std::cos(radians.y);
+    float sz = std::sin(radians.z), cz = std::cos(radians.z);
+    glm::mat3 rotationMatrix(
+        glm::vec3(cy * cz, cx * sz + sx * sy * cz, sx * sz - cx * sy * cz),
+        glm::vec3(-cy * sz, cx * cz - sx * sy * sz, sx * cz + cx * sy * sz),
+        glm::vec3(sy, -sx * cy, cx * cy));
+
+    for (int column = 0; column < 3; column++)
+    {
+        modelMatrix[column] = glm::vec4(rotationMatrix[column] * scale[column], 0.0f);
+        normalMatrix[column] = rotationMatrix[column] / scale[column];
+    }
+    modelMatrix[3] = glm::vec4(position, 1.0f);
+}
+
+#ifdef TRANSFORM_USE_SSE
+// Sines and cosines of four angles in degrees. Quarter turns are taken off first, which is exact for
+// the angles an editor produces, then the remainder of at most 45 degrees goes through the Cephes
+// single precision polynomials (within a couple of ulps of std::sin/std::cos).
+static void SinCosDegrees(__m128 degrees, __m128& sines, __m128& cosines)
+{
+    __m128i quarter = _mm_cvtps_epi32(_mm_mul_ps(degrees, _mm_set1_ps(1.0f / 90.0f))); // Rounds to nearest
+    __m128 x = _mm_sub_ps(degrees, _mm_mul_ps(_mm_cvtepi32_ps(quarter), _mm_set1_ps(90.0f)));
+    x = _mm_mul_ps(x, _mm_set1_ps(3.14159265358979f / 180.0f));
+    __m128 x2 = _mm_mul_ps(x, x);
+
+    __m128 sine = _mm_add_ps(_mm_set1_ps(8.3321608736e-3f), _mm_mul_ps(x2, _mm_set1_ps(-1.9515295891e-4f)));
+    sine = _mm_add_ps(_mm_set1_ps(-1.6666654611e-1f), _mm_mul_ps(x2, sine));
+    sine = _mm_add_ps(x, _mm_mul_ps(_mm_mul_ps(x, x2), sine));
+    __m128 cosine = _mm_add_ps(_mm_set1_ps(-1.388731625493765e-3f), _mm_mul_ps(x2, _mm_set1_ps(2.443315711809948e-5f)));
+    cosine = _mm_add_ps(_mm_set1_ps(4.166664568298827e-2f), _mm_mul_ps(x2, cosine));
+    cosine = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(x2, _mm_set1_ps(0.5f))), _mm_mul_ps(_mm_mul_ps(x2, x2), cosine));
+
+    // Odd quarters swap sine and cosine; the signs follow the quadrant
+    const __m128i one = _mm_set1_epi32(1), two = _mm_set1_epi32(2);
+    __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quarter, one), one));
+    __m128 sineSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quarter, two), 30));
+    __m128 cosineSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quarter, one), two), 30));
+    sines = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, cosine), _mm_andnot_ps(swap, sine)), sineSign);
+    cosines = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, sine), _mm_andnot_ps(swap, cosine)), cosineSign);
+}
+#endif
+
+void TransformCache::Resize(size_t count)
+{
+    positionX.resize(count, 0.0f);
+    positionY.resize(count, 0.0f);
+    positionZ.resize(count, 0.0f);
+    rotationX.resize(count, 0.0f);
+    rotationY.resize(count, 0.0f);
+    rotationZ.resize(count, 0.0f);
+    scaleX.resize(count, 1.0f);
+    scaleY.resize(count, 1.0f);
+    scaleZ.resize(count, 1.0f);
+    modelMatrices.resize(count, glm::mat4(1.0f));
+    normalMatrices.resize(count, glm::mat3(1.0f));
+    dirty.resize(count, 0);
+
+    // Drop flagged entries that no longer exist
+    size_t kept = 0;
+    for (uint32_t index : dirtyList)
+    {
+        if (index < count)
+            dirtyList[kept++] = index;
+    }
+    dirtyList.resize(kept);
+}
+
+size_t TransformCache::Add(const glm::vec3& position, const glm::vec3& rotation, const glm::vec3& scale)
+{
+    size_t index = Size();
+    Resize(index + 1);
+    Set(index, position, rotation, scale);
+    return index;
+}
+
+void TransformCache::Remove(size_t index)
+{
+    size_t last = Size() - 1;
+    // The removed entry leaves the dirty list and the last one is listed under its new index
+    size_t kept = 0;
+    for (uint32_t entry : dirtyList)
+    {
+        if (entry != index)
+            dirtyList[kept++] = entry == last ? static_cast<uint32_t>(index) : entry;
+    }
+    dirtyList.resize(kept);
+
+    positionX[index] = positionX[last];
+    positionY[index] = positionY[last];
+    positionZ[index] = positionZ[last];
+    rotationX[index] = rotationX[last];
+    rotationY[index] = rotationY[last];
+    rotationZ[index] = rotationZ[last];
+    scaleX[index] = scaleX[last];
+    scaleY[index] = scaleY[last];
+    scaleZ[index] = scaleZ[last];
+    modelMatrices[index] = modelMatrices[last];
+    normalMatrices[index] = normalMatrices[last];
+    dirty[index] = dirty[last];
+    Resize(last);
+}
+
+void TransformCache::Set(size_t index, const glm::vec3& position, const glm::vec3& rotation, const glm::vec3& scale)
+{
+    positionX[index] = position.x;
+    positionY[index] = position.y;
+    positionZ[index] = position.z;
+    rotationX[index] = rotation.x;
+    rotationY[index] = rotation.y;
+    rotationZ[index] = rotation.z;
+    scaleX[index] = scale.x;
+    scaleY[index] = scale.y;
+    scaleZ[index] = scale.z;
+    if (!dirty[index])
+    {
+        dirty[index] = 1;
+        dirtyList.push_back(static_cast<uint32_t>(index));
+    }
+}
+
+size_t TransformCache::Update()
+{
+    updated.swap(dirtyList);
+    dirtyList.clear();
+    size_t count = updated.size();
+    size_t i = 0;
+
+#ifdef TRANSFORM_USE_SSE
+    // Gather four entries into registers, build their matrices lane by lane and write them out. A short
+    // last group repeats its final entry, so every entry gets the same math wherever it falls.
+    for (; i < count; i += 4)
+    {
+        size_t laneCount = std::min<size_t>(4, count - i);
+        uint32_t lanes[4];
+        for (size_t lane = 0; lane < 4; lane++)
+            lanes[lane] = updated[i + std::min(lane, laneCount - 1)];
+        auto gather = [&lanes](const std::vector<float>& values)
+        {
+            return _mm_setr_ps(values[lanes[0]], values[lanes[1]], values[lanes[2]], values[lanes[3]]);
+        };
+        __m128 sx, cx, sy, cy, sz, cz;
+        SinCosDegrees(gather(rotationX), sx, cx);
+        SinCosDegrees(gather(rotationY), sy, cy);
+        SinCosDegrees(gather(rotationZ), sz, cz);
+
+        // Rotation columns, as in ComposeTransform
+        __m128 sxsy = _mm_mul_ps(sx, sy), cxsy = _mm_mul_ps(cx, sy);
+        __m128 rotation[3][3] = {
+            { _mm_mul_ps(cy, cz), _mm_add_ps(_mm_mul_ps(cx, sz), _mm_mul_ps(sxsy, cz)), _mm_sub_ps(_mm_mul_ps(sx, sz), _mm_mul_ps(cxsy, cz)) },
+            { _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(cy, sz)), _mm_sub_ps(_mm_mul_ps(cx, cz), _mm_mul_ps(sxsy, sz)), _mm_add_ps(_mm_mul_ps(sx, cz), _mm_mul_ps(cxsy, sz)) },
+            { sy, _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(sx, cy)), _mm_mul_ps(cx, cy) }
+        };
+        __m128 scale[3] = { gather(scaleX), gather(scaleY), gather(scaleZ) };
+        __m128 position[3] = { gather(positionX), gather(positionY), gather(positionZ) };
+
+        alignas(16) float model[3][3][4]; // [column][row][lane]
+        alignas(16) float normal[3][3][4];
+        for (int column = 0; column < 3; column++)
+        {
+            __m128 inverseScale = _mm_div_ps(_mm_set1_ps(1.0f), scale[column]);
+            for (int row = 0; row < 3; row++)
+            {
+                _mm_store_ps(model[column][row], _mm_mul_ps(rotation[column][row], scale[column]));
+                _mm_store_ps(normal[column][row], _mm_mul_ps(rotation[column][row], inverseScale));
+            }
+        }
+        alignas(16) float translation[3][4];
+        for (int row = 0; row < 3; row++)
+            _mm_store_ps(translation[row], position[row]);
+
+        for (size_t lane = 0; lane < laneCount; lane++)
+        {
+            glm::mat4& modelMatrix = modelMatrices[lanes[lane]];
+            glm::mat3& normalMatrix = normalMatrices[lanes[lane]];
+            for (int column = 0; column < 3; column++)
+            {
+                modelMatrix[column] = glm::vec4(model[column][0][lane], model[column][1][lane], model[column][2][lane], 0.0f);
+                normalMatrix[column] = glm::vec3(normal[column][0][lane], normal[column][1][lane], normal[column][2][lane]);
+            }
+            modelMatrix[3] = glm::vec4(translation[0][lane], translation[1][lane], translation[2][lane], 1.0f);
+            dirty[lanes[lane]] = 0;
+        }
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        uint32_t index = updated[i];
+        ComposeTransform(glm::vec3(positionX[index], positionY[index], positionZ[index]),
+            glm::vec3(rotationX[index], rotationY[index], rotationZ[index]),
+            glm::vec3(scaleX[index], scaleY[index], scaleZ[index]), modelMatrices[index], normalMatrices[index]);
+        dirty[index] = 0;
+    }
+    return count;
+}
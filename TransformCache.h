@@ -0,0 +1,62 @@
+// TransformCache.h
+#ifndef TRANSFORM_CACHE_H
+#define TRANSFORM_CACHE_H
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Builds the model matrix translate(position) * rotateX * rotateY * rotateZ * scale (rotation in
+// degrees, as the editor shows it) and its normal matrix. The rotation is orthonormal, so the
+// inverse transpose is the rotation divided by the scale and needs no matrix inverse.
+void ComposeTransform(const glm::vec3& position, const glm::vec3& rotation, const glm::vec3& scale, glm::mat4& modelMatrix, glm::mat3& normalMatrix);
+
+// Positions, rotations and scales of many objects in SoA arrays, with the model and normal matrices
+// built from them. Set flags an entry dirty; Update rebuilds only the dirty ones, four at a time
+// with SSE2 where available (sines and cosines included), so a frame in which a few objects move
+// costs nothing for the rest.
+class TransformCache
+{
+public:
+    size_t Size() const { return modelMatrices.size(); }
+
+    // Grows or shrinks the cache; new entries hold the identity transform
+    void Resize(size_t count);
+
+    // Appends an entry with the given transform, flagged dirty, and returns its index
+    size_t Add(const glm::vec3& position, const glm::vec3& rotation, const glm::vec3& scale);
+
+    // Removes an entry by moving the last one into its place (dirty flag included)
+    void Remove(size_t index);
+
+    // Stores the transform of an entry and flags it dirty
+    void Set(size_t index, const glm::vec3& position, const glm::vec3& rotation, const glm::vec3& scale);
+
+    glm::vec3 Position(size_t index) const { return glm::vec3(positionX[index], positionY[index], positionZ[index]); }
+    glm::vec3 Rotation(size_t index) const { return glm::vec3(rotationX[index], rotationY[index], rotationZ[index]); }
+    glm::vec3 Scale(size_t index) const { return glm::vec3(scaleX[index], scaleY[index], scaleZ[index]); }
+
+    bool IsDirty(size_t index) const { return dirty[index] != 0; }
+
+    // Rebuilds the matrices of the dirty entries and returns how many there were
+    size_t Update();
+
+    // Entries rebuilt by the last Update, in the order they were flagged
+    const std::vector<uint32_t>& Updated() const { return updated; }
+
+    const glm::mat4& ModelMatrix(size_t index) const { return modelMatrices[index]; }
+    const glm::mat3& NormalMatrix(size_t index) const { return normalMatrices[index]; }
+
+private:
+    std::vector<float> positionX, positionY, positionZ;
+    std::vector<float> rotationX, rotationY, rotationZ; // Degrees
+    std::vector<float> scaleX, scaleY, scaleZ;
+    std::vector<glm::mat4> modelMatrices;
+    std::vector<glm::mat3> normalMatrices;
+    std::vector<unsigned char> dirty;
+    std::vector<uint32_t> dirtyList;
+    std::vector<uint32_t> updated;
+};
+
+#endif // TRANSFORM_CACHE_H
@@ -0,0 +1,27 @@
+// UniformBuffer.cpp
+#include "UniformBuffer.h"
+
+GLint UniformBlockBinding(const std::string& blockName)
+{
+    if (blockName == "FrameData")
+        return FRAME_BLOCK_BINDING;
+    return -1;
+}
+
+UniformBuffer::UniformBuffer(GLuint binding, GLsizeiptr size)
+    : capacity(size)
+{
+    buffer = GLBuffer::Create();
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferData(GL_UNIFORM_BUFFER, capacity, NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+}
+
+void UniformBuffer::Update(const void* data, GLsizeiptr size)
+{
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferData(GL_UNIFORM_BUFFER, capacity, NULL, GL_STREAM_DRAW); // Orphan
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, size < capacity ? size : capacity, data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
@@ -0,0 +1,40 @@
+// UniformBuffer.h
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include <glad/glad.h> // Holds all OpenGL type declarations
+#include <glm/glm.hpp>
+#include <string>
+#include "GLResource.h"
+
+// Binding points shared by every program. Shader binds blocks with these names automatically after linking.
+const GLuint FRAME_BLOCK_BINDING = 0; // uniform FrameData
+
+// Returns the binding point for a uniform block name, or -1 if the engine does not provide that block
+GLint UniformBlockBinding(const std::string& blockName);
+
+// std140 layout of the FrameData block
+struct FrameBlock {
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::vec4 viewPos;       // xyz = camera position
+    glm::vec4 clusterParams; // x = near plane, y = far plane, zw = framebuffer size (see LightClusters.h)
+};
+
+// A uniform buffer attached to a fixed binding point and rewritten as a whole every frame.
+class UniformBuffer
+{
+public:
+    // Allocates a buffer of the given size and binds it to the binding point
+    UniformBuffer(GLuint binding, GLsizeiptr size);
+
+    // Replaces the buffer contents. The old storage is orphaned first so the
+    // driver never has to wait for draws still reading last frame's data.
+    void Update(const void* data, GLsizeiptr size);
+
+private:
+    GLBuffer buffer;
+    GLsizeiptr capacity;
+};
+
+#endif // UNIFORM_BUFFER_H
@@ -0,0 +1,148 @@
+// VertexPacking.cpp
+#include "VertexPacking.h"
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <cmath>
+
+const float TWO_PI = 6.28318530718f;
+
+static float SignNotZero(float value)
+{
+    return value >= 0.0f ? 1.0f : -1.0f;
+}
+
+static float DecodeSnorm16(GLshort value)
+{
+    return std::max(static_cast<float>(value) / 32767.0f, -1.0f);
+}
+
+void EncodeOctahedral(const glm::vec3& direction, GLshort encoded[2])
+{
+    // Project onto the octahedron, fold the lower half over, then map to [-1, 1]^2
+    float sum = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+    if (sum < 1e-20f)
+    {
+        encoded[0] = encoded[1] = 0;
+        return;
+    }
+    glm::vec2 projected(direction.x / sum, direction.y / sum);
+    if (direction.z < 0.0f)
+        projected = glm::vec2((1.0f - std::abs(projected.y)) * SignNotZero(projected.x), (1.0f - std::abs(projected.x)) * SignNotZero(projected.y));
+
+    // Of the four neighbouring grid points, keep the one that decodes closest to the input
+    glm::vec3 unit = glm::normalize(direction);
+    float bestDot = -2.0f;
+    float baseX = std::floor(glm::clamp(projected.x, -1.0f, 1.0f) * 32767.0f);
+    float baseY = std::floor(glm::clamp(projected.y, -1.0f, 1.0f) * 32767.0f);
+    for (int corner = 0; corner < 4; corner++)
+    {
+        GLshort candidate[2] = {
+            static_cast<GLshort>(glm::clamp(baseX + (corner & 1), -32767.0f, 32767.0f)),
+            static_cast<GLshort>(glm::clamp(baseY + (corner >> 1), -32767.0f, 32767.0f)) };
+        float dot = glm::dot(DecodeOctahedral(candidate), unit);
+        if (dot > bestDot)
+        {
+            bestDot = dot;
+            encoded[0] = candidate[0];
+            encoded[1] = candidate[1];
+        }
+    }
+}
+
+glm::vec3 DecodeOctahedral(const GLshort encoded[2])
+{
+    glm::vec3 direction(DecodeSnorm16(encoded[0]), DecodeSnorm16(encoded[1]), 0.0f);
+    direction.z = 1.0f - std::abs(direction.x) - std::abs(direction.y);
+    if (direction.z < 0.0f)
+    {
+        float x = direction.x;
+        direction.x = (1.0f - std::abs(direction.y)) * SignNotZero(x);
+        direction.y = (1.0f - std::abs(x)) * SignNotZero(direction.y);
+    }
+    return glm::normalize(direction);
+}
+
+// Orthonormal basis from a unit normal (Duff et al. 2017)
+static void TangentBasis(const glm::vec3& normal, glm::vec3& axisX, glm::vec3& axisY)
+{
+    float sign = SignNotZero(normal.z);
+    float a = -1.0f / (sign + normal.z);
+    float b = normal.x * normal.y * a;
+    axisX = glm::vec3(1.0f + sign * normal.x * normal.x * a, sign * b, -sign * normal.x);
+    axisY = glm::vec3(b, sign + normal.y * normal.y * a, -normal.y);
+}
+
+GLushort EncodeTangent(const glm::vec3& normal, const glm::vec3& tangent, float handedness)
+{
+    glm::vec3 axisX, axisY;
+    TangentBasis(normal, axisX, axisY);
+    float angle = std::atan2(glm::dot(tangent, axisY), glm::dot(tangent, axisX));
+    if (angle < 0.0f)
+        angle += TWO_PI;
+    unsigned int step = static_cast<unsigned int>(std::lround(angle / TWO_PI * 32768.0f)) & 32767u;
+    return static_cast<GLushort>((step << 1) | (handedness >= 0.0f ? 1u : 0u));
+}
+
+glm::vec4 DecodeTangent(const glm::vec3& normal, GLushort code)
+{
+    glm::vec3 axisX, axisY;
+    TangentBasis(normal, axisX, axisY);
+    float angle = static_cast<float>(code >> 1) / 32768.0f * TWO_PI;
+    glm::vec3 tangent = axisX * std::cos(angle) + axisY * std::sin(angle);
+    return glm::vec4(tangent, (code & 1) ? 1.0f : -1.0f);
+}
+
+bool PackVertices(const Vertex* vertices, const glm::vec4* tangents, size_t count, const Bounds& bounds, std::vector<PackedVertex>& packed)
+{
+    packed.clear();
+    packed.resize(count);
+    glm::vec3 extent = bounds.max - bounds.min;
+    glm::vec3 scale(extent.x > 0.0f ? 65535.0f / extent.x : 0.0f,
+                    extent.y > 0.0f ? 65535.0f / extent.y : 0.0f,
+                    extent.z > 0.0f ? 65535.0f / extent.z : 0.0f);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const Vertex& vertex = vertices[i];
+        PackedVertex& target = packed[i];
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float quantized = (vertex.Position[axis] - bounds.min[axis]) * scale[axis];
+            target.position[axis] = static_cast<GLushort>(glm::clamp(std::round(quantized), 0.0f, 65535.0f));
+        }
+
+        EncodeOctahedral(vertex.Normal, target.normal);
+        // The shader rebuilds the tangent around the normal it decodes, so encode against that one
+        glm::vec3 normal = DecodeOctahedral(target.normal);
+        if (tangents)
+        {
+            glm::vec3 tangent = glm::vec3(tangents[i]) - normal * glm::dot(normal, glm::vec3(tangents[i]));
+            target.position[3] = glm::dot(tangent, tangent) > 1e-12f ? EncodeTangent(normal, tangent, tangents[i].w) : 1;
+        }
+        else
+        {
+            target.position[3] = 1;
+        }
+
+        for (int axis = 0; axis < 2; axis++)
+        {
+            target.texCoords[axis] = glm::packHalf1x16(vertex.TexCoords[axis]);
+            if (!(std::abs(glm::unpackHalf1x16(target.texCoords[axis]) - vertex.TexCoords[axis]) <= PACKED_TEXCOORD_TOLERANCE))
+            {
+                packed.clear();
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void UnpackVertex(const PackedVertex& packed, const Bounds& bounds, Vertex& vertex, glm::vec4& tangent)
+{
+    glm::vec3 quantized(packed.position[0], packed.position[1], packed.position[2]);
+    vertex.Position = bounds.min + quantized / 65535.0f * (bounds.max - bounds.min);
+    vertex.Normal = DecodeOctahedral(packed.normal);
+    vertex.TexCoords = glm::vec2(glm::unpackHalf1x16(packed.texCoords[0]), glm::unpackHalf1x16(packed.texCoords[1]));
+    tangent = DecodeTangent(vertex.Normal, packed.position[3]);
+}
@@ -0,0 +1,31 @@
+// VertexPacking.h
+#ifndef VERTEX_PACKING_H
+#define VERTEX_PACKING_H
+
+#include <glm/glm.hpp>
+#include <vector>
+#include "Bounds.h"
+#include "Mesh.h"
+
+// Largest texture coordinate change half floats may cause before a mesh is kept as Vertex
+// (half a texel of a 1024 texture)
+const float PACKED_TEXCOORD_TOLERANCE = 1.0f / 2048.0f;
+
+// Octahedral unit vector encoding in two snorm16 values, picking the rounding that decodes closest
+void EncodeOctahedral(const glm::vec3& direction, GLshort encoded[2]);
+glm::vec3 DecodeOctahedral(const GLshort encoded[2]);
+
+// Tangent as its angle (15 bits) in the plane of the normal, measured from a basis built from the
+// normal alone, plus the bitangent sign (1 bit). normal must be the decoded one, as in the shader.
+GLushort EncodeTangent(const glm::vec3& normal, const glm::vec3& tangent, float handedness);
+glm::vec4 DecodeTangent(const glm::vec3& normal, GLushort code); // w = handedness
+
+// Packs vertices and their tangents (xyz + handedness in w, may be null) with positions quantized
+// to the bounds. Returns false, leaving packed empty, if a texture coordinate would move by more
+// than PACKED_TEXCOORD_TOLERANCE.
+bool PackVertices(const Vertex* vertices, const glm::vec4* tangents, size_t count, const Bounds& bounds, std::vector<PackedVertex>& packed);
+
+// Decodes a packed vertex the way vertex_shader.glsl does
+void UnpackVertex(const PackedVertex& packed, const Bounds& bounds, Vertex& vertex, glm::vec4& tangent);
+
+#endif // VERTEX_PACKING_H
@@ -1,17 +1,24 @@
 // fragment shader
 #version 330 core
-struct Light {
-    vec3 position;
-    vec3 rotation;
-    vec3 scale;
-    vec3 color;
-    float intensity;
+// Clustered lighting: the view frustum is split into CLUSTER_X x CLUSTER_Y screen tiles and
+// CLUSTER_Z exponential depth slices, and each cluster lists the lights that reach it
+// (built on the CPU every frame, see LightClusters.h; the sizes must match)
+#define CLUSTER_X 16
+#define CLUSTER_Y 9
+#define CLUSTER_Z 24
+
+// Per-frame data shared by all programs (std140, see UniformBuffer.h)
+layout (std140) uniform FrameData {
+    mat4 projection;
+    mat4 view;
+    vec4 viewPos;
+    vec4 clusterParams; // x = near, y = far, zw = framebuffer size
 };
 
-#define MAX_LIGHTS 10
-uniform int numLights;
-uniform Light lights[MAX_LIGHTS];
-uniform vec3 viewPos;
+uniform samplerBuffer lightData;      // Two texels per light: (position, radius), (color * intensity, 0)
+uniform usamplerBuffer lightClusters; // (first index, count) per cluster
+uniform usamplerBuffer lightIndices;  // Light indices of all clusters, back to back
+
 uniform vec3 materialColor;    // Add this uniform for BSDF base color
 uniform bool useTextures;      // Add this to toggle between textured and solid color
 
@@ -25,6 +32,37 @@ in vec2 TexCoords;
 
 out vec4 FragColor;
 
+// Diffuse and specular from one light. Windowed lights fade to exactly zero at their radius;
+// unbounded ones (scenes saved before lights had a radius) do not fade.
+vec3 shadeLight(int light, vec3 norm, vec3 viewDir, bool windowed)
+{
+    vec4 positionRadius = texelFetch(lightData, light * 2);
+    vec3 lightColor = texelFetch(lightData, light * 2 + 1).rgb;
+
+    vec3 toLight = positionRadius.xyz - FragPos;
+    float falloff = 1.0;
+    if (windowed)
+    {
+        float distanceRatio = length(toLight) / positionRadius.w;
+        falloff = clamp(1.0 - distanceRatio * distanceRatio * distanceRatio * distanceRatio, 0.0, 1.0);
+        falloff *= falloff;
+    }
+
+    // Light direction
+    vec3 lightDir = normalize(toLight);
+
+    // Diffuse shading
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 diffuse = lightColor * diff * falloff;
+
+    // Specular shading
+    vec3 reflectDir = reflect(-lightDir, norm);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
+    vec3 specular = lightColor * spec * falloff * 0.5;  // Reduced specular intensity
+
+    return diffuse + specular;
+}
+
 void main()
 {
     // Ambient
@@ -37,26 +75,24 @@ void main()
     vec3 norm = normalize(Normal);
     
     // View direction
-    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 viewDir = normalize(viewPos.xyz - FragPos);
     
-    // Iterate through all lights
-    for(int i = 0; i < numLights; i++)
-    {
-        // Light direction
-        vec3 lightDir = normalize(lights[i].position - FragPos);
-        
-        // Diffuse shading
-        float diff = max(dot(norm, lightDir), 0.0);
-        vec3 diffuse = lights[i].color * diff * lights[i].intensity;
-        
-        // Specular shading
-        vec3 reflectDir = reflect(-lightDir, norm);  
-        float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
-        vec3 specular = lights[i].color * spec * lights[i].intensity * 0.5;  // Reduced specular intensity
-        
-        // Accumulate results
-        result += diffuse + specular;
-    }
+    // Find this fragment's cluster
+    float depth = -(view * vec4(FragPos, 1.0)).z;
+    float zNear = clusterParams.x;
+    float zFar = clusterParams.y;
+    int slice = int(floor(log(max(depth, zNear) / zNear) / log(zFar / zNear) * float(CLUSTER_Z)));
+    ivec2 tile = ivec2(gl_FragCoord.xy / clusterParams.zw * vec2(CLUSTER_X, CLUSTER_Y));
+    tile = clamp(tile, ivec2(0), ivec2(CLUSTER_X - 1, CLUSTER_Y - 1));
+    int cluster = tile.x + CLUSTER_X * (tile.y + CLUSTER_Y * clamp(slice, 0, CLUSTER_Z - 1));
+    uvec2 lightList = texelFetch(lightClusters, cluster).xy;
+
+    // Lights touching this cluster, then the unbounded ones, which every fragment gets
+    for(uint i = 0u; i < lightList.y; i++)
+        result += shadeLight(int(texelFetch(lightIndices, int(lightList.x + i)).x), norm, viewDir, true);
+    uvec2 unboundedList = texelFetch(lightClusters, CLUSTER_X * CLUSTER_Y * CLUSTER_Z).xy;
+    for(uint i = 0u; i < unboundedList.y; i++)
+        result += shadeLight(int(texelFetch(lightIndices, int(unboundedList.x + i)).x), norm, viewDir, false);
 
     // Use either texture or material color
     vec3 color;
@@ -1,22 +1,55 @@
 // vertex shader
 #version 330 core
-layout (location = 0) in vec3 aPos; 
+#ifdef PACKED_VERTEX
+// PackedVertex (see Mesh.h): positions relative to the mesh bounds, mapped back by the instance
+// position scale and instanceModel (which includes the bounds offset)
+layout (location = 0) in vec4 aPackedPosition; // xyz: position, w: tangent code (not read yet; see DecodeTangent)
+layout (location = 1) in vec2 aPackedNormal;   // Octahedral normal as snorm16 integers
+#else
+layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
+#endif
 layout (location = 2) in vec2 aTexCoords;
+// Per-instance transforms (see InstanceData in Mesh.h)
+layout (location = 3) in mat4 instanceModel;
+layout (location = 7) in vec4 instanceNormal0; // xyz: normal matrix columns, w: PackedVertex position scale
+layout (location = 8) in vec4 instanceNormal1;
+layout (location = 9) in vec4 instanceNormal2;
 
-out vec3 FragPos;  
-out vec3 Normal;  
+out vec3 FragPos;
+out vec3 Normal;
 out vec2 TexCoords;
 
-uniform mat4 projection;
-uniform mat4 view;
-uniform mat4 model;
+// Per-frame data shared by all programs (std140, see UniformBuffer.h)
+layout (std140) uniform FrameData {
+    mat4 projection;
+    mat4 view;
+    vec4 viewPos;
+    vec4 clusterParams; // x = near, y = far, zw = framebuffer size
+};
+
+#ifdef PACKED_VERTEX
+// Same decode as VertexPacking.cpp
+vec3 decodeOctahedral(vec2 encoded)
+{
+    vec2 e = max(encoded / 32767.0, vec2(-1.0));
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+#endif
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;  
+    mat3 instanceNormal = mat3(instanceNormal0.xyz, instanceNormal1.xyz, instanceNormal2.xyz);
+#ifdef PACKED_VERTEX
+    vec3 aPos = aPackedPosition.xyz * vec3(instanceNormal0.w, instanceNormal1.w, instanceNormal2.w);
+    vec3 aNormal = decodeOctahedral(aPackedNormal);
+#endif
+    FragPos = vec3(instanceModel * vec4(aPos, 1.0));
+    Normal = instanceNormal * aNormal;
     TexCoords = aTexCoords;
-    
-    gl_Position = projection * view * model * vec4(aPos, 1.0); // Fixed position calculation
-}
\ No newline at end of file
+
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}